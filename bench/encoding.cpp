@@ -0,0 +1,100 @@
+/* Compares JSON and CBOR for the torrents status listing of N torrents: encode time, payload size and gzipped size. Both are
+ written through ValueWriter from the same status snapshots and field table the endpoint uses, so only the encoder differs.
+ Usage: bench_encoding <number of torrents> */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "responseBody.h"
+#include "cborWriter.h"
+#include "torrentStatusFields.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace {
+
+int const rounds = 20;
+
+typedef std::chrono::steady_clock bench_clock;
+
+std::vector<Torrent::status_snapshot> make_snapshots(int const count) {
+	std::vector<Torrent::status_snapshot> snapshots(count);
+	for(int i = 0; i < count; i++) {
+		Torrent::status_snapshot &snapshot = snapshots[i];
+		snapshot.status.name = "ubuntu-" + std::to_string(i) + "-desktop-amd64.iso";
+		snapshot.status.save_path = "/home/torrentine/downloads/";
+		snapshot.status.download_rate = 1000 * (i % 977);
+		snapshot.status.upload_rate = 100 * (i % 331);
+		snapshot.status.progress = float(i % 1000) / 1000.0f;
+		snapshot.status.progress_ppm = (i % 1000) * 1000;
+		snapshot.status.total_done = boost::int64_t(i) * 16384;
+		snapshot.status.total_wanted = boost::int64_t(i) * 32768;
+		snapshot.status.num_peers = i % 50;
+		snapshot.status.distributed_copies = 1.0f + float(i % 7) / 8.0f;
+		snapshot.download_limit = -1;
+		snapshot.upload_limit = -1;
+		snapshot.info_hash = std::string(40, 'a' + i % 6);
+	}
+	return snapshots;
+}
+
+void write_listing(ValueWriter &writer, std::vector<Torrent::status_snapshot> const &snapshots) {
+	std::vector<status_field> const &fields = get_torrent_status_fields();
+	writer.StartObject();
+	writer.Key("torrents");
+	writer.StartObject();
+	for(std::size_t i = 0; i < snapshots.size(); i++) {
+		std::string const id = std::to_string(i + 1);
+		writer.Key(id.c_str(), id.length(), true);
+		writer.StartObject();
+		writer.Key("status");
+		writer.StartObject();
+		for(status_field const &field : fields) {
+			writer.Key(field.name);
+			write_status_value(writer, field.get(snapshots[i]));
+		}
+		writer.EndObject();
+		writer.EndObject();
+	}
+	writer.EndObject();
+	writer.EndObject();
+}
+
+template<typename Writer>
+void run(char const *name, std::vector<Torrent::status_snapshot> const &snapshots) {
+	rapidjson::StringBuffer buffer;
+	double best_ms = 0;
+	for(int round = 0; round < rounds; round++) {
+		buffer.Clear();
+		bench_clock::time_point const start = bench_clock::now();
+		ValueWriterAdapter<Writer, rapidjson::StringBuffer> writer(buffer);
+		write_listing(writer, snapshots);
+		double const ms = std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+		best_ms = round == 0 ? ms : std::min(best_ms, ms);
+	}
+	bench_clock::time_point const start = bench_clock::now();
+	response_body const compressed = compress_body(content_coding::gzip, 6, buffer.GetString(), buffer.GetSize());
+	double const gzip_ms = std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+
+	std::cout << "  " << name << ": encode " << best_ms << " ms (best of " << rounds << "), " << buffer.GetSize() << " bytes, gzip "
+		<< compressed.size << " bytes in " << gzip_ms << " ms" << std::endl;
+}
+
+}
+
+int main(int argc, char const* argv[]) {
+	if(argc != 2 || std::atoi(argv[1]) <= 0) {
+		std::cerr << "Usage: " << argv[0] << " <number of torrents>" << std::endl;
+		return 1;
+	}
+	int const count = std::atoi(argv[1]);
+	std::vector<Torrent::status_snapshot> const snapshots = make_snapshots(count);
+
+	std::cout << "torrents: " << count << ", status fields: " << get_torrent_status_fields().size() << std::endl;
+	run<rapidjson::Writer<rapidjson::StringBuffer>>("json", snapshots);
+	run<CborWriter<rapidjson::StringBuffer>>("cbor", snapshots);
+	return 0;
+}
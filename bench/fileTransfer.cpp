@@ -0,0 +1,123 @@
+/* Compares the two ways stream_get can send a file: reading it into a 128 KB buffer and writing that to the socket, which is
+ what the endpoint did before, and FileSender's sendfile(). Both send the same file over loopback to a reader on another
+ thread. Reports throughput and the CPU time the process spent per GiB sent (user and system, both threads).
+ Usage: bench_file_transfer <file size in MiB> */
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "fileSender.h"
+
+namespace {
+
+int const rounds = 3;
+
+typedef std::chrono::steady_clock bench_clock;
+
+double cpu_seconds() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// The previous stream_get loop: read a buffer, write it, wait for the write, repeat
+void read_and_send(boost::asio::ip::tcp::socket &socket, std::shared_ptr<std::ifstream> const &ifs,
+		std::shared_ptr<std::vector<char>> const &buffer) {
+	std::streamsize const read_length = ifs->read(&(*buffer)[0], buffer->size()).gcount();
+	if(read_length > 0) {
+		boost::asio::async_write(socket, boost::asio::buffer(&(*buffer)[0], read_length),
+				[&socket, ifs, buffer](boost::system::error_code const &ec, std::size_t) {
+			if(!ec)
+				read_and_send(socket, ifs, buffer);
+			else
+				socket.close();
+		});
+	}
+	else
+		socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+}
+
+template<typename Start>
+void run(char const *name, std::uint64_t const size, Start start) {
+	double best_seconds = 0;
+	double best_cpu = 0;
+	for(int round = 0; round < rounds; round++) {
+		boost::asio::io_service io_service;
+		boost::asio::ip::tcp::acceptor acceptor(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+		boost::asio::ip::tcp::socket socket(io_service);
+		boost::asio::ip::tcp::socket peer(io_service);
+		socket.connect(acceptor.local_endpoint());
+		acceptor.accept(peer);
+
+		std::uint64_t received = 0;
+		double const cpu_start = cpu_seconds();
+		bench_clock::time_point const time_start = bench_clock::now();
+		std::thread reader([&peer, &received]() {
+			std::vector<char> buffer(256 * 1024);
+			boost::system::error_code ec;
+			while(!ec) {
+				received += peer.read_some(boost::asio::buffer(buffer), ec);
+			}
+		});
+		start(socket);
+		io_service.run();
+		reader.join();
+		double const seconds = std::chrono::duration<double>(bench_clock::now() - time_start).count();
+		double const cpu = cpu_seconds() - cpu_start;
+		if(received != size) {
+			std::cerr << name << ": received " << received << " of " << size << " bytes" << std::endl;
+			std::exit(1);
+		}
+		if(round == 0 || seconds < best_seconds) {
+			best_seconds = seconds;
+			best_cpu = cpu;
+		}
+	}
+	double const gib = double(size) / (1024.0 * 1024.0 * 1024.0);
+	std::cout << "  " << name << ": " << gib * 8 / best_seconds << " Gbit/s, " << best_cpu / gib << " CPU s per GiB (best of "
+		<< rounds << ")" << std::endl;
+}
+
+}
+
+int main(int argc, char const* argv[]) {
+	if(argc != 2 || std::atoi(argv[1]) <= 0) {
+		std::cerr << "Usage: " << argv[0] << " <file size in MiB>" << std::endl;
+		return 1;
+	}
+	std::uint64_t const size = std::uint64_t(std::atoi(argv[1])) * 1024 * 1024;
+	boost::filesystem::path const filename = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+	{
+		std::ofstream file(filename.string(), std::ios::binary);
+		std::vector<char> block(1024 * 1024);
+		for(std::size_t i = 0; i < block.size(); i++) {
+			block[i] = char(i * 31);
+		}
+		for(std::uint64_t written = 0; written < size; written += block.size()) {
+			file.write(block.data(), block.size());
+		}
+	}
+	std::string const path = filename.string();
+
+	std::cout << "file: " << size / (1024 * 1024) << " MiB (page cache warm after the first round)" << std::endl;
+	run("read + write", size, [&path](boost::asio::ip::tcp::socket &socket) {
+		auto ifs = std::make_shared<std::ifstream>(path, std::ios::binary);
+		read_and_send(socket, ifs, std::make_shared<std::vector<char>>(131072));
+	});
+	run("sendfile", size, [&path, size](boost::asio::ip::tcp::socket &socket) {
+		FileSender::start(socket, ::open(path.c_str(), O_RDONLY | O_CLOEXEC), 0, size,
+				[&socket](boost::system::error_code const &ec, std::uint64_t) {
+			socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+		});
+	});
+	boost::filesystem::remove(filename);
+	return 0;
+}
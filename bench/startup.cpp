@@ -0,0 +1,211 @@
+/* Measures a cold start of a library of N torrents: TorrentManager construction, load_session_state, load_session_extensions
+ and load_fastresume, up to the moment every torrent got its add_torrent_alert. The torrents and their resume data are made up
+ locally with lt::create_torrent, and the session is told to stay off the network, so nothing is downloaded. They are made
+ in a child process, so the peak RSS reported for the cold start does not include the one of generating the library.
+ Usage: bench_startup <number of torrents> */
+#include <libtorrent/create_torrent.hpp>
+#include <libtorrent/file_storage.hpp>
+#include <libtorrent/hasher.hpp>
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/entry.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "torrentManager.h"
+#include "resumeDataStore.h"
+#include "config.h"
+
+namespace lt = libtorrent;
+namespace fs = boost::filesystem;
+
+namespace {
+
+int const piece_size = 16 * 1024;
+
+typedef std::chrono::steady_clock bench_clock;
+
+double elapsed_ms(bench_clock::time_point const start) {
+	return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+// who is RUSAGE_SELF, or RUSAGE_CHILDREN for the largest child that was waited for
+long peak_rss_kb(int const who = RUSAGE_SELF) {
+	struct rusage usage;
+	getrusage(who, &usage);
+	return usage.ru_maxrss;
+}
+
+void write_config(fs::path const &root) {
+	std::ofstream out((root / "config.toml").string());
+	out << "[libtorrent]\n"
+		<< "\t[libtorrent.extensions]\n"
+		<< "\t\tut_metadata_plugin = \"enabled\"\n"
+		<< "\t\tut_pex_plugin = \"enabled\"\n"
+		<< "\t\tsmart_ban_plugin = \"enabled\"\n"
+		<< "[directory]\n"
+		<< "\tdownload_path = \"" << (root / "downloads/").string() << "\"\n"
+		<< "\tfastresume_path = \"" << (root / "fastresume/").string() << "\"\n"
+		<< "\tsession_state_path = \"" << (root / "session.state").string() << "\"\n"
+		<< "\tdatabase_path = \"" << (root / "torrentine.db").string() << "\"\n"
+		<< "\ttorrent_file_path = \"" << (root / "torrents/").string() << "\"\n";
+}
+
+// Keeps the session off the network: no DHT, LSD, UPnP or NAT-PMP, and listening on loopback only
+void write_session_state(fs::path const &root) {
+	lt::entry state;
+	lt::entry &settings = state["settings"];
+	settings["enable_dht"] = 0;
+	settings["enable_lsd"] = 0;
+	settings["enable_upnp"] = 0;
+	settings["enable_natpmp"] = 0;
+	settings["listen_interfaces"] = std::string("127.0.0.1:0");
+	std::vector<char> buffer;
+	lt::bencode(std::back_inserter(buffer), state);
+	std::ofstream out((root / "session.state").string(), std::ios_base::binary);
+	out.write(buffer.data(), buffer.size());
+}
+
+/* Every torrent is a single piece of zeros. They only differ by file name, which is enough to give each one its own info hash.
+ The resume data is what save_resume_data(save_info_dict) would produce for a paused torrent. */
+void generate_library(fs::path const &root, int const count) {
+	fs::create_directories(root / "torrents");
+	std::vector<char> piece(piece_size, 0);
+	lt::sha1_hash const piece_hash = lt::hasher(piece.data(), piece.size()).final();
+
+	ResumeDataStore store;
+	store.open(root / "torrentine.db");
+	for(int i = 0; i < count; i++) {
+		lt::file_storage files;
+		files.add_file("bench/torrent_" + std::to_string(i) + ".dat", piece_size);
+		lt::create_torrent torrent(files, piece_size);
+		torrent.set_hash(0, piece_hash);
+		lt::entry torrent_entry = torrent.generate();
+
+		std::vector<char> torrent_buffer;
+		lt::bencode(std::back_inserter(torrent_buffer), torrent_entry);
+		std::ofstream out((root / "torrents" / (std::to_string(i) + ".torrent")).string(), std::ios_base::binary);
+		out.write(torrent_buffer.data(), torrent_buffer.size());
+
+		std::vector<char> info_buffer;
+		lt::bencode(std::back_inserter(info_buffer), torrent_entry["info"]);
+		lt::sha1_hash const info_hash = lt::hasher(info_buffer.data(), info_buffer.size()).final();
+
+		boost::shared_ptr<lt::entry> resume_data = boost::make_shared<lt::entry>();
+		(*resume_data)["file-format"] = std::string("libtorrent resume file");
+		(*resume_data)["file-version"] = 1;
+		(*resume_data)["info-hash"] = info_hash.to_string();
+		(*resume_data)["info"] = torrent_entry["info"];
+		(*resume_data)["save_path"] = (root / "downloads").string();
+		(*resume_data)["paused"] = 1;
+		(*resume_data)["auto_managed"] = 0;
+		(*resume_data)["upload_rate_limit"] = -1;
+		(*resume_data)["download_rate_limit"] = -1;
+
+		std::stringstream ss_hash;
+		ss_hash << info_hash;
+		store.save(ss_hash.str(), resume_data);
+	}
+	store.flush();
+}
+
+}
+
+int main(int argc, char const* argv[]) {
+	int const count = argc > 1 ? std::atoi(argv[1]) : 1000;
+	if(count <= 0) {
+		std::cerr << "Usage: " << argv[0] << " <number of torrents>" << std::endl;
+		return 1;
+	}
+	fs::path const root = fs::temp_directory_path() / fs::unique_path("torrentine-bench-%%%%-%%%%");
+	fs::create_directories(root);
+	write_config(root);
+	write_session_state(root);
+
+	// Forked before any thread is started, so the child is a plain copy of this process
+	bench_clock::time_point start = bench_clock::now();
+	pid_t const generator = fork();
+	if(generator < 0) {
+		std::cerr << "Could not fork the library generator" << std::endl;
+		fs::remove_all(root);
+		return 1;
+	}
+	if(generator == 0) {
+		generate_library(root, count);
+		std::_Exit(0);
+	}
+	int generator_status;
+	if(waitpid(generator, &generator_status, 0) != generator || !WIFEXITED(generator_status) ||
+			WEXITSTATUS(generator_status) != 0) {
+		std::cerr << "Could not generate the library" << std::endl;
+		fs::remove_all(root);
+		return 1;
+	}
+	double const generate_ms = elapsed_ms(start);
+	long const generate_rss_kb = peak_rss_kb(RUSAGE_CHILDREN);
+
+	ConfigManager config;
+	config.load_config(root / "config.toml");
+
+	bench_clock::time_point const startup = bench_clock::now();
+	double construct_ms, session_state_ms, extensions_ms, fastresume_ms, decoded_ms = 0, added_ms = 0;
+	std::size_t added = 0;
+	std::size_t loaded = 0;
+	{
+		start = bench_clock::now();
+		TorrentManager torrent_manager(config);
+		construct_ms = elapsed_ms(start);
+
+		start = bench_clock::now();
+		torrent_manager.load_session_state();
+		session_state_ms = elapsed_ms(start);
+
+		start = bench_clock::now();
+		torrent_manager.load_session_extensions();
+		extensions_ms = elapsed_ms(start);
+
+		start = bench_clock::now();
+		torrent_manager.load_fastresume();
+		fastresume_ms = elapsed_ms(start);
+
+		// Handles alerts the way the event loop would, until every torrent was added or ten minutes went by
+		bench_clock::time_point const deadline = bench_clock::now() + std::chrono::minutes(10);
+		while(added < static_cast<std::size_t>(count) && bench_clock::now() < deadline) {
+			torrent_manager.wait_for_alert(std::chrono::duration_cast<lt::time_duration>(std::chrono::milliseconds(100)));
+			torrent_manager.check_alerts();
+			if(decoded_ms == 0 && torrent_manager.get_fastresume_progress().finished)
+				decoded_ms = elapsed_ms(startup);
+			added = torrent_manager.get_all_ids().size();
+		}
+		added_ms = elapsed_ms(startup);
+		loaded = torrent_manager.get_fastresume_progress().loaded;
+		torrent_manager.stop_loading_fastresume();
+	}
+
+	std::cout << "torrents: " << count << " (loaded " << loaded << ", added " << added << ")" << std::endl;
+	std::cout << "  generate library:        " << generate_ms << " ms" << std::endl;
+	std::cout << "  TorrentManager:          " << construct_ms << " ms" << std::endl;
+	std::cout << "  load_session_state:      " << session_state_ms << " ms" << std::endl;
+	std::cout << "  load_session_extensions: " << extensions_ms << " ms" << std::endl;
+	std::cout << "  load_fastresume call:    " << fastresume_ms << " ms" << std::endl;
+	std::cout << "  all resume data decoded: " << decoded_ms << " ms after startup" << std::endl;
+	std::cout << "  all torrents added:      " << added_ms << " ms after startup" << std::endl;
+	std::cout << "  peak RSS:                " << peak_rss_kb() << " KiB (" << generate_rss_kb << " KiB generating, in its own process)" << std::endl;
+
+	fs::remove_all(root);
+	// Every torrent the loader handed to the session must reach the registry, or an add_torrent_alert was dropped
+	if(loaded != added) {
+		std::cerr << "Loaded " << loaded << " torrents but only " << added << " are in the registry" << std::endl;
+		return 1;
+	}
+	return added == static_cast<std::size_t>(count) ? 0 : 1;
+}
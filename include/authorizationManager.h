@@ -0,0 +1,73 @@
+#include <boost/filesystem.hpp>
+#include <sqlite3.h>
+#include <chrono>
+#include <ctime>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#ifndef AUTHORIZATION_MANAGER_H
+#define AUTHORIZATION_MANAGER_H
+
+namespace fs = boost::filesystem;
+
+/* Checks HTTP Basic credentials against the users table. Verifying a password costs a PBKDF2 derivation, so headers that were
+ verified recently are remembered for cache_ttl. The cache is keyed by an HMAC of the header under a random per-process key,
+ so it never holds passwords. open() installs triggers that bump the users_version row on every change to the users table.
+ When it moves, a cached entry is only trusted again after the user's row was read back unchanged. Bearer tokens issued by issue_token() are checked without the database or PBKDF2.
+ May be called from any thread, except configure_tokens(), which must be called before the server starts. */
+class AuthorizationManager {
+private:
+	struct cached_credential {
+		std::string username;
+		std::string password_hash;
+		std::string salt;
+		std::chrono::steady_clock::time_point expiry;
+		std::int64_t users_version;
+	};
+	struct user_row {
+		std::string username;
+		std::string password_hash;
+		std::string salt;
+	};
+
+	std::chrono::steady_clock::duration const cache_ttl;
+	std::size_t const max_cached_credentials;
+	unsigned char cache_key[32];
+	bool cache_enabled;
+
+	std::mutex db_mutex; // Guards the connection and the statements
+	sqlite3 *db;
+	sqlite3_stmt *user_stmt;
+	sqlite3_stmt *users_version_stmt;
+
+	std::mutex cache_mutex;
+	std::unordered_map<std::string, cached_credential> cache;
+
+	std::string token_secret;
+	std::chrono::seconds token_lifetime;
+
+	std::int64_t get_users_version();
+	bool find_user(std::string const &username, user_row &row, std::int64_t &users_version);
+	std::string hash_header(std::string const &authorization) const;
+	std::string sign_token(std::string const &payload) const;
+	bool is_basic_authorization_valid(std::string const &authorization);
+	void cache_credential(std::string const &header_hash, user_row const &row, std::int64_t const users_version);
+public:
+	AuthorizationManager(std::chrono::steady_clock::duration const cache_ttl = std::chrono::minutes(5),
+			std::size_t const max_cached_credentials = 1024);
+	~AuthorizationManager();
+	bool open(fs::path const &database_path);
+	bool is_authorization_valid(std::string const &authorization);
+	void clear_cache();
+	void configure_tokens(std::string const &secret, std::chrono::seconds const lifetime);
+	std::string issue_token(std::string const &username, std::time_t const now = std::time(NULL));
+	bool is_token_valid(std::string const &token, std::time_t const now = std::time(NULL));
+	std::chrono::seconds get_token_lifetime() const;
+};
+
+std::string decode_basic_auth(std::string const &authorization);
+
+#endif
@@ -0,0 +1,45 @@
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#ifndef BYTE_RANGES_H
+#define BYTE_RANGES_H
+
+// HTTP range requests (RFC 7233) for file responses
+
+// Positions are inclusive, like in Range and Content-Range
+struct byte_range {
+	std::uint64_t first;
+	std::uint64_t last;
+	std::uint64_t length() const { return last - first + 1; }
+};
+
+enum class range_request {
+	whole, // No Range header, or one that has to be ignored: send 200 with the whole file
+	partial, // Send 206 with the ranges
+	unsatisfiable // Send 416
+};
+
+// More ranges than this in one request are ignored, so a client can not make the server seek all over a file
+std::size_t const max_byte_ranges = 64;
+
+/* Parses a Range header for a file of size bytes into ranges. Ranges that overlap or are close together are merged and the
+ result is sorted. A header with a syntax error or a unit other than bytes is ignored, as RFC 7233 asks. */
+range_request parse_range_header(std::string const &header, std::uint64_t const size, std::vector<byte_range> &ranges);
+// The Content-Range value of a 206 response, "bytes first-last/size"
+std::string get_content_range(byte_range const &range, std::uint64_t const size);
+// The Content-Range value of a 416 response, "bytes */size"
+std::string get_unsatisfied_content_range(std::uint64_t const size);
+/* Whether the ranges should be served: If-Range holds either an ETag, which has to be strong and equal to etag, or a date, which
+ has to be equal to last_modified. */
+bool if_range_matches(std::string const &if_range, std::string const &etag, std::string const &last_modified);
+// IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string format_http_date(std::time_t const time);
+
+/* A multipart/byteranges body is separators[0], the first range, separators[1], the second range, ... and the last separator
+ closes the body. Returns the separators for ranges. */
+std::vector<std::string> get_multipart_separators(std::string const &boundary, std::vector<byte_range> const &ranges,
+		std::uint64_t const size);
+
+#endif
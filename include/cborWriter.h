@@ -0,0 +1,101 @@
+#include "rapidjson/rapidjson.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+/* Writes CBOR (RFC 7049) with the same handler interface as rapidjson::Writer, so a rapidjson::Document can be written with
+ Accept() and the streamed listings can call it directly. Objects and arrays use indefinite lengths, since a SAX writer does
+ not know the number of members up front. Doubles that a float holds exactly are written in 4 bytes instead of 8. */
+template<typename OutputStream>
+class CborWriter {
+public:
+	typedef char Ch;
+
+	explicit CborWriter(OutputStream &os) : os(&os) {}
+
+	bool Null() { put(0xf6); return true; }
+	bool Bool(bool const b) { put(b ? 0xf5 : 0xf4); return true; }
+	bool Int(int const i) { return Int64(i); }
+	bool Uint(unsigned const u) { write_head(0, u); return true; }
+	bool Int64(std::int64_t const i) {
+		if(i >= 0)
+			write_head(0, static_cast<std::uint64_t>(i));
+		else
+			write_head(1, static_cast<std::uint64_t>(-(i + 1)));
+		return true;
+	}
+	bool Uint64(std::uint64_t const u) { write_head(0, u); return true; }
+	bool Double(double const d) {
+		// Converting a double a float can not hold is undefined, so those, infinities and NaN go straight to 8 bytes
+		float const f = std::fabs(d) <= FLT_MAX ? static_cast<float>(d) : 0.0f;
+		if(std::fabs(d) <= FLT_MAX && static_cast<double>(f) == d) {
+			std::uint32_t bits;
+			std::memcpy(&bits, &f, sizeof(bits));
+			put(0xfa);
+			write_big_endian(bits, 4);
+		}
+		else {
+			std::uint64_t bits;
+			std::memcpy(&bits, &d, sizeof(bits));
+			put(0xfb);
+			write_big_endian(bits, 8);
+		}
+		return true;
+	}
+	bool RawNumber(Ch const *str, rapidjson::SizeType const length, bool const copy = false) { return String(str, length, copy); }
+	bool String(Ch const *str, rapidjson::SizeType const length, bool const copy = false) {
+		write_head(3, length);
+		for(rapidjson::SizeType i = 0; i < length; i++) {
+			os->Put(str[i]);
+		}
+		return true;
+	}
+	bool String(Ch const *str) { return String(str, std::strlen(str)); }
+	bool StartObject() { put(0xbf); return true; }
+	bool Key(Ch const *str, rapidjson::SizeType const length, bool const copy = false) { return String(str, length, copy); }
+	bool Key(Ch const *str) { return String(str); }
+	bool EndObject(rapidjson::SizeType const member_count = 0) { put(0xff); return true; }
+	bool StartArray() { put(0x9f); return true; }
+	bool EndArray(rapidjson::SizeType const element_count = 0) { put(0xff); return true; }
+
+private:
+	OutputStream *os;
+
+	void put(unsigned char const byte) {
+		os->Put(static_cast<Ch>(byte));
+	}
+	void write_big_endian(std::uint64_t const value, int const bytes) {
+		for(int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+			put(static_cast<unsigned char>(value >> shift));
+		}
+	}
+	// The initial byte of every item: the major type and the argument, which takes 0, 1, 2, 4 or 8 more bytes
+	void write_head(unsigned char const major_type, std::uint64_t const argument) {
+		unsigned char const major = major_type << 5;
+		if(argument < 24) {
+			put(major | argument);
+		}
+		else if(argument <= 0xff) {
+			put(major | 24);
+			write_big_endian(argument, 1);
+		}
+		else if(argument <= 0xffff) {
+			put(major | 25);
+			write_big_endian(argument, 2);
+		}
+		else if(argument <= 0xffffffff) {
+			put(major | 26);
+			write_big_endian(argument, 4);
+		}
+		else {
+			put(major | 27);
+			write_big_endian(argument, 8);
+		}
+	}
+};
+
+#endif
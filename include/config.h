@@ -2,6 +2,7 @@
 #include <boost/filesystem.hpp>
 #include "cpptoml/cpptoml.h"
 #include <exception>
+#include <mutex>
 
 #ifndef CONFIG_H
 #define CONFIG_H
@@ -18,8 +19,10 @@ public:
 	};
 };
 
+// Shared by the main thread and every REST API worker, so all access to the table goes through mutex
 class ConfigManager {
 private:
+	std::mutex mutex;
 	std::shared_ptr<cpptoml::table> config_toml;
 	bool create_default_config_file(fs::path const config_file);
 public:
@@ -29,6 +32,7 @@ public:
 public:
 	template <class T>
 	const T get_config(std::string const key) {
+		std::lock_guard<std::mutex> lock(mutex);
 		auto value = config_toml->get_qualified_as<T>(key); 
 
 		if(value) {
@@ -44,6 +48,7 @@ public:
 	// Find a good way to deal with this.
 	template <class T>
 	void set_config(std::string const path, std::string const key, T const value) {
+		std::lock_guard<std::mutex> lock(mutex);
 		auto table = config_toml->get_table_qualified(path);
 		// TODO - remember about exceptions config_key_error(message) here. 
 		table->insert(key, value);
@@ -0,0 +1,43 @@
+#include <cstddef>
+#include <string>
+
+#ifndef CONTENT_ENCODING_H
+#define CONTENT_ENCODING_H
+
+enum class content_coding {
+	identity,
+	gzip,
+	deflate, // zlib stream, as HTTP defines the deflate coding
+	zstd // Only when built with TORRENTINE_ZSTD
+};
+
+// Responses are compressed at the level set for their class
+enum class body_class {
+	api, // Every other JSON or CBOR response
+	listing, // Streamed torrent listings, which can be several MB
+	text // Log and metrics
+};
+
+/* Bodies smaller than min_size are sent as they are. Levels are zlib levels, from 1 (fastest) to 9 (smallest), and are
+ passed to zstd unchanged. */
+struct compression_settings {
+	std::size_t min_size;
+	int api_level;
+	int listing_level;
+	int text_level;
+
+	compression_settings();
+	int get_level(body_class const type) const;
+};
+
+/* Picks the coding the client gave the highest q-value in Accept-Encoding, out of the ones this build supports. On a tie
+ the smaller output wins: zstd, then gzip, then deflate. identity when nothing else is acceptable. */
+content_coding negotiate_content_coding(std::string const &accept_encoding);
+// For bodies that were compressed ahead of time with one coding
+bool accepts_content_coding(std::string const &accept_encoding, content_coding const coding);
+char const *get_content_coding_name(content_coding const coding);
+/* Whether Accept ranks media_type above default_type. Each type takes the q-value of the most specific range that matches it,
+ and on a tie the type the client named more specifically wins. A type with q=0 is never preferred. */
+bool prefers_media_type(std::string const &accept, std::string const &media_type, std::string const &default_type);
+
+#endif
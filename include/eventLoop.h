@@ -0,0 +1,50 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+/* Runs the alert handler as soon as libtorrent reports new alerts, and periodic jobs when they are due. Between those the
+ thread sleeps, so an idle program does not wake up to poll. notify() and stop() may be called from any thread. */
+class EventLoop {
+private:
+	struct timer {
+		std::chrono::steady_clock::time_point deadline;
+		std::chrono::steady_clock::duration interval;
+		std::function<void()> job;
+		std::function<bool()> armed;
+		bool woken; // Runs once without asking armed(), since whatever woke it may not show in armed() before the job ran
+	};
+	// Orders the timer queue so the earliest deadline is on top
+	struct later_deadline {
+		bool operator()(timer const &a, timer const &b) const {
+			return a.deadline > b.deadline;
+		}
+	};
+
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	bool alerts_pending;
+	bool stopped;
+	std::priority_queue<timer, std::vector<timer>, later_deadline> timers;
+	std::vector<timer> parked; // Timers whose armed() said there is nothing to do. They wait for wake_timers().
+	std::uint64_t wakeups; // Counts wake_timers() calls, so a wake during armed() is not lost
+public:
+	EventLoop();
+	/* armed is asked before each run. If it returns false the job does not run and the timer stops until wake_timers(), so an
+	 idle program does not wake up for it. */
+	void add_timer(std::chrono::steady_clock::duration const interval, std::function<void()> const job,
+			std::function<bool()> const armed = std::function<bool()>());
+	// Parked timers run right away, whatever armed() says, and go back to their interval
+	void wake_timers();
+	void notify();
+	void stop();
+	void run(std::function<void()> const handle_alerts);
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include <libtorrent/add_torrent_params.hpp>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#ifndef FASTRESUME_LOADER_H
+#define FASTRESUME_LOADER_H
+
+namespace lt = libtorrent;
+
+/* Loads the fastresume of every torrent at startup without blocking the caller. read runs first, on the loader thread, and
+ the buffers it returns are decoded by a pool of workers. Each worker hands its decoded torrents to add_batch batch_size at a
+ time, so add_batch is called from several threads at once and must be thread safe (session::async_add_torrent is). */
+class FastresumeLoader {
+public:
+	struct progress {
+		unsigned long int total;
+		unsigned long int loaded;
+		unsigned long int failed;
+		bool finished;
+	};
+	typedef std::function<bool(std::vector<std::vector<char>> &resume_data)> reader;
+	// May move the buffer into the add_torrent_params. Returns false if the buffer could not be decoded.
+	typedef std::function<bool(std::vector<char> &resume_data, lt::add_torrent_params &atp)> decoder;
+	typedef std::function<void(std::vector<lt::add_torrent_params> &batch)> batch_handler;
+
+private:
+	std::atomic<unsigned long int> total;
+	std::atomic<unsigned long int> loaded;
+	std::atomic<unsigned long int> failed;
+	std::atomic<bool> finished;
+	std::atomic<bool> stopping;
+	std::thread thread;
+	void run(reader const read, decoder const decode, batch_handler const add_batch, unsigned int workers,
+			std::size_t const batch_size);
+public:
+	FastresumeLoader();
+	~FastresumeLoader();
+	void start(reader const read, decoder const decode, batch_handler const add_batch, unsigned int const workers,
+			std::size_t const batch_size);
+	void stop();
+	void wait();
+	progress get_progress() const;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include <string>
+#include <vector>
+
+#ifndef FIELD_MASK_H
+#define FIELD_MASK_H
+
+/* Fields asked for with the fields= query parameter. It is compiled once per request against the names an endpoint
+ reports, so serializing a field is a lookup by its index instead of a name comparison. Every field is selected until
+ compile() is called. */
+class FieldMask {
+private:
+	bool all;
+	std::vector<bool> selected;
+public:
+	FieldMask();
+	// list is comma separated. Returns false and leaves every field selected if it names a field that is not in names.
+	bool compile(std::string const &list, std::vector<char const*> const &names);
+	bool has(std::size_t const index) const { return all || selected[index]; }
+};
+
+#endif
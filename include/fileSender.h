@@ -0,0 +1,43 @@
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#ifndef FILE_SENDER_H
+#define FILE_SENDER_H
+
+/* Writes part of a file to a TCP socket with sendfile(), so the data goes from the page cache to the socket without being
+ copied through user space. When the socket buffer is full it waits for the socket to become writable, so a slow client
+ holds back the transfer instead of it piling up in memory. The file descriptor is closed when the transfer ends. */
+class FileSender : public std::enable_shared_from_this<FileSender> {
+public:
+	// sent is the number of bytes written before the transfer finished or failed
+	typedef std::function<void(boost::system::error_code const &ec, std::uint64_t const sent)> completion_handler;
+	// Called after each write, for example to restart a timeout
+	typedef std::function<void()> progress_handler;
+
+	static void start(boost::asio::ip::tcp::socket &socket, int const fd, std::uint64_t const offset, std::uint64_t const count,
+			completion_handler on_complete, progress_handler on_progress = progress_handler());
+	~FileSender();
+
+private:
+	// At most this much is sent before going back to the io_service, so one fast transfer does not starve other connections
+	static std::uint64_t const max_burst = 4 * 1024 * 1024;
+	static std::size_t const max_write = 1024 * 1024;
+
+	boost::asio::ip::tcp::socket &socket;
+	int const fd;
+	std::uint64_t offset;
+	std::uint64_t remaining;
+	std::uint64_t sent;
+	bool was_non_blocking;
+	completion_handler on_complete;
+	progress_handler on_progress;
+
+	FileSender(boost::asio::ip::tcp::socket &socket, int const fd, std::uint64_t const offset, std::uint64_t const count,
+			completion_handler on_complete, progress_handler on_progress);
+	void send_some();
+	void finish(boost::system::error_code const &ec);
+};
+
+#endif
@@ -0,0 +1,33 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include "sessionCounters.h"
+#include "torrent.h"
+
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+/* Renders session counters and, optionally, per torrent gauges in the Prometheus text exposition format (version 0.0.4).
+ Metric names and their HELP/TYPE lines are built once, so rendering only appends numbers to the output buffer. */
+class MetricsExporter {
+private:
+	struct session_metric {
+		std::string header; // HELP and TYPE lines
+		std::string prefix; // Metric name followed by a space
+		int value_index;
+	};
+	struct torrent_metric {
+		std::string header;
+		std::string name;
+		void (*append_value)(std::string &out, Torrent::status_snapshot const &snapshot);
+	};
+	std::vector<session_metric> session_metrics;
+	std::vector<torrent_metric> torrent_metrics;
+public:
+	MetricsExporter(SessionCounters const &session_counters);
+	void render_session(std::string &out, SessionCounters::sample const &sample) const;
+	void render_torrents(std::string &out, std::vector<unsigned long int> const &ids,
+			std::vector<std::shared_ptr<Torrent::status_snapshot const>> const &torrents_status) const;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#ifndef PIECE_DEADLINES_H
+#define PIECE_DEADLINES_H
+
+/* Counts the streams that want a deadline on each piece of a torrent, so a stream that moves its window does not cancel a
+ deadline another stream still needs. The callbacks run with the lock held, so a deadline being set and the last holder
+ resetting it never interleave. They should only post the request to libtorrent. */
+class PieceDeadlines {
+private:
+	typedef std::pair<unsigned long int, int> piece_key; // (torrent id, piece)
+	std::mutex mutex;
+	std::map<piece_key, int> holders;
+
+public:
+	// set_deadline is always called, so the latest holder's deadline is the one that counts
+	void hold(unsigned long int const id, int const piece, std::function<void()> const &set_deadline);
+	// reset_deadline is only called when no other holder is left
+	void release(unsigned long int const id, int const piece, std::function<void()> const &reset_deadline);
+	std::size_t size();
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include <boost/shared_array.hpp>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#ifndef PIECE_WAITER_H
+#define PIECE_WAITER_H
+
+/* Handlers waiting for a piece of a torrent to be read. The alert loop hands over every read_piece_alert, and all handlers
+ waiting for that piece get its data. Handlers are called once, without the lock held, on the thread that reported the event,
+ so they should only hand the work over to another thread. */
+class PieceWaiter {
+public:
+	enum class result {
+		read, // data holds the whole piece
+		expired, // Nothing arrived before the deadline
+		failed // The piece could not be read or the torrent was removed
+	};
+	typedef std::function<void(result const outcome, boost::shared_array<char> const &data, int const size)> piece_handler;
+
+private:
+	struct waiter {
+		std::chrono::steady_clock::time_point deadline;
+		piece_handler handler;
+	};
+	typedef std::pair<unsigned long int, int> piece_key; // (torrent id, piece)
+	std::mutex mutex;
+	std::multimap<piece_key, waiter> waiters;
+	std::function<void()> first_waiter_notify;
+	void take(std::multimap<piece_key, waiter>::iterator const begin, std::multimap<piece_key, waiter>::iterator const end,
+			std::vector<piece_handler> &handlers);
+
+public:
+	// Called, without the lock held, when a handler starts waiting while nobody else was
+	void set_first_waiter_notify(std::function<void()> const notify);
+	void wait(unsigned long int const id, int const piece, std::chrono::steady_clock::time_point const deadline,
+			piece_handler const handler);
+	// data is NULL if the read failed
+	void piece_read(unsigned long int const id, int const piece, boost::shared_array<char> const &data, int const size);
+	void torrent_removed(unsigned long int const id);
+	// Called periodically. Handlers whose deadline passed get result::expired.
+	void expire(std::chrono::steady_clock::time_point const now);
+	std::size_t size();
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "rapidjson/document.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <zlib.h>
+#ifdef TORRENTINE_ZSTD
+#include <zstd.h>
+#endif
+#include "contentEncoding.h"
+
+#ifndef RESPONSE_BODY_H
+#define RESPONSE_BODY_H
+
+/* Points into a buffer owned by the calling thread. The buffers keep their capacity and are reused by the next body built on
+ the same thread, so a body must be written to the response before another one is built. */
+struct response_body {
+	char const *data;
+	std::size_t size;
+};
+
+response_body write_json_body(rapidjson::Document const &document, bool const pretty);
+response_body write_cbor_body(rapidjson::Document const &document);
+// Returns a NULL body if it could not be compressed or coding is identity
+response_body compress_body(content_coding const coding, int const level, char const *data, std::size_t const size);
+
+/* rapidjson output stream for bodies sent with chunked transfer encoding. Output piles up until take_chunk() frames it as
+ one HTTP chunk, so the caller decides how much is held in memory by checking is_full() between items. When compressed,
+ every chunk is flushed and can be decoded by the client as soon as it arrives. The compressor, a few hundred KB for zlib,
+ is only set up by the first take_chunk() or start_compression(), so a body that ends up fitting one chunk never pays for it. */
+class ChunkedBodyStream {
+public:
+	typedef char Ch;
+	ChunkedBodyStream(content_coding const coding, int const level, std::size_t const chunk_size = 65536);
+	~ChunkedBodyStream();
+	ChunkedBodyStream(ChunkedBodyStream const &) = delete;
+	ChunkedBodyStream &operator=(ChunkedBodyStream const &) = delete;
+	void Put(char const c) { buffer.push_back(c); }
+	void Flush() {}
+	bool is_full() const { return buffer.size() >= chunk_size; }
+	// Sets up the compressor if it was not yet. Returns the coding used, which is identity if the one asked for could not be set up.
+	content_coding start_compression();
+	// Output that was not taken yet, as written
+	std::string const &get_pending() const { return buffer; }
+	// Replaces out with the pending output framed as a chunk. last also ends the compressed stream and adds the terminating chunk.
+	void take_chunk(std::string &out, bool const last);
+private:
+	content_coding coding;
+	int const level;
+	bool started;
+	std::size_t const chunk_size;
+	std::string buffer;
+	std::string compressed;
+	z_stream stream;
+#ifdef TORRENTINE_ZSTD
+	ZSTD_CCtx *zstd_stream;
+#endif
+};
+
+/* Handler interface the streamed listings write through, so the same code produces JSON or CBOR. The methods are the ones of
+ rapidjson::Writer. */
+class ValueWriter {
+public:
+	virtual ~ValueWriter() {}
+	virtual bool Null() = 0;
+	virtual bool Bool(bool const b) = 0;
+	virtual bool Int(int const i) = 0;
+	virtual bool Uint(unsigned const u) = 0;
+	virtual bool Int64(std::int64_t const i) = 0;
+	virtual bool Uint64(std::uint64_t const u) = 0;
+	virtual bool Double(double const d) = 0;
+	virtual bool String(char const *str, rapidjson::SizeType const length, bool const copy = false) = 0;
+	virtual bool StartObject() = 0;
+	virtual bool Key(char const *str, rapidjson::SizeType const length, bool const copy = false) = 0;
+	virtual bool EndObject() = 0;
+	virtual bool StartArray() = 0;
+	virtual bool EndArray() = 0;
+	bool String(char const *str) { return String(str, std::strlen(str)); }
+	bool Key(char const *str) { return Key(str, std::strlen(str)); }
+};
+
+// Adapts a rapidjson::Writer or a CborWriter writing to os
+template<typename Writer, typename OutputStream>
+class ValueWriterAdapter : public ValueWriter {
+private:
+	Writer writer;
+public:
+	explicit ValueWriterAdapter(OutputStream &os) : writer(os) {}
+	bool Null() override { return writer.Null(); }
+	bool Bool(bool const b) override { return writer.Bool(b); }
+	bool Int(int const i) override { return writer.Int(i); }
+	bool Uint(unsigned const u) override { return writer.Uint(u); }
+	bool Int64(std::int64_t const i) override { return writer.Int64(i); }
+	bool Uint64(std::uint64_t const u) override { return writer.Uint64(u); }
+	bool Double(double const d) override { return writer.Double(d); }
+	bool String(char const *str, rapidjson::SizeType const length, bool const copy = false) override { return writer.String(str, length, copy); }
+	bool StartObject() override { return writer.StartObject(); }
+	bool Key(char const *str, rapidjson::SizeType const length, bool const copy = false) override { return writer.Key(str, length, copy); }
+	bool EndObject() override { return writer.EndObject(); }
+	bool StartArray() override { return writer.StartArray(); }
+	bool EndArray() override { return writer.EndArray(); }
+};
+
+#endif
@@ -1,12 +1,19 @@
 #include "simple-web-server/server_http.hpp"
 #include "simple-web-server/utility.hpp"
 #include "torrentManager.h"
+#include "torrentStatusFields.h"
+#include "metricsExporter.h"
+#include "authorizationManager.h"
+#include "responseBody.h"
+#include "fieldMask.h"
+#include "staticAssetCache.h"
 #include "config.h"
 #include "rapidjson/document.h"
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 #include <memory>
+#include <functional>
 
 
 #ifndef REST_API_H
@@ -40,6 +47,12 @@ private:
 	std::unique_ptr<std::thread> server_thread;
 	TorrentManager& torrent_manager;
 	ConfigManager& config;
+	MetricsExporter metrics_exporter;
+	AuthorizationManager authorization_manager;
+	compression_settings compression;
+	StaticAssetCache web_assets;
+	std::uint64_t stream_readahead; // Bytes after the read position whose pieces get deadlines
+	std::chrono::seconds stream_timeout; // How long a stream waits for a piece before giving up
 	void define_resources();
 	std::string torrent_file_path;
 	std::string download_path;
@@ -63,9 +76,31 @@ private:
 								{3260, "could not get torrent settings"},
 								{3270, "could not set torrent settings"},
 								{3280, "could not set program settings"},
-								{3290, "could not set queue position"}};
+								{3290, "could not set queue position"},
+								{3300, "could not find counter"},
+								{3310, "could not stream torrent file"}};
 	bool validate_authorization(std::shared_ptr<HttpServer::Request> const request);
-	std::string stringfy_document(rapidjson::Document const &document, bool const pretty=true);
+	void send_body(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> const request,
+			std::string const &http_status, std::string &http_header, char const *content_type, char const *data, std::size_t size,
+			body_class const type = body_class::api);
+	void send_json(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> const request,
+			rapidjson::Document const &document, std::string const &http_status, std::string &http_header);
+	// Writes the next items and returns true while there is more to write. It should stop once body.is_full().
+	typedef std::function<bool(ValueWriter &writer, ChunkedBodyStream const &body)> body_items_writer;
+	struct chunked_body {
+		ChunkedBodyStream body;
+		std::unique_ptr<ValueWriter> writer;
+		body_items_writer write_items;
+		chunked_body(content_coding const coding, int const level, bool const cbor, body_items_writer write_items);
+	};
+	void send_chunked(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> const request,
+			std::string const &http_status, std::string &http_header, body_items_writer write_items);
+	// Writes the chunk taken from the body, then asks for more items once it was sent
+	void send_chunk(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<chunked_body> chunked, bool const more);
+	bool write_status_columns(ValueWriter &writer, ChunkedBodyStream const &body, TorrentManager::status_delta const &delta,
+			FieldMask const &mask, std::size_t &column, std::size_t &row);
+	void write_status_fields(ValueWriter &writer, Torrent::status_snapshot const &snapshot, std::uint64_t const since,
+			FieldMask const &mask);
 	void respond_invalid_parameter(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> const request,
 		       			std::string const parameter);
 	void respond_invalid_authorization(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> const request);
@@ -73,10 +108,9 @@ private:
 	std::string validate_all_parameters(SimpleWeb::CaseInsensitiveMultimap &query,
 			std::map<std::string, api_parameter> &required_parameters,
 			std::map<std::string, api_parameter> &optional_parameters);
-	bool is_authorization_valid(std::string authorization_base64);
 	bool is_parameter_format_valid(SimpleWeb::CaseInsensitiveMultimap::iterator const it_query, int const parameter_format);
-	std::string decode_basic_auth(std::string authorization_base64);
-	bool accepts_gzip_encoding(SimpleWeb::CaseInsensitiveMultimap &header);
+	content_coding get_content_coding(SimpleWeb::CaseInsensitiveMultimap &header);
+	bool accepts_cbor(SimpleWeb::CaseInsensitiveMultimap &header);
 public:
 	RestAPI(ConfigManager &config, TorrentManager &torrent_manager);
 	~RestAPI();
@@ -84,6 +118,7 @@ public:
 	void stop_server();
 	void torrents_stop(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);	
 	void torrents_files_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);	
+	void torrents_files_stream_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
 	void torrents_peers_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
 	void torrents_trackers_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
 	void torrents_recheck(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);	
@@ -92,6 +127,9 @@ public:
 	void torrents_delete(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
 	void torrents_add(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
 	void program_status_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
+	void metrics_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
+	void program_status_history_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
+	void program_counters_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
 	void program_settings_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
 	void program_settings_set(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
 	void webUI_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
@@ -0,0 +1,55 @@
+#include <libtorrent/entry.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
+#include <sqlite3.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef RESUME_DATA_STORE_H
+#define RESUME_DATA_STORE_H
+
+namespace lt = libtorrent;
+namespace fs = boost::filesystem;
+
+/* Keeps the fastresume data of every torrent as BLOBs in the SQLite database (table fastresume, keyed by info hash).
+ Saves and removals are written on the store's own thread, so the alert loop never waits on disk. Everything that piles up
+ while a batch is being written goes into the next batch, which is one transaction. Jobs are applied in the order they were
+ queued, so removing a torrent always wins over a save queued before it. */
+class ResumeDataStore {
+private:
+	struct job {
+		std::string info_hash;
+		boost::shared_ptr<lt::entry> resume_data; // NULL means the row must be removed
+	};
+
+	std::mutex db_mutex; // Guards the connection and the statements
+	sqlite3 *db;
+	sqlite3_stmt *save_stmt;
+	sqlite3_stmt *remove_stmt;
+
+	std::mutex mutex; // Guards the job queue
+	std::condition_variable wakeup;
+	std::condition_variable idle;
+	std::deque<job> jobs;
+	bool busy;
+	bool stopping;
+	std::thread thread;
+	void run();
+	void write_batch(std::vector<job> &batch);
+	bool execute(char const *sql);
+public:
+	ResumeDataStore();
+	~ResumeDataStore();
+	bool open(fs::path const &database_path);
+	unsigned long int migrate_files(fs::path const &fastresume_path);
+	bool load_all(std::vector<std::vector<char>> &resume_data);
+	void save(std::string const &info_hash, boost::shared_ptr<lt::entry> const resume_data);
+	void remove(std::string const &info_hash);
+	void flush();
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include <libtorrent/session_stats.hpp>
+#include <boost/cstdint.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef SESSION_COUNTERS_H
+#define SESSION_COUNTERS_H
+
+namespace lt = libtorrent;
+
+/* Every counter and gauge libtorrent reports in session_stats_alert. The metric names are resolved once, when the registry is
+ created, so handling a stats sample involves no string lookups. The last sample is published as an immutable snapshot. */
+class SessionCounters {
+public:
+	struct metric {
+		std::string name;
+		int value_index; // Position in session_stats_alert::values and in sample::values
+		bool is_gauge;
+	};
+
+	// rates hold the change per second since the previous sample. They are 0 for gauges and for the first sample.
+	struct sample {
+		std::chrono::steady_clock::time_point time;
+		std::chrono::milliseconds interval;
+		std::vector<boost::int64_t> values;
+		std::vector<double> rates;
+	};
+
+private:
+	std::vector<metric> metrics;
+	std::unordered_map<std::string, std::size_t> by_name;
+	std::shared_ptr<sample const> last_sample;
+public:
+	SessionCounters();
+	std::vector<metric> const &get_metrics() const;
+	metric const *find(std::string const &name) const;
+	int find_index(std::string const &name) const;
+	std::shared_ptr<sample const> update(boost::uint64_t const *values, std::size_t const count,
+			std::chrono::steady_clock::time_point const time);
+	std::shared_ptr<sample const> get_last_sample() const;
+};
+
+#endif
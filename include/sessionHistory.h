@@ -0,0 +1,55 @@
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "sessionStatus.hpp"
+
+#ifndef SESSION_HISTORY_H
+#define SESSION_HISTORY_H
+
+/* Recent SessionStatus samples kept in fixed size ring buffers: one per second for the last hour and one per minute for the
+ last week. All memory is allocated in the constructor. Adding a sample never allocates and only overwrites the oldest one. */
+class SessionHistory {
+public:
+	struct series {
+		char const *name;
+		long SessionStatus::*member;
+		bool is_rate; // Rates are averaged over a minute. Other values keep the last sample of the minute.
+	};
+
+	struct window {
+		int resolution; // Seconds between samples
+		std::vector<std::time_t> times;
+		std::vector<std::vector<long>> values; // One column per series, in the order of get_series()
+	};
+
+	static std::size_t const seconds_capacity = 3600;
+	static std::size_t const minutes_capacity = 10080;
+
+private:
+	struct ring {
+		int resolution;
+		std::size_t capacity;
+		std::size_t head; // Next position to be written
+		std::size_t count;
+		std::vector<std::time_t> times;
+		std::vector<long> values; // capacity rows of get_series().size() values
+		ring(int const resolution, std::size_t const capacity);
+		long *push(std::time_t const time);
+	};
+
+	std::mutex mutex;
+	ring seconds;
+	ring minutes;
+	std::time_t current_minute;
+	std::size_t samples_in_minute;
+	std::vector<long> minute_sums;
+	void flush_minute();
+public:
+	SessionHistory();
+	static std::vector<series> const &get_series();
+	void add(std::time_t const time, SessionStatus const &status);
+	void get_window(window &w, int const resolution, std::time_t const from, std::time_t const to);
+};
+
+#endif
@@ -28,6 +28,11 @@ struct SessionStatus {
 	long num_peers_connected = 0;
 	long num_peers_half_open = 0;
 	long total_peers_connections = 0;
+	// Time between an alert being posted by libtorrent and the alert loop handling it, in microseconds
+	long alerts_handled = 0;
+	long alert_latency_last = 0;
+	long alert_latency_max = 0;
+	long alert_latency_total = 0;
 };
 
 #endif
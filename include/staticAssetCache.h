@@ -0,0 +1,54 @@
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#ifndef STATIC_ASSET_CACHE_H
+#define STATIC_ASSET_CACHE_H
+
+namespace fs = boost::filesystem;
+
+/* Files under a root directory (the web UI) held in memory with a gzip copy made ahead of time. The table is never modified
+ after being published, so readers take it without locking, like SharedTorrentRegistry. It is loaded on the first lookup and
+ reloaded when a lookup finds that check_interval passed and a file was added, removed or changed on disk. A file counts as
+ changed when its size, inode or mtime, to the nanosecond, differ, so a rewrite within the same second is still noticed. */
+class StaticAssetCache {
+public:
+	struct file_version {
+		std::uintmax_t size;
+		std::uintmax_t inode;
+		std::int64_t modified_ns;
+		bool operator==(file_version const &other) const;
+	};
+	struct asset {
+		std::string body;
+		std::string gzip_body; // Empty if gzip would not make the body smaller
+		std::string etag; // Strong ETag of body, quoted
+		std::string gzip_etag; // Strong ETag of gzip_body
+		std::string content_type;
+		bool immutable; // The file name has a content hash, so it never changes under the same name
+		file_version version;
+	};
+	typedef std::unordered_map<std::string, std::shared_ptr<asset const>> asset_table;
+
+private:
+	fs::path const root;
+	std::chrono::steady_clock::duration const check_interval;
+	std::shared_ptr<asset_table const> table;
+	std::mutex reload_mutex;
+	std::chrono::steady_clock::time_point next_check;
+	void reload_if_changed();
+
+public:
+	StaticAssetCache(fs::path const root, std::chrono::steady_clock::duration const check_interval = std::chrono::seconds(2));
+	/* path is the request path. A directory resolves to its index.html. Returns NULL if there is no such file, so nothing
+	 outside root can be reached. */
+	std::shared_ptr<asset const> find(std::string const &path);
+	// Rescans root now and reads the files that changed. Returns false if root could not be read.
+	bool reload();
+};
+
+#endif
@@ -2,7 +2,13 @@
 #include <boost/asio/ip/address.hpp>
 #include <libtorrent/torrent_status.hpp>
 #include <libtorrent/announce_entry.hpp>
+#include <libtorrent/torrent_info.hpp>
+#include <libtorrent/peer_info.hpp>
+#include <libtorrent/add_torrent_params.hpp>
 #include <boost/optional.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 
 #ifndef TORRENT_H
 #define TORRENT_H
@@ -32,16 +38,49 @@ public:
 		std::string path;
 	};
 
+	/* The files of a torrent as libtorrent hands them out, one vector per property, so they can be read by index without
+	 copying every name and path. info is NULL until the metadata arrives. */
+	struct file_listing {
+		boost::shared_ptr<const lt::torrent_info> info;
+		std::vector<boost::int64_t> progress;
+		std::vector<int> priorities;
+		int num_files() const { return info ? info->num_files() : 0; }
+	};
+
 	// TODO - those fields should be pointers to the properties, and not copies
 	struct torrent_settings {
 		boost::optional<int> upload_limit;
 		boost::optional<int> download_limit;
 		boost::optional<bool> sequential_download;
 	};
+
+	/* Last known state of the torrent. Never modified after being published, so readers can hold on to it without locking.
+	 sequence is the change sequence of the last update that changed any field, and field_sequences holds the same for each
+	 field in get_torrent_status_fields(). Both are 0/empty while the torrent was not updated by the alert loop yet. */
+	struct status_snapshot {
+		lt::torrent_status status;
+		int download_limit; // -1 means unlimited
+		int upload_limit;
+		std::string info_hash;
+		std::uint64_t sequence;
+		std::vector<std::uint64_t> field_sequences;
+	};
+
+	// Only what the API reports is queried. Pieces bitfields and torrent_info are expensive and never needed here.
+	static std::uint32_t const status_query_flags = lt::torrent_handle::query_name |
+		lt::torrent_handle::query_save_path |
+		lt::torrent_handle::query_distributed_copies |
+		lt::torrent_handle::query_last_seen_complete |
+		lt::torrent_handle::query_accurate_download_counters;
 	
 private:
 	lt::torrent_handle handle;
 	unsigned long int const id; // TODO - ID should be uint64_t
+	lt::sha1_hash const info_hash;
+	std::shared_ptr<status_snapshot const> cached_status;
+	std::atomic<int> download_limit;
+	std::atomic<int> upload_limit;
+	bool publish_status(lt::torrent_status const &status, std::uint64_t const sequence);
 public:
 	torrent_settings get_torrent_settings();
 	void set_torrent_settings(torrent_settings const ts);
@@ -49,12 +88,22 @@ public:
 	void set_handle(lt::torrent_handle handle);
 	lt::torrent_handle &get_handle();
 	unsigned long int const get_id();
-	Torrent(unsigned long int const id);
+	lt::sha1_hash const &get_info_hash();
+	Torrent(unsigned long int const id, lt::sha1_hash const info_hash);
 	~Torrent();
-	std::vector<Torrent::torrent_file> get_torrent_files(bool const piece_granularity);
-	std::vector<Torrent::torrent_peer> get_torrent_peers();
+	// progress and priority are left at 0 when they were not asked for, which saves a call into the session for each
+	file_listing get_file_listing(bool const piece_granularity, bool const query_progress = true, bool const query_priority = true);
+	// Returns false if the handle is not valid anymore
+	bool get_peer_info(std::vector<lt::peer_info> &peers);
 	std::vector<lt::announce_entry> get_torrent_trackers();
 	lt::torrent_status get_torrent_status();
+	std::shared_ptr<status_snapshot const> get_status_snapshot();
+	void seed_status(lt::add_torrent_params const &params, std::uint64_t const sequence);
+	// From the last status the alert loop reported, without asking the session. False until there is one.
+	bool is_paused();
+	bool update_status(lt::torrent_status const &status, std::uint64_t const sequence);
+	bool update_limits(std::uint64_t const sequence);
+	void set_limits(int const download_limit, int const upload_limit);
 	boost::shared_ptr<const lt::torrent_info> get_torrent_info();
 	void set_queue_position(std::string const queue_position);
 };
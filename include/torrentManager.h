@@ -11,9 +11,22 @@
 #include <libtorrent/announce_entry.hpp>
 #include <boost/filesystem.hpp>
 #include "torrent.h"
+#include "torrentRegistry.h"
 #include "config.h"
 #include "sessionStatus.hpp"
+#include "sessionCounters.h"
+#include "sessionHistory.h"
+#include "resumeDataStore.h"
+#include "fastresumeLoader.h"
+#include "pieceWaiter.h"
+#include "pieceDeadlines.h"
+#include "torrentStream.h"
 #include <libtorrent/settings_pack.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <mutex>
 
 #ifndef TORRENT_MANAGER_H
 #define TORRENT_MANAGER_H
@@ -22,49 +35,139 @@ namespace lt = libtorrent;
 namespace fs = boost::filesystem;
 
 class TorrentManager {
-	
+public:
+	// Answer to a status poll. Only torrents (and fields) that changed after the requested sequence are in it, unless full is set.
+	struct status_delta {
+		std::uint64_t sequence;
+		bool full;
+		std::vector<unsigned long int> ids;
+		std::vector<std::shared_ptr<Torrent::status_snapshot const>> torrents_status;
+		std::vector<unsigned long int> removed_ids;
+	};
+
 private:
+	static std::size_t const max_removed_torrents = 10000;
 	lt::session session;
-	std::vector<std::shared_ptr<Torrent>> torrents;
+	SharedTorrentRegistry torrents;
 	unsigned long int greatest_id;
-	unsigned long int outstanding_resume_data;
+	unsigned long int outstanding_resume_data; // Only used by the alert loop
+	ResumeDataStore resume_data_store;
+	static std::size_t const fastresume_batch_size = 256;
+	FastresumeLoader fastresume_loader;
+	bool decode_fastresume(std::vector<char> &fastresume_buffer, lt::add_torrent_params &atp);
 	lt::add_torrent_params read_resume_data(lt::bdecode_node const& rd, lt::error_code& ec);
 	ConfigManager &config;
 	SessionStatus session_status;
-	std::chrono::steady_clock::time_point interval_last_point = std::chrono::steady_clock::now();
+	std::mutex session_status_mutex;
+	SessionCounters session_counters;
+	SessionHistory session_history;
+	// Positions in SessionCounters::sample of the counters SessionStatus is made of. Resolved once, in the constructor.
+	struct session_status_indexes {
+		int has_incoming_connections;
+		int sent_bytes;
+		int recv_bytes;
+		int sent_ip_overhead_bytes;
+		int recv_ip_overhead_bytes;
+		int dht_bytes_out;
+		int dht_bytes_in;
+		int dht_nodes;
+		int sent_tracker_bytes;
+		int recv_tracker_bytes;
+		int sent_payload_bytes;
+		int recv_payload_bytes;
+		int num_peers_connected;
+		int num_peers_half_open;
+	} status_indexes;
+	void update_session_status(SessionCounters::sample const &sample);
+	/* Change sequence of the last alert batch that changed any torrent status. Everything published with a sequence up to
+	 this one is visible to whoever reads it. */
+	std::atomic<std::uint64_t> status_sequence;
+	std::mutex removed_torrents_mutex;
+	std::deque<std::pair<std::uint64_t, unsigned long int>> removed_torrents; // (sequence, id), oldest first
+	std::uint64_t removed_torrents_floor; // Removals up to this sequence were dropped from removed_torrents
+	std::mutex limits_changed_mutex;
+	std::vector<std::shared_ptr<Torrent>> limits_changed;
+	PieceWaiter piece_waiter;
+	PieceDeadlines piece_deadlines; // Shared by every stream, so they do not cancel each other's deadlines
+	/* Torrents added during a bulk load go into one private copy of the registry over several alert batches. It is published
+	 once no add is outstanding, once it holds registry_batch_size new torrents or after registry_batch_delay, so loading N
+	 torrents does not copy the registry N times. Only used by the alert loop. */
+	static std::size_t const registry_batch_size = 1024;
+	static std::chrono::steady_clock::duration const registry_batch_delay;
+	std::shared_ptr<TorrentRegistry> pending_torrents;
+	std::size_t pending_adds;
+	bool pending_status_change;
+	std::chrono::steady_clock::time_point pending_since;
+	std::atomic<unsigned long int> adds_in_flight; // async_add_torrent calls whose add_torrent_alert did not arrive yet
+	void async_add(lt::add_torrent_params const &atp);
+	/* The fastresume loader waits while max_adds_in_flight adds are outstanding, so their add_torrent_alerts always fit in the
+	 alert queue (at least min_alert_queue_size) and none is dropped. The add_torrent_alert handler wakes it. */
+	static unsigned long int const max_adds_in_flight = 500;
+	static int const min_alert_queue_size = 10000;
+	std::mutex adds_in_flight_mutex;
+	std::condition_variable add_done;
+	bool loading_stopped;
+	void wait_for_add_slot();
+	void apply_alert_queue_size();
+	/* The periodic status and stats jobs only run while a torrent is not paused or someone asked for status in the last
+	 listener_linger. timer_wakeup restarts them when that changes while they are parked. */
+	static std::chrono::steady_clock::duration const listener_linger;
+	std::mutex timer_wakeup_mutex;
+	std::function<void()> timer_wakeup;
+	std::atomic<bool> updates_parked;
+	std::atomic<std::chrono::steady_clock::rep> last_listener;
+	void wake_timers();
+	void note_listener();
 public:
 	TorrentManager(ConfigManager &config);
 	~TorrentManager();
 	void add_torrent_async(const lt::add_torrent_params &atp);
 	void check_alerts(lt::alert *a = NULL);
 	void update_torrent_console_view();
-	unsigned long int get_torrents_status(std::vector<lt::torrent_status> &torrents_status, std::vector<unsigned long int> ids);
+	unsigned long int get_torrents_status(std::vector<std::shared_ptr<Torrent::status_snapshot const>> &torrents_status, std::vector<unsigned long int> ids);
+	unsigned long int get_torrents_status_delta(status_delta &delta, std::vector<unsigned long int> ids, std::uint64_t const since);
+	std::uint64_t get_status_sequence();
 	unsigned long int const generate_torrent_id();
 	unsigned long int remove_torrent(const std::vector<unsigned long int> ids, bool remove_data);
 	unsigned long int stop_torrents(const std::vector<unsigned long int> ids, bool force_stop);
 	std::vector<unsigned long int> get_all_ids();
-	unsigned long int get_files_torrents(std::vector<std::vector<Torrent::torrent_file>> &torrent_files, const std::vector<unsigned long int> ids, bool piece_granularity);
-	unsigned long int get_peers_torrents(std::vector<std::vector<Torrent::torrent_peer>> &torrent_peers, const std::vector<unsigned long int> ids);
+	// Returns the first id that was not found, or 0. Lets callers walk big per-torrent lists one torrent at a time.
+	unsigned long int find_torrents(std::vector<std::shared_ptr<Torrent>> &found, const std::vector<unsigned long int> ids);
 	unsigned long int get_trackers_torrents(std::vector<std::vector<lt::announce_entry>> &torrent_trackers, const std::vector<unsigned long int> ids);
 	unsigned long int get_settings_torrents(std::vector<Torrent::torrent_settings> &torrent_settings, const std::vector<unsigned long int> ids);
 	unsigned long int get_status_torrents(std::vector<lt::torrent_status> &torrent_status, const std::vector<unsigned long int> ids);
 	unsigned long int recheck_torrents(const std::vector<unsigned long int> ids);
 	unsigned long int start_torrents(const std::vector<unsigned long int> ids);	
 	lt::alert const* wait_for_alert(lt::time_duration max_wait);
+	void set_alert_notify(std::function<void()> const &notify);
+	// wakeup restarts parked timers. See EventLoop::wake_timers().
+	void set_timer_wakeup(std::function<void()> const &wakeup);
+	bool needs_updates();
+	bool has_piece_waiters();
 	bool save_session_state();
 	bool load_session_state();
-	void save_fastresume(int resume_flags = lt::torrent_handle::save_info_dict);
+	void save_fastresume(int resume_flags = lt::torrent_handle::save_info_dict, bool const only_if_needed = true);
+	void wait_for_fastresume(std::chrono::seconds const timeout);
 	void load_fastresume();
+	void stop_loading_fastresume();
+	FastresumeLoader::progress get_fastresume_progress();
 	void pause_session();
 	void load_session_settings();
 	void load_session_extensions();
 	void post_session_stats();
+	void post_torrent_updates();
 	SessionStatus const get_session_status();
+	SessionCounters const &get_session_counters();
+	SessionHistory &get_session_history();
 	lt::settings_pack const get_session_settings();
 	unsigned long int get_torrents_info(std::vector<boost::shared_ptr<const lt::torrent_info>> &torrents_info, const std::vector<unsigned long int> ids);
 	unsigned long int set_settings_torrents(std::vector<Torrent::torrent_settings> &torrent_settings, const std::vector<unsigned long int> ids);
 	unsigned long int set_session_settings(lt::settings_pack const &pack);
 	unsigned long int set_session_queue(std::string const queue_position, const std::vector<unsigned long int> ids);
+	// NULL if there is no such torrent, its metadata did not arrive yet or it has no such file
+	std::shared_ptr<TorrentStream> open_stream(unsigned long int const id, int const file, std::uint64_t const readahead,
+			std::chrono::steady_clock::duration const timeout);
+	void expire_piece_waiters();
 };
 
 #endif
@@ -0,0 +1,60 @@
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <cstring>
+#include "torrent.h"
+
+#ifndef TORRENT_REGISTRY_H
+#define TORRENT_REGISTRY_H
+
+namespace lt = libtorrent;
+
+// Info hashes are SHA-1 digests, so any 8 bytes of it are already uniformly distributed
+struct info_hash_hasher {
+	std::size_t operator()(lt::sha1_hash const &info_hash) const {
+		std::size_t h;
+		std::memcpy(&h, info_hash.data(), sizeof(h));
+		return h;
+	}
+};
+
+/* Stores the torrents known by the TorrentManager. Lookups by id and by info hash and removals are O(1).
+ Iteration follows the order in which the torrents were inserted, so listings are stable between calls. */
+class TorrentRegistry {
+private:
+	typedef std::list<std::shared_ptr<Torrent>> torrent_list;
+	torrent_list torrents;
+	std::unordered_map<unsigned long int, torrent_list::iterator> by_id;
+	std::unordered_map<lt::sha1_hash, torrent_list::iterator, info_hash_hasher> by_info_hash;
+public:
+	typedef torrent_list::const_iterator const_iterator;
+	TorrentRegistry();
+	TorrentRegistry(TorrentRegistry const &other);
+	TorrentRegistry& operator=(TorrentRegistry const &other);
+	bool insert(std::shared_ptr<Torrent> const torrent);
+	bool erase(unsigned long int const id);
+	bool erase(lt::sha1_hash const &info_hash);
+	std::shared_ptr<Torrent> find(unsigned long int const id) const;
+	std::shared_ptr<Torrent> find(lt::sha1_hash const &info_hash) const;
+	unsigned long int find_all(std::vector<std::shared_ptr<Torrent>> &found, std::vector<unsigned long int> const &ids) const;
+	std::vector<unsigned long int> get_all_ids() const;
+	std::size_t size() const;
+	bool empty() const;
+	const_iterator begin() const;
+	const_iterator end() const;
+};
+
+/* Holds the current version of the TorrentRegistry. Readers (e.g. the REST API threads) take a snapshot without locking
+ and may keep using it for as long as they want. Versions are never modified after being published: the single writer
+ (the alert loop) edits a private copy and publishes it, so readers never block the writer and the writer never waits for readers. */
+class SharedTorrentRegistry {
+private:
+	std::shared_ptr<TorrentRegistry const> current;
+public:
+	SharedTorrentRegistry();
+	std::shared_ptr<TorrentRegistry const> snapshot() const;
+	std::shared_ptr<TorrentRegistry> copy() const;
+	void publish(std::shared_ptr<TorrentRegistry const> const registry);
+};
+
+#endif
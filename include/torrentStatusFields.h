@@ -0,0 +1,44 @@
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "torrent.h"
+
+#ifndef TORRENT_STATUS_FIELDS_H
+#define TORRENT_STATUS_FIELDS_H
+
+class ValueWriter;
+
+// A single status field read from a Torrent::status_snapshot. Strings point into the snapshot they were read from.
+struct status_field_value {
+	enum value_type {
+		int_value,
+		double_value,
+		bool_value,
+		string_value
+	};
+	value_type type;
+	boost::int64_t int_number;
+	double double_number;
+	bool boolean;
+	std::string const *text;
+
+	status_field_value(int const value);
+	status_field_value(boost::int64_t const value);
+	status_field_value(double const value);
+	status_field_value(bool const value);
+	status_field_value(std::string const &value);
+	bool operator==(status_field_value const &other) const;
+	bool operator!=(status_field_value const &other) const;
+};
+
+struct status_field {
+	char const *name;
+	status_field_value (*get)(Torrent::status_snapshot const &snapshot);
+};
+
+/* Every field reported by GET /v1.0/torrents/status, in the order they are reported. The position of a field in this table
+ is its index in Torrent::status_snapshot::field_sequences. */
+std::vector<status_field> const &get_torrent_status_fields();
+void write_status_value(ValueWriter &writer, status_field_value const &value);
+
+#endif
@@ -0,0 +1,69 @@
+#include <libtorrent/torrent_handle.hpp>
+#include <libtorrent/torrent_info.hpp>
+#include <boost/shared_array.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "pieceWaiter.h"
+#include "pieceDeadlines.h"
+
+#ifndef TORRENT_STREAM_H
+#define TORRENT_STREAM_H
+
+namespace lt = libtorrent;
+
+/* Reads one file of a torrent while it is being downloaded. Positions in the file are mapped to pieces with map_file(). The
+ pieces from the read position up to readahead bytes after it get deadlines, so libtorrent downloads them before anything
+ else. The window follows the reads, and a read elsewhere (a seek) drops the deadlines of the pieces it left, unless another
+ stream of the torrent still holds them. Pieces are read through libtorrent, which posts them as read_piece_alerts once they
+ are downloaded and checked. The last piece read is kept, so the many small reads a player makes inside one piece only cost
+ one read_piece. */
+class TorrentStream : public std::enable_shared_from_this<TorrentStream> {
+public:
+	// data is NULL if the piece was not available in time. Otherwise it points to the next size bytes of the file, in piece.
+	typedef std::function<void(boost::shared_array<char> const &piece, char const *data, std::size_t const size)> read_handler;
+
+private:
+	// Deadline of each piece in the window relative to the one before it
+	static int const deadline_step_ms = 250;
+	// How often a piece that did not arrive is asked for again, in case its request was lost (e.g. to another stream's seek)
+	static std::chrono::steady_clock::duration const retry_interval;
+
+	lt::torrent_handle handle;
+	boost::shared_ptr<const lt::torrent_info> const info;
+	unsigned long int const id;
+	int const file;
+	PieceWaiter &waiter;
+	PieceDeadlines &deadlines;
+	std::uint64_t const readahead;
+	std::chrono::steady_clock::duration const timeout;
+	int window_first; // -1 while there is no window
+	int window_last;
+	std::mutex window_mutex; // Reads of one stream may come from several threads
+	std::mutex cache_mutex; // Filled on the alert loop thread
+	int cached_piece; // -1 while nothing is cached
+	boost::shared_array<char> cached_data;
+	int cached_size;
+	bool find_cached(int const piece, boost::shared_array<char> &data, int &size);
+	void cache(int const piece, boost::shared_array<char> const &data, int const size);
+	int get_piece(std::uint64_t const position) const;
+	void move_window(int const first, int const last);
+	void wait_for_piece(int const piece, int const start, int const length, std::chrono::steady_clock::time_point const give_up,
+			read_handler const handler);
+
+public:
+	TorrentStream(lt::torrent_handle const &handle, boost::shared_ptr<const lt::torrent_info> const info, unsigned long int const id,
+			int const file, PieceWaiter &waiter, PieceDeadlines &deadlines, std::uint64_t const readahead,
+			std::chrono::steady_clock::duration const timeout);
+	~TorrentStream();
+	std::uint64_t size() const;
+	std::string get_name() const;
+	lt::sha1_hash get_info_hash() const;
+	/* Reads at most max bytes at position, never past the end of its piece. handler is called on the alert loop thread, or
+	 right away when the piece is the one read last. */
+	void read(std::uint64_t const position, std::uint64_t const max, read_handler const handler);
+};
+
+#endif
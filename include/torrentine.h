@@ -12,7 +12,7 @@ std::unordered_map<std::string, plog::Severity> map_log_severity({{"none",plog::
 					{"info",plog::Severity::info},
 					{"debug",plog::Severity::debug},
 					{"verbose",plog::Severity::verbose}});
-void shutdown_program(int s);
+bool is_console_view_enabled(ConfigManager &config);
 void parse_arguments(int const argc, char const* argv[], fs::path &config_file); 
 bool initialize_log(ConfigManager &config);
 void add_test_torrents(TorrentManager &torrent_manager, ConfigManager &config);
@@ -0,0 +1,295 @@
+#include "authorizationManager.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "utility.h"
+#include "cpp-base64/base64.h"
+#include "plog/Log.h"
+
+namespace {
+
+// Strings of different sizes are told apart right away. Only the content is compared in constant time.
+bool equal_constant_time(std::string const &a, std::string const &b) {
+	return a.size() == b.size() && CRYPTO_memcmp(a.data(), b.data(), a.size()) == 0;
+}
+
+}
+
+AuthorizationManager::AuthorizationManager(std::chrono::steady_clock::duration const cache_ttl,
+		std::size_t const max_cached_credentials) : cache_ttl(cache_ttl), max_cached_credentials(max_cached_credentials),
+	cache_enabled(true), db(NULL), user_stmt(NULL), users_version_stmt(NULL), token_lifetime(0) {
+	if(RAND_bytes(cache_key, sizeof(cache_key)) != 1) {
+		LOG_ERROR << "Could not generate authorization cache key. Credentials will not be cached";
+		cache_enabled = false;
+	}
+}
+
+AuthorizationManager::~AuthorizationManager() {
+	sqlite3_finalize(user_stmt);
+	sqlite3_finalize(users_version_stmt);
+	sqlite3_close(db);
+}
+
+bool AuthorizationManager::open(fs::path const &database_path) {
+	std::lock_guard<std::mutex> lock(db_mutex);
+	if(sqlite3_open(database_path.string().c_str(), &db) != SQLITE_OK) {
+		LOG_ERROR << "Could not open database " << database_path.string() << ". SQLite3 error_msg: " << sqlite3_errmsg(db);
+		sqlite3_close(db);
+		db = NULL;
+		return false;
+	}
+	sqlite3_busy_timeout(db, 5000);
+
+	// Writes to other tables, like the resume data, leave users_version alone
+	char const *users_version_schema =
+		"create table if not exists users_version (id integer primary key check (id = 0), version integer not null);"
+		"insert or ignore into users_version (id, version) values (0, 0);"
+		"create trigger if not exists users_version_insert after insert on users begin "
+			"update users_version set version = version + 1; end;"
+		"create trigger if not exists users_version_update after update on users begin "
+			"update users_version set version = version + 1; end;"
+		"create trigger if not exists users_version_delete after delete on users begin "
+			"update users_version set version = version + 1; end;";
+	char *error_msg = NULL;
+	bool const has_users_version = sqlite3_exec(db, users_version_schema, NULL, NULL, &error_msg) == SQLITE_OK;
+	if(!has_users_version) {
+		LOG_ERROR << "Could not create users_version triggers. Cached credentials will be checked against their rows. "
+			"SQLite3 error_msg: " << error_msg;
+		sqlite3_free(error_msg);
+	}
+
+	char const *user_sql = "select id,username,password,salt from users where username = ?";
+	if(sqlite3_prepare_v2(db, user_sql, -1, &user_stmt, NULL) != SQLITE_OK) {
+		LOG_ERROR << "Could not compile SQL for authorization. SQLite3 error_msg: " << sqlite3_errmsg(db);
+		sqlite3_finalize(user_stmt);
+		user_stmt = NULL;
+		sqlite3_close(db);
+		db = NULL;
+		return false;
+	}
+	// Without the triggers the version would never move, so it is not read at all
+	char const *users_version_sql = "select version from users_version where id = 0";
+	if(has_users_version && sqlite3_prepare_v2(db, users_version_sql, -1, &users_version_stmt, NULL) != SQLITE_OK) {
+		sqlite3_finalize(users_version_stmt);
+		users_version_stmt = NULL;
+	}
+	return true;
+}
+
+void AuthorizationManager::clear_cache() {
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	cache.clear();
+}
+
+// authorization is the value of the Authorization header, either "Basic <credentials>" or "Bearer <token>"
+bool AuthorizationManager::is_authorization_valid(std::string const &authorization) {
+	std::string const bearer = "Bearer ";
+	if(authorization.compare(0, bearer.size(), bearer) == 0)
+		return is_token_valid(authorization.substr(bearer.size()));
+	return is_basic_authorization_valid(authorization);
+}
+
+/* A cached header is accepted after one read of users_version, unless the users table changed since it was cached. In that
+ case its row is read again, which is still much cheaper than PBKDF2. */
+bool AuthorizationManager::is_basic_authorization_valid(std::string const &authorization) {
+	std::string const header_hash = cache_enabled ? hash_header(authorization) : std::string();
+	if(cache_enabled) {
+		bool cached = false;
+		cached_credential credential;
+		{
+			std::lock_guard<std::mutex> lock(cache_mutex);
+			std::unordered_map<std::string, cached_credential>::iterator it = cache.find(header_hash);
+			if(it != cache.end()) {
+				if(it->second.expiry > std::chrono::steady_clock::now()) {
+					credential = it->second;
+					cached = true;
+				}
+				else {
+					cache.erase(it);
+				}
+			}
+		}
+
+		if(cached) {
+			std::int64_t const users_version = get_users_version();
+			if(users_version >= 0 && users_version == credential.users_version)
+				return true;
+
+			user_row row;
+			std::int64_t row_users_version;
+			if(find_user(credential.username, row, row_users_version) &&
+					equal_constant_time(row.password_hash, credential.password_hash) &&
+					equal_constant_time(row.salt, credential.salt)) {
+				std::lock_guard<std::mutex> lock(cache_mutex);
+				std::unordered_map<std::string, cached_credential>::iterator it = cache.find(header_hash);
+				if(it != cache.end())
+					it->second.users_version = row_users_version;
+				return true;
+			}
+
+			// The user was removed or changed password. The header must be verified from scratch.
+			std::lock_guard<std::mutex> lock(cache_mutex);
+			cache.erase(header_hash);
+		}
+	}
+
+	std::string const decoded = decode_basic_auth(authorization);
+	if(decoded.size() == 0) {
+		return false;
+	}
+	std::vector<std::string> user_pass = split_string(decoded, ':');
+	if(user_pass.size() != 2) {
+		return false;
+	}
+	std::string const &username = user_pass.at(0);
+	std::string const &password = user_pass.at(1);
+
+	user_row row;
+	std::int64_t users_version;
+	if(!find_user(username, row, users_version)) {
+		LOG_DEBUG << "Authorization for user " << username << " denied." << " User not found in database.";
+		return false;
+	}
+
+	std::string const password_hash = generate_password_hash(password.c_str(), (unsigned char*)row.salt.c_str());
+	if(!equal_constant_time(password_hash, row.password_hash)) {
+		LOG_DEBUG << "Authorization for user " << username << " denied." << " Wrong password.";
+		return false;
+	}
+
+	LOG_DEBUG << "Authorization for user " << username << " allowed.";
+	if(cache_enabled)
+		cache_credential(header_hash, row, users_version);
+	return true;
+}
+
+// Returns -1 if the version could not be read, which makes every cached credential be checked against its row
+std::int64_t AuthorizationManager::get_users_version() {
+	std::lock_guard<std::mutex> lock(db_mutex);
+	if(!db || !users_version_stmt)
+		return -1;
+	std::int64_t users_version = -1;
+	if(sqlite3_step(users_version_stmt) == SQLITE_ROW)
+		users_version = sqlite3_column_int64(users_version_stmt, 0);
+	sqlite3_reset(users_version_stmt);
+	return users_version;
+}
+
+// users_version is read before the row, so a change made in between is noticed on the next check
+bool AuthorizationManager::find_user(std::string const &username, user_row &row, std::int64_t &users_version) {
+	users_version = get_users_version();
+	std::lock_guard<std::mutex> lock(db_mutex);
+	if(!db) {
+		LOG_ERROR << "Authorization for user " << username << " denied. The database is not open";
+		return false;
+	}
+
+	int ret_code = 0;
+	bool found = false;
+	sqlite3_bind_text(user_stmt, 1, username.c_str(), username.size(), SQLITE_STATIC);
+	while((ret_code = sqlite3_step(user_stmt)) == SQLITE_ROW) {
+		row.username = reinterpret_cast<const char*>(sqlite3_column_text(user_stmt, 1));
+		row.password_hash = reinterpret_cast<const char*>(sqlite3_column_text(user_stmt, 2));
+		row.salt = reinterpret_cast<const char*>(sqlite3_column_text(user_stmt, 3));
+		found = true;
+	}
+	if(ret_code != SQLITE_DONE) {
+		LOG_ERROR << "Problem while reading user " << username << ". SQLite3 error_msg: " << sqlite3_errmsg(db);
+	}
+	sqlite3_reset(user_stmt);
+	sqlite3_clear_bindings(user_stmt);
+	return found;
+}
+
+std::string AuthorizationManager::hash_header(std::string const &authorization) const {
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digest_size = 0;
+	HMAC(EVP_sha256(), cache_key, sizeof(cache_key), reinterpret_cast<unsigned char const*>(authorization.data()),
+			authorization.size(), digest, &digest_size);
+	return std::string(reinterpret_cast<char const*>(digest), digest_size);
+}
+
+// When the cache is full, expired entries are dropped first. If none expired, the whole cache starts over.
+void AuthorizationManager::cache_credential(std::string const &header_hash, user_row const &row, std::int64_t const users_version) {
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+	if(cache.size() >= max_cached_credentials) {
+		for(std::unordered_map<std::string, cached_credential>::iterator it = cache.begin(); it != cache.end();) {
+			if(it->second.expiry <= now)
+				it = cache.erase(it);
+			else
+				++it;
+		}
+		if(cache.size() >= max_cached_credentials)
+			cache.clear();
+	}
+	cache[header_hash] = cached_credential{row.username, row.password_hash, row.salt, now + cache_ttl, users_version};
+}
+
+// Tokens can not be issued until a secret is set. An empty secret disables them.
+void AuthorizationManager::configure_tokens(std::string const &secret, std::chrono::seconds const lifetime) {
+	token_secret = secret;
+	token_lifetime = lifetime;
+}
+
+std::chrono::seconds AuthorizationManager::get_token_lifetime() const {
+	return token_lifetime;
+}
+
+/* A token is base64("<username>:<expiry>") "." base64(HMAC-SHA256(secret, "<username>:<expiry>")), with expiry in seconds since
+ the epoch. Nothing is stored, so a token stays valid until it expires, even if the user changes password. Returns an empty
+ string if tokens are disabled. */
+std::string AuthorizationManager::issue_token(std::string const &username, std::time_t const now) {
+	if(token_secret.empty())
+		return std::string();
+	std::string const payload = username + ":" + std::to_string(now + token_lifetime.count());
+	return base64_encode(reinterpret_cast<unsigned char const*>(payload.data()), payload.size()) + "." + sign_token(payload);
+}
+
+bool AuthorizationManager::is_token_valid(std::string const &token, std::time_t const now) {
+	if(token_secret.empty())
+		return false;
+	std::size_t const dot = token.find('.');
+	if(dot == std::string::npos)
+		return false;
+	std::string const payload = base64_decode(token.substr(0, dot));
+	if(!equal_constant_time(sign_token(payload), token.substr(dot + 1)))
+		return false;
+
+	// The payload is signed by us, so it is well formed
+	std::size_t const colon = payload.rfind(':');
+	if(colon == std::string::npos)
+		return false;
+	try {
+		return std::stoll(payload.substr(colon + 1)) > now;
+	}
+	catch(std::exception const &e) {
+		return false;
+	}
+}
+
+std::string AuthorizationManager::sign_token(std::string const &payload) const {
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digest_size = 0;
+	HMAC(EVP_sha256(), token_secret.data(), token_secret.size(), reinterpret_cast<unsigned char const*>(payload.data()),
+			payload.size(), digest, &digest_size);
+	return base64_encode(digest, digest_size);
+}
+
+std::string decode_basic_auth(std::string const &authorization) {
+	std::stringstream ss(authorization);
+	std::string s;
+	char delim = ' ';
+
+	getline(ss, s, delim);
+	if(s != "Basic") {
+		return std::string("");
+	}
+
+	getline(ss, s, delim);
+	return base64_decode(s);
+}
@@ -0,0 +1,140 @@
+#include "byteRanges.h"
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+namespace {
+
+// Ranges separated by less than this are cheaper to send as one part than as two
+std::uint64_t const merge_gap = 80;
+
+std::string trim(std::string const &s) {
+	std::size_t const begin = s.find_first_not_of(" \t");
+	if(begin == std::string::npos)
+		return std::string();
+	return s.substr(begin, s.find_last_not_of(" \t") - begin + 1);
+}
+
+// Only digits, and no overflow
+bool parse_position(std::string const &s, std::uint64_t &position) {
+	if(s.empty())
+		return false;
+	position = 0;
+	for(char const c : s) {
+		if(!std::isdigit(static_cast<unsigned char>(c)))
+			return false;
+		std::uint64_t const digit = c - '0';
+		if(position > (std::numeric_limits<std::uint64_t>::max() - digit) / 10)
+			return false;
+		position = position * 10 + digit;
+	}
+	return true;
+}
+
+}
+
+range_request parse_range_header(std::string const &header, std::uint64_t const size, std::vector<byte_range> &ranges) {
+	ranges.clear();
+	std::string const value = trim(header);
+	std::size_t const equals = value.find('=');
+	if(equals == std::string::npos)
+		return range_request::whole;
+	std::string unit = trim(value.substr(0, equals));
+	std::transform(unit.begin(), unit.end(), unit.begin(), ::tolower);
+	if(unit != "bytes")
+		return range_request::whole;
+
+	std::size_t specs = 0;
+	std::size_t position = equals + 1;
+	while(position <= value.size()) {
+		std::size_t comma = value.find(',', position);
+		if(comma == std::string::npos)
+			comma = value.size();
+		std::string const spec = trim(value.substr(position, comma - position));
+		position = comma + 1;
+		// The grammar allows empty elements in a list
+		if(spec.empty())
+			continue;
+		if(++specs > max_byte_ranges)
+			return range_request::whole;
+
+		std::size_t const dash = spec.find('-');
+		if(dash == std::string::npos)
+			return range_request::whole;
+		std::string const first_text = spec.substr(0, dash);
+		std::string const last_text = spec.substr(dash + 1);
+		std::uint64_t first, last;
+		if(first_text.empty()) {
+			// "-n" is the last n bytes
+			if(!parse_position(last_text, last))
+				return range_request::whole;
+			if(last == 0 || size == 0)
+				continue;
+			ranges.push_back({size - std::min(last, size), size - 1});
+		}
+		else {
+			if(!parse_position(first_text, first))
+				return range_request::whole;
+			if(last_text.empty())
+				last = size - 1;
+			else if(!parse_position(last_text, last) || last < first)
+				return range_request::whole;
+			if(first >= size)
+				continue;
+			ranges.push_back({first, std::min(last, size - 1)});
+		}
+	}
+	if(specs == 0)
+		return range_request::whole;
+	if(ranges.empty())
+		return range_request::unsatisfiable;
+
+	std::sort(ranges.begin(), ranges.end(), [](byte_range const &a, byte_range const &b) { return a.first < b.first; });
+	std::vector<byte_range> merged;
+	for(byte_range const &range : ranges) {
+		if(!merged.empty() && range.first <= merged.back().last + merge_gap)
+			merged.back().last = std::max(merged.back().last, range.last);
+		else
+			merged.push_back(range);
+	}
+	ranges.swap(merged);
+	return range_request::partial;
+}
+
+std::string get_content_range(byte_range const &range, std::uint64_t const size) {
+	return "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" + std::to_string(size);
+}
+
+std::string get_unsatisfied_content_range(std::uint64_t const size) {
+	return "bytes */" + std::to_string(size);
+}
+
+bool if_range_matches(std::string const &if_range, std::string const &etag, std::string const &last_modified) {
+	std::string const value = trim(if_range);
+	// A weak ETag never matches
+	if(value.compare(0, 2, "W/") == 0)
+		return false;
+	if(!value.empty() && value[0] == '"')
+		return value == etag;
+	return value == last_modified;
+}
+
+std::string format_http_date(std::time_t const time) {
+	struct tm utc;
+	gmtime_r(&time, &utc);
+	char date[32];
+	std::size_t const length = std::strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+	return std::string(date, length);
+}
+
+std::vector<std::string> get_multipart_separators(std::string const &boundary, std::vector<byte_range> const &ranges,
+		std::uint64_t const size) {
+	std::vector<std::string> separators;
+	for(std::size_t i = 0; i < ranges.size(); i++) {
+		// The CRLF before a boundary belongs to the boundary, so the first one is not needed
+		separators.push_back(std::string(i == 0 ? "" : "\r\n") + "--" + boundary + "\r\nContent-Range: " +
+				get_content_range(ranges[i], size) + "\r\n\r\n");
+	}
+	separators.push_back("\r\n--" + boundary + "--\r\n");
+	return separators;
+}
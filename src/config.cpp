@@ -5,6 +5,7 @@
 #include <fstream>
 
 void ConfigManager::save_config(fs::path const config_file) {
+	std::lock_guard<std::mutex> lock(mutex);
 	std::ofstream out_config_file(config_file.string());
 	if(out_config_file.is_open()) {
 		out_config_file << *config_toml;
@@ -25,7 +26,9 @@ void ConfigManager::load_config(fs::path const config_file) {
 		create_default_config_file(config_file);
 	}
 
-	config_toml = cpptoml::parse_file(config_file.string());
+	std::shared_ptr<cpptoml::table> parsed = cpptoml::parse_file(config_file.string());
+	std::lock_guard<std::mutex> lock(mutex);
+	config_toml = parsed;
 }
 
 bool ConfigManager::create_default_config_file(fs::path const config_file) {
@@ -43,11 +46,20 @@ bool ConfigManager::create_default_config_file(fs::path const config_file) {
 		table_log->insert("severity", "info");
 		table_log->insert("file_path", "log/torrentine-log.txt");
 		table_log->insert("max_size", 5242880);
+		table_log->insert("console_view", "disabled");
 		root->insert("log", table_log);
 				
 		std::shared_ptr<cpptoml::table> table_api = cpptoml::make_table();
 		table_api->insert("port", 8040);
 		table_api->insert("address", "0.0.0.0");
+		table_api->insert("thread_pool_size", 4);
+		table_api->insert("token_lifetime", 3600);
+		table_api->insert("compression_min_size", 1024);
+		table_api->insert("compression_level", 6);
+		table_api->insert("compression_level_listings", 1);
+		table_api->insert("compression_level_text", 6);
+		table_api->insert("stream_readahead", 16777216);
+		table_api->insert("stream_timeout", 60);
 		root->insert("api", table_api);
 		
 		out_config_file << *root;
@@ -0,0 +1,158 @@
+#include "contentEncoding.h"
+#include "utility.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+struct supported_coding {
+	content_coding coding;
+	char const *name;
+};
+
+// In order of preference when q-values tie
+supported_coding const supported_codings[] = {
+#ifdef TORRENTINE_ZSTD
+	{content_coding::zstd, "zstd"},
+#endif
+	{content_coding::gzip, "gzip"},
+	{content_coding::deflate, "deflate"}
+};
+
+std::string trim_lower(std::string const &s) {
+	std::size_t const begin = s.find_first_not_of(" \t");
+	if(begin == std::string::npos)
+		return std::string();
+	std::size_t const end = s.find_last_not_of(" \t");
+	std::string trimmed = s.substr(begin, end - begin + 1);
+	std::transform(trimmed.begin(), trimmed.end(), trimmed.begin(), [](unsigned char c) { return std::tolower(c); });
+	return trimmed;
+}
+
+std::size_t const supported_count = sizeof(supported_codings) / sizeof(supported_codings[0]);
+
+// Sets the q-value of every supported coding, taking the one of * for codings that are not listed. -1 if neither is.
+void get_q_values(std::string const &accept_encoding, double (&q_values)[supported_count]) {
+	std::fill(std::begin(q_values), std::end(q_values), -1.0);
+	double wildcard_q = -1.0;
+
+	for(std::string const &element : split_string(accept_encoding, ',')) {
+		std::vector<std::string> const parameters = split_string(element, ';');
+		if(parameters.empty())
+			continue;
+		std::string const name = trim_lower(parameters[0]);
+		double q = 1.0;
+		for(std::size_t i = 1; i < parameters.size(); i++) {
+			std::string const parameter = trim_lower(parameters[i]);
+			if(parameter.compare(0, 2, "q=") == 0)
+				q = std::atof(parameter.c_str() + 2);
+		}
+
+		if(name == "*") {
+			wildcard_q = q;
+			continue;
+		}
+		for(std::size_t i = 0; i < supported_count; i++) {
+			if(name == supported_codings[i].name)
+				q_values[i] = q;
+		}
+	}
+
+	for(std::size_t i = 0; i < supported_count; i++) {
+		if(q_values[i] < 0.0)
+			q_values[i] = wildcard_q;
+	}
+}
+
+// Specificity is 0 when no range matches, then 1 for */*, 2 for type/* and 3 for the type itself
+double get_media_type_q(std::string const &accept, std::string const &media_type, int &specificity) {
+	std::string const type = media_type.substr(0, media_type.find('/'));
+	double q = 0.0;
+	specificity = 0;
+	for(std::string const &element : split_string(accept, ',')) {
+		std::vector<std::string> const parameters = split_string(element, ';');
+		if(parameters.empty())
+			continue;
+		std::string const range = trim_lower(parameters[0]);
+		int range_specificity = 0;
+		if(range == media_type)
+			range_specificity = 3;
+		else if(range == type + "/*")
+			range_specificity = 2;
+		else if(range == "*/*")
+			range_specificity = 1;
+		if(range_specificity <= specificity)
+			continue;
+		specificity = range_specificity;
+		q = 1.0;
+		for(std::size_t i = 1; i < parameters.size(); i++) {
+			std::string const parameter = trim_lower(parameters[i]);
+			if(parameter.compare(0, 2, "q=") == 0)
+				q = std::atof(parameter.c_str() + 2);
+		}
+	}
+	return q;
+}
+
+}
+
+compression_settings::compression_settings() : min_size(1024), api_level(6), listing_level(1), text_level(6) {
+}
+
+int compression_settings::get_level(body_class const type) const {
+	switch(type) {
+		case body_class::listing:
+			return listing_level;
+		case body_class::text:
+			return text_level;
+		default:
+			return api_level;
+	}
+}
+
+content_coding negotiate_content_coding(std::string const &accept_encoding) {
+	double q_values[supported_count];
+	get_q_values(accept_encoding, q_values);
+	content_coding best = content_coding::identity;
+	double best_q = 0.0;
+	for(std::size_t i = 0; i < supported_count; i++) {
+		if(q_values[i] > best_q) {
+			best = supported_codings[i].coding;
+			best_q = q_values[i];
+		}
+	}
+	return best;
+}
+
+bool accepts_content_coding(std::string const &accept_encoding, content_coding const coding) {
+	if(coding == content_coding::identity)
+		return true;
+	double q_values[supported_count];
+	get_q_values(accept_encoding, q_values);
+	for(std::size_t i = 0; i < supported_count; i++) {
+		if(supported_codings[i].coding == coding)
+			return q_values[i] > 0.0;
+	}
+	return false;
+}
+
+char const *get_content_coding_name(content_coding const coding) {
+	switch(coding) {
+		case content_coding::gzip:
+			return "gzip";
+		case content_coding::deflate:
+			return "deflate";
+		case content_coding::zstd:
+			return "zstd";
+		default:
+			return "identity";
+	}
+}
+
+bool prefers_media_type(std::string const &accept, std::string const &media_type, std::string const &default_type) {
+	int specificity, default_specificity;
+	double const q = get_media_type_q(accept, media_type, specificity);
+	double const default_q = get_media_type_q(accept, default_type, default_specificity);
+	return q > 0.0 && (q > default_q || (q == default_q && specificity > default_specificity));
+}
@@ -0,0 +1,85 @@
+#include "eventLoop.h"
+
+EventLoop::EventLoop() : alerts_pending(false), stopped(false), wakeups(0) {
+}
+
+// The first run of job happens one interval from now
+void EventLoop::add_timer(std::chrono::steady_clock::duration const interval, std::function<void()> const job,
+		std::function<bool()> const armed) {
+	std::lock_guard<std::mutex> lock(mutex);
+	timers.push(timer{std::chrono::steady_clock::now() + interval, interval, job, armed, false});
+	wakeup.notify_one();
+}
+
+void EventLoop::wake_timers() {
+	std::lock_guard<std::mutex> lock(mutex);
+	wakeups++;
+	if(parked.empty())
+		return;
+	std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+	for(timer &parked_timer : parked) {
+		parked_timer.deadline = now;
+		parked_timer.woken = true;
+		timers.push(parked_timer);
+	}
+	parked.clear();
+	wakeup.notify_one();
+}
+
+/* Meant to be the callback given to session::set_alert_notify(). libtorrent calls it from its network thread when the alert
+ queue stops being empty, so it must return quickly and must not call back into the session. */
+void EventLoop::notify() {
+	std::lock_guard<std::mutex> lock(mutex);
+	alerts_pending = true;
+	wakeup.notify_one();
+}
+
+void EventLoop::stop() {
+	std::lock_guard<std::mutex> lock(mutex);
+	stopped = true;
+	wakeup.notify_one();
+}
+
+/* Jobs and the alert handler always run on the calling thread and never while the lock is held, so they may take as long as
+ they need (e.g. saving fastresume) and may add new timers. A job that runs late is not run again to catch up. */
+void EventLoop::run(std::function<void()> const handle_alerts) {
+	std::unique_lock<std::mutex> lock(mutex);
+	while(!stopped) {
+		if(alerts_pending) {
+			alerts_pending = false;
+			lock.unlock();
+			handle_alerts();
+			lock.lock();
+			continue;
+		}
+
+		if(timers.empty()) {
+			wakeup.wait(lock);
+			continue;
+		}
+
+		std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+		if(timers.top().deadline > now) {
+			wakeup.wait_until(lock, timers.top().deadline);
+			continue;
+		}
+
+		timer due = timers.top();
+		timers.pop();
+		std::uint64_t const wakeups_before = wakeups;
+		lock.unlock();
+		bool const run_job = due.woken || !due.armed || due.armed();
+		due.woken = false;
+		if(run_job)
+			due.job();
+		lock.lock();
+		if(!run_job && wakeups == wakeups_before) {
+			parked.push_back(due);
+			continue;
+		}
+		due.deadline += due.interval;
+		if(due.deadline <= std::chrono::steady_clock::now())
+			due.deadline = std::chrono::steady_clock::now() + due.interval;
+		timers.push(due);
+	}
+}
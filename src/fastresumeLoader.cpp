@@ -0,0 +1,77 @@
+#include "fastresumeLoader.h"
+#include <algorithm>
+#include <chrono>
+#include "plog/Log.h"
+
+FastresumeLoader::FastresumeLoader() : total(0), loaded(0), failed(0), finished(false), stopping(false) {
+}
+
+FastresumeLoader::~FastresumeLoader() {
+	stop();
+}
+
+void FastresumeLoader::start(reader const read, decoder const decode, batch_handler const add_batch,
+		unsigned int const workers, std::size_t const batch_size) {
+	thread = std::thread([=]() { run(read, decode, add_batch, workers, batch_size); });
+}
+
+// Batches already handed to add_batch stay added. The ones not loaded yet are left where read found them.
+void FastresumeLoader::stop() {
+	stopping = true;
+	wait();
+}
+
+void FastresumeLoader::wait() {
+	if(thread.joinable())
+		thread.join();
+}
+
+FastresumeLoader::progress FastresumeLoader::get_progress() const {
+	return progress{total, loaded, failed, finished};
+}
+
+void FastresumeLoader::run(reader const read, decoder const decode, batch_handler const add_batch, unsigned int workers,
+		std::size_t const batch_size) {
+	std::chrono::steady_clock::time_point const start_time = std::chrono::steady_clock::now();
+	std::vector<std::vector<char>> resume_data;
+	if(!read(resume_data)) {
+		LOG_ERROR << "Problem while reading fastresume. Only part of the torrents may be loaded";
+	}
+	total = resume_data.size();
+
+	// Workers claim one buffer at a time, so a few large buffers do not leave the other workers idle
+	std::atomic<std::size_t> next(0);
+	workers = std::max(1u, std::min<unsigned int>(workers, resume_data.size()));
+	std::vector<std::thread> pool;
+	for(unsigned int i = 0; i < workers; i++) {
+		pool.emplace_back([&]() {
+			std::vector<lt::add_torrent_params> batch;
+			batch.reserve(batch_size);
+			std::size_t index;
+			while(!stopping && (index = next++) < resume_data.size()) {
+				lt::add_torrent_params atp;
+				if(!decode(resume_data[index], atp)) {
+					failed++;
+					continue;
+				}
+				batch.push_back(std::move(atp));
+				if(batch.size() >= batch_size) {
+					add_batch(batch);
+					loaded += batch.size();
+					batch.clear();
+				}
+			}
+			if(!batch.empty() && !stopping) {
+				add_batch(batch);
+				loaded += batch.size();
+			}
+		});
+	}
+	for(std::thread &worker : pool) {
+		worker.join();
+	}
+
+	finished = true;
+	LOG_INFO << "Loaded fastresume of " << loaded << " torrents in " << std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start_time).count() << "ms. " << failed << " could not be decoded";
+}
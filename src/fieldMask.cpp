@@ -0,0 +1,21 @@
+#include "fieldMask.h"
+#include "utility.h"
+#include <cstring>
+
+FieldMask::FieldMask() : all(true) {
+}
+
+bool FieldMask::compile(std::string const &list, std::vector<char const*> const &names) {
+	std::vector<bool> compiled(names.size(), false);
+	for(std::string const &field : split_string(list, ',')) {
+		std::size_t index = 0;
+		while(index < names.size() && std::strcmp(names[index], field.c_str()) != 0)
+			index++;
+		if(index == names.size())
+			return false;
+		compiled[index] = true;
+	}
+	selected.swap(compiled);
+	all = false;
+	return true;
+}
@@ -0,0 +1,79 @@
+#include "fileSender.h"
+#include <sys/sendfile.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+
+FileSender::FileSender(boost::asio::ip::tcp::socket &socket, int const fd, std::uint64_t const offset, std::uint64_t const count,
+		completion_handler on_complete, progress_handler on_progress) : socket(socket), fd(fd), offset(offset), remaining(count),
+	sent(0), was_non_blocking(socket.native_non_blocking()), on_complete(on_complete), on_progress(on_progress) {
+}
+
+FileSender::~FileSender() {
+	::close(fd);
+}
+
+void FileSender::start(boost::asio::ip::tcp::socket &socket, int const fd, std::uint64_t const offset, std::uint64_t const count,
+		completion_handler on_complete, progress_handler on_progress) {
+	std::shared_ptr<FileSender> sender(new FileSender(socket, fd, offset, count, on_complete, on_progress));
+	// sendfile() has to return EAGAIN instead of blocking the io_service thread
+	boost::system::error_code ec;
+	socket.native_non_blocking(true, ec);
+	if(ec) {
+		sender->finish(ec);
+		return;
+	}
+	sender->send_some();
+}
+
+void FileSender::send_some() {
+	std::uint64_t burst = 0;
+	while(remaining > 0) {
+		if(burst >= max_burst) {
+			std::shared_ptr<FileSender> self = shared_from_this();
+			socket.get_io_service().post([self]() { self->send_some(); });
+			return;
+		}
+
+		off_t file_offset = offset;
+		ssize_t const written = ::sendfile(socket.native_handle(), fd, &file_offset, std::min<std::uint64_t>(remaining, max_write));
+		if(written > 0) {
+			offset += written;
+			remaining -= written;
+			sent += written;
+			burst += written;
+			if(on_progress)
+				on_progress();
+		}
+		else if(written == 0) {
+			// The file is shorter than it was when the transfer started
+			finish(boost::asio::error::eof);
+			return;
+		}
+		else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+			std::shared_ptr<FileSender> self = shared_from_this();
+			socket.async_write_some(boost::asio::null_buffers(), [self](boost::system::error_code const &ec, std::size_t) {
+				if(ec)
+					self->finish(ec);
+				else
+					self->send_some();
+			});
+			return;
+		}
+		else if(errno != EINTR) {
+			finish(boost::system::error_code(errno, boost::system::system_category()));
+			return;
+		}
+	}
+	finish(boost::system::error_code());
+}
+
+void FileSender::finish(boost::system::error_code const &ec) {
+	boost::system::error_code ignored;
+	socket.native_non_blocking(was_non_blocking, ignored);
+	if(on_complete) {
+		completion_handler handler;
+		handler.swap(on_complete);
+		handler(ec, sent);
+	}
+}
@@ -0,0 +1,117 @@
+#include "metricsExporter.h"
+#include <cctype>
+#include <cstdio>
+
+namespace {
+
+void append_int(std::string &out, boost::int64_t const value) {
+	char buffer[24];
+	int const length = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+	out.append(buffer, length);
+}
+
+void append_double(std::string &out, double const value) {
+	char buffer[32];
+	int const length = std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+	out.append(buffer, length);
+}
+
+// Label values may contain backslashes, double quotes and line feeds, which must be escaped
+void append_label_value(std::string &out, std::string const &value) {
+	for(char c : value) {
+		if(c == '\\')
+			out += "\\\\";
+		else if(c == '"')
+			out += "\\\"";
+		else if(c == '\n')
+			out += "\\n";
+		else
+			out += c;
+	}
+}
+
+// libtorrent metric names look like "net.sent_bytes". Prometheus names can not have dots.
+std::string to_metric_name(std::string const &libtorrent_name) {
+	std::string name = "libtorrent_" + libtorrent_name;
+	for(char &c : name) {
+		if(!std::isalnum(static_cast<unsigned char>(c)) && c != '_')
+			c = '_';
+	}
+	return name;
+}
+
+std::string make_header(std::string const &name, char const *help, char const *type) {
+	return "# HELP " + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+}
+
+}
+
+MetricsExporter::MetricsExporter(SessionCounters const &session_counters) {
+	for(SessionCounters::metric const &m : session_counters.get_metrics()) {
+		std::string const name = to_metric_name(m.name);
+		std::string const help = "libtorrent session counter " + m.name;
+		session_metrics.push_back(session_metric{make_header(name, help.c_str(), m.is_gauge ? "gauge" : "counter"),
+				name + " ", m.value_index});
+	}
+
+	torrent_metrics = {
+		{make_header("torrentine_torrent_download_rate_bytes", "Download rate in bytes per second", "gauge"),
+			"torrentine_torrent_download_rate_bytes",
+			[](std::string &out, Torrent::status_snapshot const &s) { append_int(out, s.status.download_rate); }},
+		{make_header("torrentine_torrent_upload_rate_bytes", "Upload rate in bytes per second", "gauge"),
+			"torrentine_torrent_upload_rate_bytes",
+			[](std::string &out, Torrent::status_snapshot const &s) { append_int(out, s.status.upload_rate); }},
+		{make_header("torrentine_torrent_progress_ratio", "Download progress between 0 and 1", "gauge"),
+			"torrentine_torrent_progress_ratio",
+			[](std::string &out, Torrent::status_snapshot const &s) { append_double(out, s.status.progress); }},
+		{make_header("torrentine_torrent_peers", "Connected peers", "gauge"),
+			"torrentine_torrent_peers",
+			[](std::string &out, Torrent::status_snapshot const &s) { append_int(out, s.status.num_peers); }},
+		{make_header("torrentine_torrent_seeds", "Connected seeds", "gauge"),
+			"torrentine_torrent_seeds",
+			[](std::string &out, Torrent::status_snapshot const &s) { append_int(out, s.status.num_seeds); }},
+		{make_header("torrentine_torrent_downloaded_bytes_total", "Bytes downloaded since the torrent was added", "counter"),
+			"torrentine_torrent_downloaded_bytes_total",
+			[](std::string &out, Torrent::status_snapshot const &s) { append_int(out, s.status.all_time_download); }},
+		{make_header("torrentine_torrent_uploaded_bytes_total", "Bytes uploaded since the torrent was added", "counter"),
+			"torrentine_torrent_uploaded_bytes_total",
+			[](std::string &out, Torrent::status_snapshot const &s) { append_int(out, s.status.all_time_upload); }}
+	};
+}
+
+void MetricsExporter::render_session(std::string &out, SessionCounters::sample const &sample) const {
+	for(session_metric const &m : session_metrics) {
+		if(m.value_index < 0 || static_cast<std::size_t>(m.value_index) >= sample.values.size())
+			continue;
+		out += m.header;
+		out += m.prefix;
+		append_int(out, sample.values[m.value_index]);
+		out += '\n';
+	}
+}
+
+// The samples of a metric must be contiguous in the output, so torrents are walked once per metric
+void MetricsExporter::render_torrents(std::string &out, std::vector<unsigned long int> const &ids,
+		std::vector<std::shared_ptr<Torrent::status_snapshot const>> const &torrents_status) const {
+	std::vector<std::string> labels(torrents_status.size());
+	for(std::size_t i = 0; i < torrents_status.size(); i++) {
+		std::string &l = labels[i];
+		l += "{id=\"";
+		append_int(l, ids[i]);
+		l += "\",info_hash=\"";
+		l += torrents_status[i]->info_hash;
+		l += "\",name=\"";
+		append_label_value(l, torrents_status[i]->status.name);
+		l += "\"} ";
+	}
+
+	for(torrent_metric const &m : torrent_metrics) {
+		out += m.header;
+		for(std::size_t i = 0; i < torrents_status.size(); i++) {
+			out += m.name;
+			out += labels[i];
+			m.append_value(out, *torrents_status[i]);
+			out += '\n';
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#include "pieceDeadlines.h"
+
+void PieceDeadlines::hold(unsigned long int const id, int const piece, std::function<void()> const &set_deadline) {
+	std::lock_guard<std::mutex> lock(mutex);
+	holders[piece_key(id, piece)]++;
+	set_deadline();
+}
+
+void PieceDeadlines::release(unsigned long int const id, int const piece, std::function<void()> const &reset_deadline) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = holders.find(piece_key(id, piece));
+	if(it == holders.end())
+		return;
+	if(--it->second > 0)
+		return;
+	holders.erase(it);
+	reset_deadline();
+}
+
+std::size_t PieceDeadlines::size() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return holders.size();
+}
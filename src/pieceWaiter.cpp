@@ -0,0 +1,78 @@
+#include "pieceWaiter.h"
+#include <limits>
+
+void PieceWaiter::take(std::multimap<piece_key, waiter>::iterator const begin, std::multimap<piece_key, waiter>::iterator const end,
+		std::vector<piece_handler> &handlers) {
+	for(auto it = begin; it != end; it++) {
+		handlers.push_back(std::move(it->second.handler));
+	}
+	waiters.erase(begin, end);
+}
+
+void PieceWaiter::set_first_waiter_notify(std::function<void()> const notify) {
+	std::lock_guard<std::mutex> lock(mutex);
+	first_waiter_notify = notify;
+}
+
+void PieceWaiter::wait(unsigned long int const id, int const piece, std::chrono::steady_clock::time_point const deadline,
+		piece_handler const handler) {
+	std::function<void()> notify;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(waiters.empty())
+			notify = first_waiter_notify;
+		waiters.emplace(piece_key(id, piece), waiter{deadline, handler});
+	}
+	if(notify)
+		notify();
+}
+
+void PieceWaiter::piece_read(unsigned long int const id, int const piece, boost::shared_array<char> const &data, int const size) {
+	std::vector<piece_handler> handlers;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto range = waiters.equal_range(piece_key(id, piece));
+		take(range.first, range.second, handlers);
+	}
+	for(piece_handler const &handler : handlers) {
+		if(data)
+			handler(result::read, data, size);
+		else
+			handler(result::failed, boost::shared_array<char>(), 0);
+	}
+}
+
+void PieceWaiter::torrent_removed(unsigned long int const id) {
+	std::vector<piece_handler> handlers;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		take(waiters.lower_bound(piece_key(id, std::numeric_limits<int>::min())),
+				waiters.upper_bound(piece_key(id, std::numeric_limits<int>::max())), handlers);
+	}
+	for(piece_handler const &handler : handlers) {
+		handler(result::failed, boost::shared_array<char>(), 0);
+	}
+}
+
+void PieceWaiter::expire(std::chrono::steady_clock::time_point const now) {
+	std::vector<piece_handler> handlers;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(auto it = waiters.begin(); it != waiters.end();) {
+			if(it->second.deadline <= now) {
+				handlers.push_back(std::move(it->second.handler));
+				it = waiters.erase(it);
+			}
+			else
+				it++;
+		}
+	}
+	for(piece_handler const &handler : handlers) {
+		handler(result::expired, boost::shared_array<char>(), 0);
+	}
+}
+
+std::size_t PieceWaiter::size() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return waiters.size();
+}
@@ -0,0 +1,213 @@
+#include "responseBody.h"
+#include "cborWriter.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include <cstdio>
+#include <vector>
+#include <zlib.h>
+#include "plog/Log.h"
+
+namespace {
+
+// One deflate state per thread and coding. deflateReset() reuses it, so its window is not allocated for every response.
+struct deflate_stream {
+	z_stream stream;
+	bool ready;
+	int level;
+
+	// 15 + 16 window bits writes a gzip header and trailer, 15 a zlib one
+	explicit deflate_stream(int const window_bits) : ready(false), level(Z_DEFAULT_COMPRESSION) {
+		stream.zalloc = Z_NULL;
+		stream.zfree = Z_NULL;
+		stream.opaque = Z_NULL;
+		ready = deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+	}
+	~deflate_stream() {
+		if(ready)
+			deflateEnd(&stream);
+	}
+	bool reset(int const new_level) {
+		if(!ready || deflateReset(&stream) != Z_OK)
+			return false;
+		if(new_level != level) {
+			if(deflateParams(&stream, new_level, Z_DEFAULT_STRATEGY) != Z_OK)
+				return false;
+			level = new_level;
+		}
+		return true;
+	}
+};
+
+int get_window_bits(content_coding const coding) {
+	return coding == content_coding::gzip ? 15 + 16 : 15;
+}
+
+#ifdef TORRENTINE_ZSTD
+struct zstd_context {
+	ZSTD_CCtx *context;
+
+	zstd_context() : context(ZSTD_createCCtx()) {}
+	~zstd_context() {
+		ZSTD_freeCCtx(context);
+	}
+};
+#endif
+
+}
+
+response_body write_json_body(rapidjson::Document const &document, bool const pretty) {
+	thread_local rapidjson::StringBuffer string_buffer;
+	string_buffer.Clear();
+	if(pretty) {
+		rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(string_buffer);
+		document.Accept(writer);
+	}
+	else {
+		rapidjson::Writer<rapidjson::StringBuffer> writer(string_buffer);
+		document.Accept(writer);
+	}
+	return response_body{string_buffer.GetString(), string_buffer.GetSize()};
+}
+
+response_body write_cbor_body(rapidjson::Document const &document) {
+	thread_local rapidjson::StringBuffer string_buffer;
+	string_buffer.Clear();
+	CborWriter<rapidjson::StringBuffer> writer(string_buffer);
+	document.Accept(writer);
+	return response_body{string_buffer.GetString(), string_buffer.GetSize()};
+}
+
+// The output buffer is sized with deflateBound(), so the whole body is compressed by a single deflate() call
+response_body compress_body(content_coding const coding, int const level, char const *data, std::size_t const size) {
+	thread_local std::vector<char> buffer;
+#ifdef TORRENTINE_ZSTD
+	if(coding == content_coding::zstd) {
+		thread_local zstd_context zstd;
+		buffer.resize(ZSTD_compressBound(size));
+		std::size_t const compressed_size = ZSTD_compressCCtx(zstd.context, buffer.data(), buffer.size(), data, size, level);
+		if(ZSTD_isError(compressed_size)) {
+			LOG_ERROR << "Could not compress response body with zstd: " << ZSTD_getErrorName(compressed_size);
+			return response_body{NULL, 0};
+		}
+		return response_body{buffer.data(), compressed_size};
+	}
+#endif
+	if(coding != content_coding::gzip && coding != content_coding::deflate)
+		return response_body{NULL, 0};
+
+	thread_local deflate_stream gzip(get_window_bits(content_coding::gzip));
+	thread_local deflate_stream deflate_only(get_window_bits(content_coding::deflate));
+	deflate_stream &compressor = coding == content_coding::gzip ? gzip : deflate_only;
+	if(!compressor.reset(level)) {
+		LOG_ERROR << "Could not initialize " << get_content_coding_name(coding) << " stream";
+		return response_body{NULL, 0};
+	}
+
+	buffer.resize(deflateBound(&compressor.stream, size));
+	compressor.stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+	compressor.stream.avail_in = size;
+	compressor.stream.next_out = reinterpret_cast<Bytef*>(buffer.data());
+	compressor.stream.avail_out = buffer.size();
+	if(deflate(&compressor.stream, Z_FINISH) != Z_STREAM_END) {
+		LOG_ERROR << "Could not compress response body with " << get_content_coding_name(coding);
+		return response_body{NULL, 0};
+	}
+	return response_body{buffer.data(), buffer.size() - compressor.stream.avail_out};
+}
+
+ChunkedBodyStream::ChunkedBodyStream(content_coding const coding, int const level, std::size_t const chunk_size) : coding(coding),
+	level(level), started(false), chunk_size(chunk_size) {
+	buffer.reserve(chunk_size + 1024);
+}
+
+ChunkedBodyStream::~ChunkedBodyStream() {
+	if(!started)
+		return;
+	if(coding == content_coding::gzip || coding == content_coding::deflate)
+		deflateEnd(&stream);
+#ifdef TORRENTINE_ZSTD
+	if(coding == content_coding::zstd)
+		ZSTD_freeCCtx(zstd_stream);
+#endif
+}
+
+content_coding ChunkedBodyStream::start_compression() {
+	if(started)
+		return coding;
+	started = true;
+	bool ready = true;
+	if(coding == content_coding::gzip || coding == content_coding::deflate) {
+		stream.zalloc = Z_NULL;
+		stream.zfree = Z_NULL;
+		stream.opaque = Z_NULL;
+		ready = deflateInit2(&stream, level, Z_DEFLATED, get_window_bits(coding), 8, Z_DEFAULT_STRATEGY) == Z_OK;
+	}
+#ifdef TORRENTINE_ZSTD
+	else if(coding == content_coding::zstd) {
+		zstd_stream = ZSTD_createCCtx();
+		ready = zstd_stream != NULL && !ZSTD_isError(ZSTD_CCtx_setParameter(zstd_stream, ZSTD_c_compressionLevel, level));
+		if(!ready)
+			ZSTD_freeCCtx(zstd_stream);
+	}
+#endif
+	else {
+		coding = content_coding::identity;
+	}
+	if(!ready) {
+		LOG_ERROR << "Could not initialize " << get_content_coding_name(coding) << " stream. Sending chunks uncompressed";
+		coding = content_coding::identity;
+	}
+	return coding;
+}
+
+void ChunkedBodyStream::take_chunk(std::string &out, bool const last) {
+	start_compression();
+	char const *data = buffer.data();
+	std::size_t size = buffer.size();
+	if(coding == content_coding::gzip || coding == content_coding::deflate) {
+		compressed.clear();
+		stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(buffer.data()));
+		stream.avail_in = buffer.size();
+		int const flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+		int result;
+		do {
+			std::size_t const offset = compressed.size();
+			compressed.resize(offset + deflateBound(&stream, stream.avail_in) + 64);
+			stream.next_out = reinterpret_cast<Bytef*>(&compressed[offset]);
+			stream.avail_out = compressed.size() - offset;
+			result = deflate(&stream, flush);
+			compressed.resize(compressed.size() - stream.avail_out);
+		} while(result == Z_OK && (stream.avail_out == 0 || (last && result != Z_STREAM_END)));
+		data = compressed.data();
+		size = compressed.size();
+	}
+#ifdef TORRENTINE_ZSTD
+	else if(coding == content_coding::zstd) {
+		compressed.clear();
+		ZSTD_inBuffer input = {buffer.data(), buffer.size(), 0};
+		std::size_t remaining;
+		do {
+			std::size_t const offset = compressed.size();
+			compressed.resize(offset + ZSTD_CStreamOutSize());
+			ZSTD_outBuffer output = {&compressed[offset], compressed.size() - offset, 0};
+			remaining = ZSTD_compressStream2(zstd_stream, &output, &input, last ? ZSTD_e_end : ZSTD_e_flush);
+			compressed.resize(offset + output.pos);
+		} while(remaining != 0 && !ZSTD_isError(remaining));
+		data = compressed.data();
+		size = compressed.size();
+	}
+#endif
+
+	out.clear();
+	if(size > 0) {
+		char size_hex[20];
+		snprintf(size_hex, sizeof(size_hex), "%zx\r\n", size);
+		out += size_hex;
+		out.append(data, size);
+		out += "\r\n";
+	}
+	if(last)
+		out += "0\r\n\r\n";
+	buffer.clear();
+}
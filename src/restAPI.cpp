@@ -13,11 +13,192 @@
 #include <typeinfo>
 #include <vector>
 #include <string>
+#include <limits>
+#include <algorithm>
+#include <thread>
 #include <sqlite3.h>
-#include "cpp-base64/base64.h"
 #include "rapidjson/error/en.h"
+#include "cborWriter.h"
+#include "fileSender.h"
+#include "byteRanges.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+
+namespace {
+
+// Names accepted by fields= on each endpoint, in the order they are reported. The enums give the index of each name.
+std::vector<char const*> const file_field_names = {"name", "progress", "downloaded_total", "size", "priority", "path"};
+enum file_field {file_name, file_progress, file_downloaded_total, file_size, file_priority, file_path};
+std::vector<char const*> const peer_field_names = {"ip", "port", "client", "down_speed", "up_speed", "down_total", "up_total",
+	"progress"};
+enum peer_field {peer_ip, peer_port, peer_client, peer_down_speed, peer_up_speed, peer_down_total, peer_up_total, peer_progress};
+std::vector<char const*> const tracker_field_names = {"tier", "url", "next_announce", "is_working", "message"};
+enum tracker_field {tracker_tier, tracker_url, tracker_next_announce, tracker_is_working, tracker_message};
+std::vector<char const*> const info_field_names = {"total_size", "num_pieces", "piece_length", "info_hash", "num_files", "ssl_cert",
+	"priv", "is_i2p", "is_loaded", "creation_date", "name", "comment", "creator"};
+enum info_field {info_total_size, info_num_pieces, info_piece_length, info_info_hash, info_num_files, info_ssl_cert, info_priv,
+	info_is_i2p, info_is_loaded, info_creation_date, info_name, info_comment, info_creator};
+
+std::vector<char const*> const &get_status_field_names() {
+	static std::vector<char const*> const names = [] {
+		std::vector<char const*> names;
+		for(status_field const &field : get_torrent_status_fields()) {
+			names.push_back(field.name);
+		}
+		return names;
+	}();
+	return names;
+}
+
+// What is sent of a file or stream: the ranges, with separators[i] written before ranges[i] and the last one after them
+struct ranged_body {
+	std::vector<byte_range> ranges;
+	std::vector<std::string> separators;
+	std::uint64_t length; // Content-Length
+};
+
+/* Picks the ranges of a size bytes long resource asked for by the Range and If-Range headers of request, and adds the headers
+ that go with them. Returns the status of the response. Nothing is to be sent for a 416. */
+SimpleWeb::StatusCode prepare_ranged_body(std::shared_ptr<HttpServer::Request> const &request, std::uint64_t const size,
+		std::string const &etag, std::string const &last_modified, SimpleWeb::CaseInsensitiveMultimap &header, ranged_body &body) {
+	header.emplace("Accept-Ranges", "bytes");
+	header.emplace("ETag", etag);
+	if(!last_modified.empty())
+		header.emplace("Last-Modified", last_modified);
+
+	range_request ranged = range_request::whole;
+	auto range = request->header.find("Range");
+	if(range != request->header.end()) {
+		auto if_range = request->header.find("If-Range");
+		if(if_range == request->header.end() || if_range_matches(if_range->second, etag, last_modified))
+			ranged = parse_range_header(range->second, size, body.ranges);
+	}
+
+	body.length = 0;
+	if(ranged == range_request::unsatisfiable) {
+		header.emplace("Content-Range", get_unsatisfied_content_range(size));
+		return SimpleWeb::StatusCode::client_error_range_not_satisfiable;
+	}
+	else if(ranged == range_request::whole) {
+		if(size > 0)
+			body.ranges.assign(1, byte_range{0, size - 1});
+		body.separators.assign(body.ranges.size() + 1, std::string());
+		body.length = size;
+		header.emplace("Content-Length", std::to_string(body.length));
+		return SimpleWeb::StatusCode::success_ok;
+	}
+	else if(body.ranges.size() == 1) {
+		header.emplace("Content-Range", get_content_range(body.ranges[0], size));
+		body.separators.assign(2, std::string());
+		body.length = body.ranges[0].length();
+	}
+	else {
+		std::string const boundary = random_string(32);
+		header.emplace("Content-Type", "multipart/byteranges; boundary=" + boundary);
+		body.separators = get_multipart_separators(boundary, body.ranges, size);
+		for(std::size_t i = 0; i < body.ranges.size(); i++) {
+			body.length += body.separators[i].size() + body.ranges[i].length();
+		}
+		body.length += body.separators.back().size();
+	}
+	header.emplace("Content-Length", std::to_string(body.length));
+	return SimpleWeb::StatusCode::success_partial_content;
+}
+
+struct file_body : ranged_body {
+	int const fd;
+	explicit file_body(int const fd) : fd(fd) {}
+	~file_body() { ::close(fd); }
+};
+
+void send_file_body(std::shared_ptr<HttpServer::Response> const &response, std::shared_ptr<file_body> const &body,
+		std::size_t const index) {
+	response->write(body->separators[index].data(), body->separators[index].size());
+	// The Response sends what is left in its buffer when it is released
+	if(index == body->ranges.size())
+		return;
+	response->send([response, body, index](const SimpleWeb::error_code &ec) {
+		if(ec) {
+			LOG_DEBUG << "Stream interrupted: " << ec.message();
+			return;
+		}
+		// FileSender closes its descriptor, and the other ranges still need the file
+		int const fd = ::dup(body->fd);
+		if(fd < 0) {
+			response->close_connection_after_response = true;
+			LOG_ERROR << "Could not duplicate file descriptor for stream: " << std::strerror(errno);
+			return;
+		}
+		byte_range const &range = body->ranges[index];
+		response->set_timeout();
+		FileSender::start(response->get_socket(), fd, range.first, range.length(),
+				[response, body, index](boost::system::error_code const &ec, std::uint64_t const sent) {
+					response->cancel_timeout();
+					if(ec) {
+						// The client got less than Content-Length, so the connection can not be reused
+						response->close_connection_after_response = true;
+						LOG_DEBUG << "Stream interrupted after " << sent << " bytes: " << ec.message();
+						return;
+					}
+					send_file_body(response, body, index + 1);
+				},
+				[response]() { response->set_timeout(); });
+	});
+}
+
+struct stream_body : ranged_body {
+	std::shared_ptr<TorrentStream> stream;
+};
+
+void send_stream_body(std::shared_ptr<HttpServer::Response> const &response, std::shared_ptr<stream_body> const &body,
+		std::size_t const index);
+
+// Sends what is left of ranges[index] from position, a piece at a time, each once libtorrent has it
+void send_stream_range(std::shared_ptr<HttpServer::Response> const &response, std::shared_ptr<stream_body> const &body,
+		std::size_t const index, std::uint64_t const position) {
+	byte_range const &range = body->ranges[index];
+	if(position > range.last) {
+		send_stream_body(response, body, index + 1);
+		return;
+	}
+	boost::asio::io_service &io_service = response->get_socket().get_io_service();
+	body->stream->read(position, range.last - position + 1, [response, body, index, position, &io_service](
+				boost::shared_array<char> const &piece, char const *data, std::size_t const size) {
+		// This runs on the alert loop thread, which must not wait for the client, or here when the piece was cached
+		io_service.post([response, body, index, position, piece, data, size]() {
+			if(data == NULL) {
+				response->close_connection_after_response = true;
+				LOG_DEBUG << "Stream of " << body->stream->get_name() << " stopped at byte " << position << ": piece not available";
+				return;
+			}
+			response->write(data, size);
+			response->send([response, body, index, position, size](const SimpleWeb::error_code &ec) {
+				if(ec) {
+					LOG_DEBUG << "Stream interrupted: " << ec.message();
+					return;
+				}
+				send_stream_range(response, body, index, position + size);
+			});
+		});
+	});
+}
 
-RestAPI::RestAPI(ConfigManager &config, TorrentManager &torrent_manager) : torrent_manager(torrent_manager), config(config) {
+void send_stream_body(std::shared_ptr<HttpServer::Response> const &response, std::shared_ptr<stream_body> const &body,
+		std::size_t const index) {
+	response->write(body->separators[index].data(), body->separators[index].size());
+	if(index < body->ranges.size())
+		send_stream_range(response, body, index, body->ranges[index].first);
+}
+
+}
+
+RestAPI::RestAPI(ConfigManager &config, TorrentManager &torrent_manager) : torrent_manager(torrent_manager), config(config),
+	metrics_exporter(torrent_manager.get_session_counters()), web_assets("webUI"), stream_readahead(16 * 1024 * 1024),
+	stream_timeout(60) {
 	try {
 		torrent_file_path = config.get_config<std::string>("directory.torrent_file_path");
 		download_path = config.get_config<std::string>("directory.download_path"); 
@@ -27,6 +208,66 @@ RestAPI::RestAPI(ConfigManager &config, TorrentManager &torrent_manager) : torre
 	catch(config_key_error const &e) {
 		LOG_ERROR << "Problem initializing RestAPI. Could not get config: " << e.what();
 	}
+	try {
+		authorization_manager.open(fs::path(config.get_config<std::string>("directory.database_path")));
+	}
+	catch(config_key_error const &e) {
+		LOG_ERROR << "Could not find database config. Every request will be denied authorization. Could not get config: " << e.what();
+	}
+	// The token secret is made on the first run and kept in the config file, so tokens survive restarts
+	std::string token_secret;
+	try {
+		token_secret = config.get_config<std::string>("api.token_secret");
+	}
+	catch(config_key_error const &e) {
+		token_secret = random_string(64, "0123456789abcdef");
+		config.set_config<std::string>("api", "token_secret", token_secret);
+		LOG_INFO << "Generated a new secret for access tokens";
+	}
+	int token_lifetime = 3600;
+	try {
+		token_lifetime = config.get_config<int>("api.token_lifetime");
+	}
+	catch(config_key_error const &e) {
+		LOG_DEBUG << "api.token_lifetime not set. Access tokens last " << token_lifetime << " seconds";
+	}
+	authorization_manager.configure_tokens(token_secret, std::chrono::seconds(token_lifetime));
+	try {
+		compression.min_size = std::max(0, config.get_config<int>("api.compression_min_size"));
+	}
+	catch(config_key_error const &e) {
+		LOG_DEBUG << "api.compression_min_size not set. Compressing bodies of " << compression.min_size << " bytes or more";
+	}
+	std::vector<std::pair<char const*, int*>> const compression_levels = {{"api.compression_level", &compression.api_level},
+		{"api.compression_level_listings", &compression.listing_level}, {"api.compression_level_text", &compression.text_level}};
+	for(std::pair<char const*, int*> const &level : compression_levels) {
+		try {
+			*level.second = std::min(9, std::max(1, config.get_config<int>(level.first)));
+		}
+		catch(config_key_error const &e) {
+			LOG_DEBUG << level.first << " not set. Using level " << *level.second;
+		}
+	}
+	try {
+		stream_readahead = std::max(0, config.get_config<int>("api.stream_readahead"));
+	}
+	catch(config_key_error const &e) {
+		LOG_DEBUG << "api.stream_readahead not set. Streams read " << stream_readahead << " bytes ahead";
+	}
+	try {
+		stream_timeout = std::chrono::seconds(std::max(1, config.get_config<int>("api.stream_timeout")));
+	}
+	catch(config_key_error const &e) {
+		LOG_DEBUG << "api.stream_timeout not set. Streams wait " << stream_timeout.count() << " seconds for a piece";
+	}
+	// Handlers run on every thread of the pool, so they must not share mutable state without a lock
+	try {
+		server.config.thread_pool_size = std::max(1, config.get_config<int>("api.thread_pool_size"));
+	}
+	catch(config_key_error const &e) {
+		server.config.thread_pool_size = std::max(1u, std::thread::hardware_concurrency());
+		LOG_DEBUG << "api.thread_pool_size not set. Using " << server.config.thread_pool_size << " threads";
+	}
 
 	define_resources();
 }		
@@ -178,6 +419,21 @@ void RestAPI::define_resources() {
 		[&](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) 
 		{ this->program_status_get(response, request); };
 
+	/* /metrics - GET */
+	server.resource["^/metrics$"]["GET"] =
+		[&](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) 
+		{ this->metrics_get(response, request); };
+
+	/* /program/status/history - GET */
+	server.resource["^/v1.0/program/status/history$"]["GET"] =
+		[&](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) 
+		{ this->program_status_history_get(response, request); };
+
+	/* /program/counters - GET */
+	server.resource["^/v1.0/program/counters$"]["GET"] =
+		[&](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) 
+		{ this->program_counters_get(response, request); };
+
 	/* /program/settings - GET */
 	server.resource["^/v1.0/program/settings$"]["GET"] =
 		[&](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) 
@@ -218,6 +474,11 @@ void RestAPI::define_resources() {
 		[&](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) 
 		{ this->server_directory_get(response, request); };
 
+	/* /torrents/<id>/files/<index>/stream - GET */
+	server.resource["^/v1.0/torrents/([0-9]+)/files/([0-9]+)/stream$"]["GET"] =
+		[&](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) 
+		{ this->torrents_files_stream_get(response, request); };
+
 	/* /stream - GET */
 	server.resource["^/v1.0/stream$"]["GET"] =
 		[&](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) 
@@ -263,17 +524,104 @@ std::string RestAPI::validate_all_parameters(SimpleWeb::CaseInsensitiveMultimap
 	return "";
 }
 
-bool RestAPI::accepts_gzip_encoding(SimpleWeb::CaseInsensitiveMultimap &header) {
+// JSON stays the default, so CBOR is only sent when Accept ranks it above JSON
+bool RestAPI::accepts_cbor(SimpleWeb::CaseInsensitiveMultimap &header) {
+	auto accept = header.find("Accept");
+	return accept != header.end() && prefers_media_type(accept->second, "application/cbor", "application/json");
+}
+
+content_coding RestAPI::get_content_coding(SimpleWeb::CaseInsensitiveMultimap &header) {
 	auto accept_encoding = header.find("Accept-Encoding");
 	if(accept_encoding != header.end()) {
-		std::vector<std::string> encodings = split_string(accept_encoding->second, ',');
-		for(std::string i : encodings) {
-			if(i == "gzip") {
-				return true;
-			}
-		}
+		return negotiate_content_coding(accept_encoding->second);
+	}
+	return content_coding::identity;
+}
+
+/* Writes the status line, the headers and the body, compressed when the client accepts it and the body is not too small to
+ be worth it. http_header must not have Content-Length, Content-Type or Content-Encoding yet. */
+void RestAPI::send_body(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> const request,
+		std::string const &http_status, std::string &http_header, char const *content_type, char const *data, std::size_t size,
+		body_class const type) {
+	if(size >= compression.min_size) {
+		content_coding const coding = get_content_coding(request->header);
+		response_body const compressed = compress_body(coding, compression.get_level(type), data, size);
+		if(compressed.data) {
+			http_header += std::string("Content-Encoding: ") + get_content_coding_name(coding) + "\r\n";
+			data = compressed.data;
+			size = compressed.size;
+		}
+	}
+	// Only JSON and CBOR bodies are negotiated with Accept
+	http_header += type == body_class::text ? "Vary: Accept-Encoding\r\n" : "Vary: Accept, Accept-Encoding\r\n";
+	http_header += "Content-Length: " + std::to_string(size) + "\r\n";
+	http_header += std::string("Content-Type: ") + content_type + "\r\n";
+	*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n";
+	response->write(data, size);
+}
+
+// Sent as CBOR if the client asks for it with Accept. JSON is compact unless the query string has pretty=true
+void RestAPI::send_json(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> const request,
+		rapidjson::Document const &document, std::string const &http_status, std::string &http_header) {
+	if(accepts_cbor(request->header)) {
+		response_body const body = write_cbor_body(document);
+		send_body(response, request, http_status, http_header, "application/cbor", body.data, body.size);
+		return;
+	}
+	SimpleWeb::CaseInsensitiveMultimap query = request->parse_query_string();
+	SimpleWeb::CaseInsensitiveMultimap::iterator it_pretty = query.find("pretty");
+	bool const pretty = it_pretty != query.end() && it_pretty->second == "true";
+	response_body const body = write_json_body(document, pretty);
+	send_body(response, request, http_status, http_header, "application/json", body.data, body.size);
+}
+
+RestAPI::chunked_body::chunked_body(content_coding const coding, int const level, bool const cbor, body_items_writer write_items) :
+	body(coding, level), write_items(write_items) {
+	if(cbor)
+		writer.reset(new ValueWriterAdapter<CborWriter<ChunkedBodyStream>, ChunkedBodyStream>(body));
+	else
+		writer.reset(new ValueWriterAdapter<rapidjson::Writer<ChunkedBodyStream>, ChunkedBodyStream>(body));
+}
+
+/* Sends a JSON body, or CBOR if the client asks for it, with chunked transfer encoding and compressed when the client accepts
+ it. write_items is called again each time the previous chunk was written to the socket, so only one chunk of output is held
+ in memory at a time. A body that fits in the first chunk is sent with send_body() instead, so small listings get a
+ Content-Length and the compression threshold. */
+void RestAPI::send_chunked(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> const request,
+		std::string const &http_status, std::string &http_header, body_items_writer write_items) {
+	bool const cbor = accepts_cbor(request->header);
+	char const *content_type = cbor ? "application/cbor" : "application/json";
+	std::shared_ptr<chunked_body> chunked = std::make_shared<chunked_body>(get_content_coding(request->header),
+			compression.get_level(body_class::listing), cbor, write_items);
+	if(!chunked->write_items(*chunked->writer, chunked->body)) {
+		std::string const &pending = chunked->body.get_pending();
+		send_body(response, request, http_status, http_header, content_type, pending.data(), pending.size(), body_class::listing);
+		return;
+	}
+
+	// Only now that the body is known to span several chunks is the compressor worth setting up
+	content_coding const coding = chunked->body.start_compression();
+	if(coding != content_coding::identity)
+		http_header += std::string("Content-Encoding: ") + get_content_coding_name(coding) + "\r\n";
+	http_header += "Vary: Accept, Accept-Encoding\r\n";
+	http_header += "Transfer-Encoding: chunked\r\n";
+	http_header += std::string("Content-Type: ") + content_type + "\r\n";
+	*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n";
+	send_chunk(response, chunked, true);
+}
+
+void RestAPI::send_chunk(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<chunked_body> chunked, bool const more) {
+	std::string chunk;
+	chunked->body.take_chunk(chunk, !more);
+	response->write(chunk.data(), chunk.size());
+	if(more) {
+		response->send([this, response, chunked](SimpleWeb::error_code const &ec) {
+				if(!ec)
+					send_chunk(response, chunked, chunked->write_items(*chunked->writer, chunked->body));
+				else
+					LOG_DEBUG << "Connection interrupted while sending chunked response: " << ec.message();
+				});
 	}
-	return false;
 }
 
 void RestAPI::torrents_recheck(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
@@ -305,28 +653,16 @@ void RestAPI::torrents_recheck(std::shared_ptr<HttpServer::Response> response, s
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "The torrents will be rechecked";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
 
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -338,24 +674,12 @@ void RestAPI::torrents_recheck(std::shared_ptr<HttpServer::Response> response, s
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -397,28 +721,16 @@ void RestAPI::torrents_stop(std::shared_ptr<HttpServer::Response> response, std:
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "An attempt to stop the torrents will be made asynchronously";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
 
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "202 Accepted";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -430,24 +742,12 @@ void RestAPI::torrents_stop(std::shared_ptr<HttpServer::Response> response, std:
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -487,28 +787,18 @@ void RestAPI::get_logs(std::shared_ptr<HttpServer::Response> response, std::shar
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == true) {
 		char const *message = "Successfully sent log";
 
 		std::string response_file(&buffer[0]);
 
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(response_file);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << response_file;
-		}
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: text/plain\r\n";
 		http_header += "Content-Disposition: inline; filename=torrentine-log.txt\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_body(response, request, http_status, http_header, "text/plain", response_file.data(), response_file.size(), body_class::text);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -519,24 +809,12 @@ void RestAPI::get_logs(std::shared_ptr<HttpServer::Response> response, std::shar
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -546,11 +824,25 @@ void RestAPI::torrents_peers_get(std::shared_ptr<HttpServer::Response> response,
 		return;
 	}
 
-	std::vector<std::vector<Torrent::torrent_peer>> requested_torrent_peers;
+	std::map<std::string, api_parameter> required_parameters = {};
+	std::map<std::string, api_parameter> optional_parameters = {
+		{"fields",{"fields","",api_parameter_format::text,{}}} };
+	SimpleWeb::CaseInsensitiveMultimap query = request->parse_query_string();
+	std::string invalid_parameter = validate_all_parameters(query, required_parameters, optional_parameters);
+	FieldMask fields;
+	if(invalid_parameter.length() == 0 && query.find("fields") != query.end()
+			&& !fields.compile(optional_parameters.find("fields")->second.value, peer_field_names))
+		invalid_parameter = "fields";
+	if(invalid_parameter.length() > 0) { 
+		respond_invalid_parameter(response, request, invalid_parameter);
+		return;
+	}
+
+	std::vector<std::shared_ptr<Torrent>> requested_torrents;
 	std::vector<unsigned long int> ids = split_string_to_ulong(request->path_match[1], ',');
 	if(ids.size() == 0) // If no ids were specified, consider all ids
 		ids = torrent_manager.get_all_ids(); 
-	unsigned long int result = torrent_manager.get_peers_torrents(requested_torrent_peers, ids);
+	unsigned long int result = torrent_manager.find_torrents(requested_torrents, ids);
 
 	std::string http_header;
 	std::string origin_str;
@@ -567,63 +859,102 @@ void RestAPI::torrents_peers_get(std::shared_ptr<HttpServer::Response> response,
 		http_header += "Access-Control-Allow-Credentials: " + credentials_str + "\r\n";
 	}
 
-	rapidjson::Document document;
-	document.SetObject();
-	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "Succesfuly retrieved torrent peers";
-		document.AddMember("message", rapidjson::StringRef(message), allocator);
-		rapidjson::Value torrents(rapidjson::kObjectType);
-		std::vector<unsigned long int>::iterator it_ids= ids.begin();	
-		for(std::vector<Torrent::torrent_peer> torrent_peers : requested_torrent_peers) {
-			rapidjson::Value t(rapidjson::kObjectType);
-			rapidjson::Value peers(rapidjson::kArrayType);
-			rapidjson::Value temp_value;
-			for(Torrent::torrent_peer tp : torrent_peers) {
-				rapidjson::Value f(rapidjson::kObjectType);
-				rapidjson::Value client;
-				client.SetString(tp.client.c_str(), tp.client.size(), allocator);
-				rapidjson::Value address;
-				address.SetString(tp.ip.address().to_string().c_str(), tp.ip.address().to_string().size(), allocator);
-				f.AddMember("ip", address, allocator);
-				f.AddMember("port", tp.ip.port(), allocator);
-				f.AddMember("client", client, allocator);
-				f.AddMember("down_speed", tp.down_speed, allocator);
-				f.AddMember("up_speed", tp.up_speed, allocator);
-				f.AddMember("down_total", tp.down_total, allocator);
-				f.AddMember("up_total", tp.up_total, allocator);
-				f.AddMember("progress", tp.progress, allocator);
-				peers.PushBack(f, allocator);
-			}
-			t.AddMember("peers", peers, allocator);
-			std::string temp_id = std::to_string(*it_ids);
-			it_ids++;
-			temp_value.SetString(temp_id.c_str(), temp_id.length(), allocator);
-			torrents.AddMember(temp_value, t, allocator);	
-		}
-		document.AddMember("torrents", torrents, allocator);
-
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		/* Only the peers of the torrent being written are held, and a torrent with many peers is split over several chunks,
+		 so next_peer resumes inside it */
+		std::shared_ptr<std::vector<std::shared_ptr<Torrent>>> torrents =
+			std::make_shared<std::vector<std::shared_ptr<Torrent>>>(std::move(requested_torrents));
+		std::shared_ptr<std::vector<lt::peer_info>> peers = std::make_shared<std::vector<lt::peer_info>>();
+		std::size_t next_torrent = 0;
+		std::size_t next_peer = 0;
+		bool started = false;
+		bool in_torrent = false;
+		send_chunked(response, request, http_status, http_header,
+				[torrents, peers, fields, message, next_torrent, next_peer, started, in_torrent]
+				(ValueWriter &writer, ChunkedBodyStream const &body) mutable {
+			if(!started) {
+				writer.StartObject();
+				writer.Key("message");
+				writer.String(message);
+				writer.Key("torrents");
+				writer.StartObject();
+				started = true;
+			}
+			for(; next_torrent < torrents->size() && !body.is_full(); next_torrent++) {
+				std::shared_ptr<Torrent> const &torrent = (*torrents)[next_torrent];
+				if(!in_torrent) {
+					torrent->get_peer_info(*peers);
+					in_torrent = true;
+					std::string const id = std::to_string(torrent->get_id());
+					writer.Key(id.c_str(), id.length(), true);
+					writer.StartObject();
+					writer.Key("peers");
+					writer.StartArray();
+				}
+				for(; next_peer < peers->size() && !body.is_full(); next_peer++) {
+					lt::peer_info const &p = (*peers)[next_peer];
+					writer.StartObject();
+					if(fields.has(peer_ip)) {
+						std::string const address = p.ip.address().to_string();
+						writer.Key("ip");
+						writer.String(address.c_str(), address.size(), true);
+					}
+					if(fields.has(peer_port)) {
+						writer.Key("port");
+						writer.Uint(p.ip.port());
+					}
+					if(fields.has(peer_client)) {
+						writer.Key("client");
+						writer.String(p.client.c_str(), p.client.size(), true);
+					}
+					if(fields.has(peer_down_speed)) {
+						writer.Key("down_speed");
+						writer.Int(p.down_speed);
+					}
+					if(fields.has(peer_up_speed)) {
+						writer.Key("up_speed");
+						writer.Int(p.up_speed);
+					}
+					if(fields.has(peer_down_total)) {
+						writer.Key("down_total");
+						writer.Int64(p.total_download);
+					}
+					if(fields.has(peer_up_total)) {
+						writer.Key("up_total");
+						writer.Int64(p.total_upload);
+					}
+					if(fields.has(peer_progress)) {
+						writer.Key("progress");
+						writer.Double(p.progress);
+					}
+					writer.EndObject();
+				}
+				if(next_peer < peers->size())
+					return true;
+				writer.EndArray();
+				writer.EndObject();
+				next_peer = 0;
+				peers->clear();
+				in_torrent = false;
+			}
+			if(next_torrent < torrents->size())
+				return true;
+			writer.EndObject();
+			writer.EndObject();
+			return false;
+		});
 	}
 	else {
+		rapidjson::Document document;
+		document.SetObject();
+		rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 		rapidjson::Value errors(rapidjson::kArrayType);
 		rapidjson::Value e(rapidjson::kObjectType);
 		e.AddMember("code", 3160, allocator);
@@ -633,24 +964,12 @@ void RestAPI::torrents_peers_get(std::shared_ptr<HttpServer::Response> response,
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -662,19 +981,27 @@ void RestAPI::torrents_files_get(std::shared_ptr<HttpServer::Response> response,
 
 	std::map<std::string, api_parameter> required_parameters = {};
 	std::map<std::string, api_parameter> optional_parameters = {
-		{"piece_granularity",{"piece_granularity","true",api_parameter_format::boolean,{"true","false"}}} };
+		{"piece_granularity",{"piece_granularity","true",api_parameter_format::boolean,{"true","false"}}},
+		{"fields",{"fields","",api_parameter_format::text,{}}} };
 	SimpleWeb::CaseInsensitiveMultimap query = request->parse_query_string();
 	std::string invalid_parameter = validate_all_parameters(query, required_parameters, optional_parameters);
+	FieldMask fields;
+	if(invalid_parameter.length() == 0 && query.find("fields") != query.end()
+			&& !fields.compile(optional_parameters.find("fields")->second.value, file_field_names))
+		invalid_parameter = "fields";
 	if(invalid_parameter.length() > 0) { 
 		respond_invalid_parameter(response, request, invalid_parameter);
 		return;
 	}
 
-	std::vector<std::vector<Torrent::torrent_file>> requested_torrent_files;
+	std::vector<std::shared_ptr<Torrent>> requested_torrents;
 	std::vector<unsigned long int> ids = split_string_to_ulong(request->path_match[1], ',');
 	if(ids.size() == 0) // If no ids were specified, consider all ids
 		ids = torrent_manager.get_all_ids(); // TODO - use this same approach in all other API calls and reduce the redundant code in the action methods. This way we do not need to treat ids empty differently than ids non empty in the action method, cuz its always non empty (if torrents exist). 
-	unsigned long int result = torrent_manager.get_files_torrents(requested_torrent_files, ids, str_to_bool(optional_parameters.find("piece_granularity")->second.value));
+	unsigned long int result = torrent_manager.find_torrents(requested_torrents, ids);
+	bool const piece_granularity = str_to_bool(optional_parameters.find("piece_granularity")->second.value);
+	bool const query_progress = fields.has(file_progress) || fields.has(file_downloaded_total);
+	bool const query_priority = fields.has(file_priority);
 
 	std::string http_header;
 	std::string origin_str;
@@ -691,67 +1018,102 @@ void RestAPI::torrents_files_get(std::shared_ptr<HttpServer::Response> response,
 		http_header += "Access-Control-Allow-Credentials: " + credentials_str + "\r\n";
 	}
 
-	rapidjson::Document document;
-	document.SetObject();
-	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "Succesfuly retrieved torrent files";
-		document.AddMember("message", rapidjson::StringRef(message), allocator);
-		rapidjson::Value torrents(rapidjson::kObjectType);
-		std::vector<unsigned long int>::iterator it_ids= ids.begin();	
-		for(std::vector<Torrent::torrent_file> torrent_files : requested_torrent_files) {
-			rapidjson::Value t(rapidjson::kObjectType);
-			rapidjson::Value files(rapidjson::kObjectType);
-			rapidjson::Value temp_value;
-			for(Torrent::torrent_file tf : torrent_files) {
-				rapidjson::Value f(rapidjson::kObjectType);
-				rapidjson::Value name;
-				name.SetString(tf.name.c_str(), tf.name.size(), allocator);
-				// TODO - this works, but I do not know if this is sufficient to implement the UI file tree view in JS easily.
-				// Maybe I will need to tweak this later. Deluge also sends a field "type" that specifies if its a dir or a file.
-				// Not sure if I need that, but keep that in mind.	
-				f.AddMember("name", name, allocator);
-				f.AddMember("progress", double(tf.progress)/double(tf.size), allocator);
-				f.AddMember("downloaded_total", tf.progress, allocator);
-				f.AddMember("size", tf.size, allocator);
-				f.AddMember("priority", tf.priority, allocator);
-				rapidjson::Value path;
-				path.SetString(tf.path.c_str(), tf.path.size(), allocator);
-				f.AddMember("path", path, allocator);
-				//f.AddMember("index", tf.index, allocator);
-				std::string temp_index = std::to_string(tf.index);
-				temp_value.SetString(temp_index.c_str(), temp_index.length(), allocator);
-				files.AddMember(temp_value, f, allocator);
-			}
-			t.AddMember("files", files, allocator);
-			std::string temp_id = std::to_string(*it_ids);
-			it_ids++;
-			temp_value.SetString(temp_id.c_str(), temp_id.length(), allocator);
-			torrents.AddMember(temp_value, t, allocator);	
-		}
-		document.AddMember("torrents", torrents, allocator);
-
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		// Only the file listing of the torrent being written is held. Names and paths are read from its torrent_info by index.
+		std::shared_ptr<std::vector<std::shared_ptr<Torrent>>> torrents =
+			std::make_shared<std::vector<std::shared_ptr<Torrent>>>(std::move(requested_torrents));
+		std::shared_ptr<Torrent::file_listing> listing = std::make_shared<Torrent::file_listing>();
+		std::size_t next_torrent = 0;
+		int next_file = 0;
+		bool started = false;
+		bool in_torrent = false;
+		send_chunked(response, request, http_status, http_header,
+				[torrents, listing, fields, message, piece_granularity, query_progress, query_priority, next_torrent,
+				next_file, started, in_torrent]
+				(ValueWriter &writer, ChunkedBodyStream const &body) mutable {
+			if(!started) {
+				writer.StartObject();
+				writer.Key("message");
+				writer.String(message);
+				writer.Key("torrents");
+				writer.StartObject();
+				started = true;
+			}
+			// A torrent with many files is split over several chunks, so next_file resumes inside it
+			for(; next_torrent < torrents->size() && !body.is_full(); next_torrent++) {
+				std::shared_ptr<Torrent> const &torrent = (*torrents)[next_torrent];
+				if(!in_torrent) {
+					*listing = torrent->get_file_listing(piece_granularity, query_progress, query_priority);
+					in_torrent = true;
+					std::string const id = std::to_string(torrent->get_id());
+					writer.Key(id.c_str(), id.length(), true);
+					writer.StartObject();
+					writer.Key("files");
+					writer.StartObject();
+				}
+				int const num_files = listing->num_files();
+				for(; next_file < num_files && !body.is_full(); next_file++) {
+					lt::file_storage const &files = listing->info->files();
+					std::string const index = std::to_string(next_file);
+					writer.Key(index.c_str(), index.length(), true);
+					writer.StartObject();
+					// TODO - this works, but I do not know if this is sufficient to implement the UI file tree view in JS easily.
+					// Maybe I will need to tweak this later. Deluge also sends a field "type" that specifies if its a dir or a file.
+					// Not sure if I need that, but keep that in mind.	
+					if(fields.has(file_name)) {
+						std::string const name = files.file_name(next_file);
+						writer.Key("name");
+						writer.String(name.c_str(), name.size(), true);
+					}
+					if(fields.has(file_progress)) {
+						writer.Key("progress");
+						writer.Double(double(listing->progress.at(next_file))/double(files.file_size(next_file)));
+					}
+					if(fields.has(file_downloaded_total)) {
+						writer.Key("downloaded_total");
+						writer.Int64(listing->progress.at(next_file));
+					}
+					if(fields.has(file_size)) {
+						writer.Key("size");
+						writer.Int64(files.file_size(next_file));
+					}
+					if(fields.has(file_priority)) {
+						writer.Key("priority");
+						writer.Int(listing->priorities.at(next_file));
+					}
+					if(fields.has(file_path)) {
+						std::string const path = files.file_path(next_file);
+						writer.Key("path");
+						writer.String(path.c_str(), path.size(), true);
+					}
+					writer.EndObject();
+				}
+				if(next_file < num_files)
+					return true;
+				writer.EndObject();
+				writer.EndObject();
+				next_file = 0;
+				*listing = Torrent::file_listing();
+				in_torrent = false;
+			}
+			if(next_torrent < torrents->size())
+				return true;
+			writer.EndObject();
+			writer.EndObject();
+			return false;
+		});
 	}
 	else {
+		rapidjson::Document document;
+		document.SetObject();
+		rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 		rapidjson::Value errors(rapidjson::kArrayType);
 		rapidjson::Value e(rapidjson::kObjectType);
 		e.AddMember("code", 3140, allocator);
@@ -761,24 +1123,12 @@ void RestAPI::torrents_files_get(std::shared_ptr<HttpServer::Response> response,
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -810,28 +1160,16 @@ void RestAPI::torrents_start(std::shared_ptr<HttpServer::Response> response, std
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "An attempt to start the torrents will be made asynchronously";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
 
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "202 Accepted";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -843,24 +1181,12 @@ void RestAPI::torrents_start(std::shared_ptr<HttpServer::Response> response, std
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -873,12 +1199,39 @@ void RestAPI::torrents_status_get(std::shared_ptr<HttpServer::Response> response
 		return;
 	}
 
+	// since: only torrents and fields changed after this sequence are returned, plus the ids removed after it
+	// fields: comma separated status fields to return. All of them when missing
+	// format: columnar returns one array per field, aligned with the ids array, instead of an object per torrent
+	std::map<std::string, api_parameter> required_parameters = {};
+	std::map<std::string, api_parameter> optional_parameters = {
+		{"since",{"since","0",api_parameter_format::int_number,{}}},
+		{"fields",{"fields","",api_parameter_format::text,{}}},
+		{"format",{"format","object",api_parameter_format::text,{"object","columnar"}}} };
+	SimpleWeb::CaseInsensitiveMultimap query = request->parse_query_string();
+	std::string invalid_parameter = validate_all_parameters(query, required_parameters, optional_parameters);
+	std::uint64_t since = 0;
+	if(invalid_parameter.length() == 0) {
+		try {
+			since = std::stoull(optional_parameters.find("since")->second.value);
+		}
+		catch(std::exception const &e) {
+			invalid_parameter = "since";
+		}
+	}
+	FieldMask fields;
+	if(invalid_parameter.length() == 0 && query.find("fields") != query.end()
+			&& !fields.compile(optional_parameters.find("fields")->second.value, get_status_field_names()))
+		invalid_parameter = "fields";
+	if(invalid_parameter.length() > 0) { 
+		respond_invalid_parameter(response, request, invalid_parameter);
+		return;
+	}
+	bool const is_delta = query.find("since") != query.end();
+	bool const columnar = optional_parameters.find("format")->second.value == "columnar";
+
 	std::vector<unsigned long int> ids = split_string_to_ulong(request->path_match[1], ',');
-	// TODO - Inefficient. When ids.size() = 0 should be treated inside the calls, not here.
-	if(ids.size() == 0) // If no ids were specified, consider all ids
-		ids = torrent_manager.get_all_ids(); 
-	std::vector<lt::torrent_status> torrents_status;
-	unsigned long int result = torrent_manager.get_torrents_status(torrents_status, ids);
+	TorrentManager::status_delta delta;
+	unsigned long int result = torrent_manager.get_torrents_status_delta(delta, ids, since);
 
 	std::string http_header;
 	std::string origin_str;
@@ -895,127 +1248,66 @@ void RestAPI::torrents_status_get(std::shared_ptr<HttpServer::Response> response
 		http_header += "Access-Control-Allow-Credentials: " + credentials_str + "\r\n";
 	}
 
-	rapidjson::Document document;
-	document.SetObject();
-	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "Succesfuly retrieved torrent status";
-		document.AddMember("message", rapidjson::StringRef(message), allocator);
-		rapidjson::Value torrents(rapidjson::kObjectType);
-		std::vector<unsigned long int>::iterator it_ids= ids.begin();	
-		for(lt::torrent_status status : torrents_status) {
-			lt::torrent_handle handle = status.handle;
-			rapidjson::Value t(rapidjson::kObjectType);
-			//t.AddMember("id", *it_ids, allocator);
-			//it_ids++;
-			rapidjson::Value s(rapidjson::kObjectType);
-			rapidjson::Value temp_value;
-			temp_value.SetString(status.name.c_str(), status.name.length(), allocator);
-			s.AddMember("name", temp_value, allocator);
-			s.AddMember("download_rate", status.download_rate, allocator);
-			s.AddMember("download_limit", handle.download_limit(), allocator);
-			s.AddMember("upload_rate", status.upload_rate, allocator); 
-			s.AddMember("upload_limit", handle.upload_limit(), allocator);
-			s.AddMember("progress", status.progress, allocator); 
-			s.AddMember("total_download", status.total_download, allocator);
-			s.AddMember("total_payload_download", status.total_payload_download, allocator);
-			s.AddMember("download_payload_rate", status.download_payload_rate, allocator);
-			s.AddMember("total_payload_upload", status.total_payload_upload, allocator);
-			s.AddMember("upload_payload_rate", status.upload_payload_rate, allocator);
-			s.AddMember("total_failed_bytes", status.total_failed_bytes, allocator);
-			s.AddMember("total_redundant_bytes", status.total_redundant_bytes, allocator);
-			s.AddMember("total_done", status.total_done, allocator);
-			s.AddMember("total_upload", status.total_upload, allocator); 
-			s.AddMember("num_seeds", status.num_seeds, allocator);
-			temp_value.SetString(status.save_path.c_str(), status.save_path.length(), allocator);
-			s.AddMember("save_path", temp_value, allocator);
-			s.AddMember("next_announce", lt::duration_cast<lt::seconds>(status.next_announce).count(), allocator);
-			temp_value.SetString(status.current_tracker.c_str(), status.current_tracker.length(), allocator);
-			s.AddMember("current_tracker", temp_value, allocator);
-			s.AddMember("num_peers", status.num_peers, allocator);
-			s.AddMember("total_wanted_done", status.total_wanted_done, allocator);
-			s.AddMember("total_wanted", status.total_wanted, allocator);
-			s.AddMember("all_time_upload", status.all_time_upload, allocator);
-			s.AddMember("all_time_download", status.all_time_download, allocator);
-			s.AddMember("added_time", status.added_time, allocator);
-			s.AddMember("completed_time", status.completed_time, allocator);
-			s.AddMember("last_seen_complete", status.last_seen_complete, allocator);
-			s.AddMember("storage_mode", status.storage_mode, allocator);
-			s.AddMember("progress_ppm", status.progress_ppm, allocator);
-			s.AddMember("queue_position", status.queue_position, allocator);
-			s.AddMember("num_complete", status.num_complete, allocator);
-			s.AddMember("num_incomplete", status.num_incomplete, allocator);
-			s.AddMember("list_seeds", status.list_seeds, allocator);
-			s.AddMember("list_peers", status.list_peers, allocator);
-			s.AddMember("connect_candidates", status.connect_candidates, allocator);
-			s.AddMember("num_pieces", status.num_pieces, allocator);
-			s.AddMember("distributed_full_copies", status.distributed_full_copies, allocator);
-			s.AddMember("distributed_fraction", status.distributed_fraction, allocator);
-			s.AddMember("distributed_copies", status.distributed_copies, allocator);
-			s.AddMember("block_size", status.block_size, allocator);
-			s.AddMember("num_uploads", status.num_uploads, allocator);
-			s.AddMember("num_connections", status.num_connections, allocator);
-			s.AddMember("uploads_limit", status.uploads_limit, allocator);
-			s.AddMember("connections_limit", status.connections_limit, allocator);
-			s.AddMember("up_bandwidth_queue", status.up_bandwidth_queue, allocator);
-			s.AddMember("down_bandwidth_queue", status.down_bandwidth_queue, allocator); 
-			s.AddMember("seed_rank", status.seed_rank, allocator); 
-			s.AddMember("checking_resume_data", status.checking_resume_data, allocator); 
-			s.AddMember("need_save_resume", status.need_save_resume, allocator); 
-			s.AddMember("is_seeding", status.is_seeding, allocator); 
-			s.AddMember("is_finished", status.is_finished, allocator); 
-			s.AddMember("has_metadata", status.has_metadata, allocator); 
-			s.AddMember("has_incoming", status.has_incoming, allocator); 
-			s.AddMember("moving_storage", status.moving_storage, allocator); 
-			s.AddMember("announcing_to_trackers", status.announcing_to_trackers, allocator); 
-			s.AddMember("announcing_to_lsd", status.announcing_to_lsd, allocator); 
-			s.AddMember("announcing_to_dht", status.announcing_to_dht, allocator);
-			// TODO - deprecated in 1.2
-			// use last_upload, last_download or
-			// seeding_duration, finished_duration and active_duration
-			// instead
-			s.AddMember("time_since_upload", status.time_since_upload, allocator);  // TODO
-			s.AddMember("time_since_download", status.time_since_download, allocator); 
-			s.AddMember("active_time", status.active_time, allocator); 
-			s.AddMember("finished_time", status.finished_time, allocator); 
-			s.AddMember("seeding_time", status.seeding_time, allocator); 
-			/* info_hash: If this handle is to a torrent that hasn't loaded yet (for instance by being added) by a URL,
-			   the returned value is undefined. */
-			std::stringstream ss_info_hash;
-			ss_info_hash << status.info_hash;
-			std::string info_hash = ss_info_hash.str();
-			temp_value.SetString(info_hash.c_str(), info_hash.length(), allocator);
-			s.AddMember("info_hash", temp_value, allocator);	
-			t.AddMember("status", s, allocator);
-			std::string temp_id = std::to_string(*it_ids);
-			temp_value.SetString(temp_id.c_str(), temp_id.length(), allocator);
-			it_ids++;
-			torrents.AddMember(temp_value, t, allocator);
-		}
-		document.AddMember("torrents", torrents, allocator);
-
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		// The snapshots are shared with the registry, so the delta is cheap to keep until the last chunk is sent
+		std::shared_ptr<TorrentManager::status_delta> shared_delta = std::make_shared<TorrentManager::status_delta>(std::move(delta));
+		std::uint64_t const fields_since = shared_delta->full ? 0 : since;
+		std::size_t next = 0;
+		std::size_t column = 0;
+		bool started = false;
+		send_chunked(response, request, http_status, http_header,
+				[this, shared_delta, fields_since, fields, is_delta, columnar, message, next, column, started]
+				(ValueWriter &writer, ChunkedBodyStream const &body) mutable {
+			if(!started) {
+				writer.StartObject();
+				writer.Key("message");
+				writer.String(message);
+				writer.Key("sequence");
+				writer.Uint64(shared_delta->sequence);
+				if(is_delta) {
+					writer.Key("full");
+					writer.Bool(shared_delta->full);
+					writer.Key("removed");
+					writer.StartArray();
+					for(unsigned long int id : shared_delta->removed_ids) {
+						writer.Uint64(id);
+					}
+					writer.EndArray();
+				}
+				writer.Key("torrents");
+				writer.StartObject();
+				started = true;
+			}
+			if(columnar)
+				return write_status_columns(writer, body, *shared_delta, fields, column, next);
+			for(; next < shared_delta->torrents_status.size() && !body.is_full(); next++) {
+				std::string const id = std::to_string(shared_delta->ids[next]);
+				writer.Key(id.c_str(), id.length(), true);
+				writer.StartObject();
+				writer.Key("status");
+				writer.StartObject();
+				write_status_fields(writer, *shared_delta->torrents_status[next], fields_since, fields);
+				writer.EndObject();
+				writer.EndObject();
+			}
+			if(next < shared_delta->torrents_status.size())
+				return true;
+			writer.EndObject();
+			writer.EndObject();
+			return false;
+		});
 	}
 	else {
+		rapidjson::Document document;
+		document.SetObject();
+		rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 		rapidjson::Value errors(rapidjson::kArrayType);
 		rapidjson::Value e(rapidjson::kObjectType);
 		e.AddMember("code", 3170, allocator);
@@ -1025,24 +1317,12 @@ void RestAPI::torrents_status_get(std::shared_ptr<HttpServer::Response> response
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -1085,28 +1365,16 @@ void RestAPI::torrents_delete(std::shared_ptr<HttpServer::Response> response, st
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "An attempt to remove the torrents will be made asynchronously";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
 
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "202 Accepted";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -1118,24 +1386,12 @@ void RestAPI::torrents_delete(std::shared_ptr<HttpServer::Response> response, st
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -1356,7 +1612,6 @@ void RestAPI::torrents_upload_files(std::shared_ptr<HttpServer::Response> respon
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(error_code == 0) {
 		char const *message = "Torrents uploaded successfully";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
@@ -1370,23 +1625,12 @@ void RestAPI::torrents_upload_files(std::shared_ptr<HttpServer::Response> respon
 		}
 		document.AddMember("uploaded_torrents", t, allocator);
 
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	/* TODO - Another design limitation with error codes here. The http_status should be determined by the error code. For example, sometimes we need 500 and sometimes we need 400 and the error code should contain that information. Error codes NEED TO be an object of some kind to add make this happen.*/
 	else {
@@ -1398,24 +1642,12 @@ void RestAPI::torrents_upload_files(std::shared_ptr<HttpServer::Response> respon
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -1453,28 +1685,16 @@ void RestAPI::torrents_add(std::shared_ptr<HttpServer::Response> response, std::
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(error_code == 0) {
 		char const *message = "An attempt to add the torrents will be made asynchronously";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
 
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "202 Accepted";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	/* TODO - Another design limitation with error codes here. The http_status should be determined by the error code. For example, sometimes we need 500 and sometimes we need 400 and the error code should contain that information. Error codes NEED TO be an object of some kind to add make this happen.*/
 	else {
@@ -1486,108 +1706,67 @@ void RestAPI::torrents_add(std::shared_ptr<HttpServer::Response> response, std::
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
 void RestAPI::webUI_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
-	try {
-		auto web_root_path = boost::filesystem::canonical("webUI");
-		auto path = boost::filesystem::canonical(web_root_path / request->path);
-		// Check if path is within web_root_path
-		if(std::distance(web_root_path.begin(), web_root_path.end()) > std::distance(path.begin(), path.end()) ||
-				!std::equal(web_root_path.begin(), web_root_path.end(), path.begin()))
-			throw std::invalid_argument("path must be within root path");
-		if(boost::filesystem::is_directory(path))
-			path /= "index.html";
-
-		SimpleWeb::CaseInsensitiveMultimap header;
-
-		//    Uncomment the following line to enable Cache-Control
-		//    header.emplace("Cache-Control", "max-age=86400");
-
-#ifdef HAVE_OPENSSL
-		//    Uncomment the following lines to enable ETag
-		//    {
-		//      ifstream ifs(path.string(), ifstream::in | ios::binary);
-		//      if(ifs) {
-		//        auto hash = SimpleWeb::Crypto::to_hex_string(SimpleWeb::Crypto::md5(ifs));
-		//        header.emplace("ETag", "\"" + hash + "\"");
-		//        auto it = request->header.find("If-None-Match");
-		//        if(it != request->header.end()) {
-		//          if(!it->second.empty() && it->second.compare(1, hash.size(), hash) == 0) {
-		//            response->write(SimpleWeb::StatusCode::redirection_not_modified, header);
-		//            return;
-		//          }
-		//        }
-		//      }
-		//      else
-		//        throw invalid_argument("could not read file");
-		//    }
-#endif
+	std::shared_ptr<StaticAssetCache::asset const> const asset = web_assets.find(request->path);
+	if(!asset) {
+		response->write(SimpleWeb::StatusCode::client_error_not_found, "Could not open path " + request->path);
+		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " 404 Not Found to " << request->remote_endpoint_address();
+		return;
+	}
 
-		auto ifs = std::make_shared<std::ifstream>();
-		ifs->open(path.string(), std::ifstream::in | std::ios::binary | std::ios::ate);
-
-		if(*ifs) {
-			auto length = ifs->tellg();
-			ifs->seekg(0, std::ios::beg);
-
-			header.emplace("Content-Length", std::to_string(length));
-			response->write(header);
-
-			// Trick to define a recursive function within this scope (for your convenience)
-			class FileServer {
-				public:
-					static void read_and_send(const std::shared_ptr<HttpServer::Response> &response, const std::shared_ptr<std::ifstream> &ifs) {
-						// Read and send 128 KB at a time
-						static std::vector<char> buffer(131072); // Safe when server is running on one thread
-						std::streamsize read_length;
-						if((read_length = ifs->read(&buffer[0], buffer.size()).gcount()) > 0) {
-							response->write(&buffer[0], read_length);
-							if(read_length == static_cast<std::streamsize>(buffer.size())) {
-								response->send([response, ifs](const SimpleWeb::error_code &ec) {
-										if(!ec)
-										read_and_send(response, ifs);
-										else
-										std::cerr << "Connection interrupted" << std::endl; // TODO - log
-										});
-							}
-						}
-					}
-			};
-			FileServer::read_and_send(response, ifs);
+	auto accept_encoding = request->header.find("Accept-Encoding");
+	bool const gzip = !asset->gzip_body.empty() && accept_encoding != request->header.end()
+		&& accepts_content_coding(accept_encoding->second, content_coding::gzip);
+	std::string const &etag = gzip ? asset->gzip_etag : asset->etag;
+
+	SimpleWeb::CaseInsensitiveMultimap header;
+	header.emplace("ETag", etag);
+	// Hashed bundles never change under the same name. Everything else, like index.html, is revalidated with its ETag.
+	header.emplace("Cache-Control", asset->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+	header.emplace("Vary", "Accept-Encoding");
+
+	// Both ETags name the same file, so either one is still fresh
+	auto if_none_match = request->header.find("If-None-Match");
+	if(if_none_match != request->header.end()) {
+		for(std::string tag : split_string(if_none_match->second, ',')) {
+			tag.erase(0, tag.find_first_not_of(' '));
+			tag.erase(tag.find_last_not_of(' ') + 1);
+			if(tag.compare(0, 2, "W/") == 0)
+				tag.erase(0, 2);
+			if(tag == "*" || tag == asset->etag || (!asset->gzip_etag.empty() && tag == asset->gzip_etag)) {
+				// No Content-Length, which would have to be the one of the full body
+				*response << "HTTP/1.1 304 Not Modified\r\n";
+				for(auto const &field : header) {
+					*response << field.first << ": " << field.second << "\r\n";
+				}
+				*response << "\r\n";
+				return;
+			}
 		}
-		else
-			throw std::invalid_argument("could not read file");
-	}
-	catch(const std::exception &e) {
-		response->write(SimpleWeb::StatusCode::client_error_bad_request, "Could not open path " + request->path + ": " + e.what());
-		LOG_ERROR << "Could not open path " + request->path + ": " + e.what();
 	}
+
+	std::string const &body = gzip ? asset->gzip_body : asset->body;
+	if(gzip)
+		header.emplace("Content-Encoding", "gzip");
+	header.emplace("Content-Type", asset->content_type);
+	header.emplace("Content-Length", std::to_string(body.size()));
+	response->write(header);
+	response->write(body.data(), body.size());
 }
 
 bool RestAPI::validate_authorization(std::shared_ptr<HttpServer::Request> const request) {
 	SimpleWeb::CaseInsensitiveMultimap header = request->header;
 	auto authorization = header.find("Authorization");
-	if(authorization != header.end() && is_authorization_valid(authorization->second)) {
+	if(authorization != header.end() && authorization_manager.is_authorization_valid(authorization->second)) {
 		return true;
 	}
 	else {
@@ -1607,8 +1786,6 @@ void RestAPI::respond_invalid_authorization(std::shared_ptr<HttpServer::Response
 	errors.PushBack(e, allocator);
 	document.AddMember("errors", errors, allocator);
 
-	std::string json = stringfy_document(document);
-
 	std::string http_status = "401 Unauthorized";
 	std::string http_header;
 	std::string origin_str;
@@ -1625,31 +1802,60 @@ void RestAPI::respond_invalid_authorization(std::shared_ptr<HttpServer::Response
 		http_header += "Access-Control-Allow-Credentials: " + credentials_str + "\r\n";
 	}
 
-	http_header += "Content-Length: " + std::to_string(json.length()) + "\r\n";
 
-	*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << json;
+	send_json(response, request, document, http_status, http_header);
 
 	LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 		<< " to " << request->remote_endpoint_address() << " Message: " << message;
 }
 
-std::string RestAPI::stringfy_document(rapidjson::Document const &document, bool const pretty) {
-	rapidjson::StringBuffer string_buffer;
-	std::string json;
-
-	if(pretty) {
-		rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(string_buffer);
-		document.Accept(writer);
-		json = string_buffer.GetString();
-	} 
-	else {
-		rapidjson::Writer<rapidjson::StringBuffer> writer(string_buffer);
-		document.Accept(writer);
-		json = string_buffer.GetString();
+// Adds the fields of snapshot changed after since. Snapshots that were never sequenced have all their fields added.
+void RestAPI::write_status_fields(ValueWriter &writer, Torrent::status_snapshot const &snapshot, std::uint64_t const since,
+		FieldMask const &mask) {
+	std::vector<status_field> const &fields = get_torrent_status_fields();
+	for(std::size_t index = 0; index < fields.size(); index++) {
+		if(!mask.has(index))
+			continue;
+		if(!snapshot.field_sequences.empty() && snapshot.field_sequences[index] <= since)
+			continue;
+		writer.Key(fields[index].name);
+		write_status_value(writer, fields[index].get(snapshot));
 	}
-	return json;
 }
 
+/* Writes the torrents of a status listing as one array per field, aligned with the ids array, and closes the listing. Column 0
+ is the ids and column n is status field n - 1. column and row are where the previous chunk stopped. Returns true while there
+ is more to write. In a delta every selected field is written for every changed torrent, since leaving out the unchanged
+ values would break the alignment. */
+bool RestAPI::write_status_columns(ValueWriter &writer, ChunkedBodyStream const &body, TorrentManager::status_delta const &delta,
+		FieldMask const &mask, std::size_t &column, std::size_t &row) {
+	std::vector<status_field> const &fields = get_torrent_status_fields();
+	std::size_t const rows = delta.torrents_status.size();
+	for(; column <= fields.size(); column++) {
+		if(column > 0 && !mask.has(column - 1))
+			continue;
+		if(row == 0) {
+			if(body.is_full())
+				return true;
+			writer.Key(column == 0 ? "ids" : fields[column - 1].name);
+			writer.StartArray();
+		}
+		// The first value is always written, so a column that was started is never started again
+		for(; row < rows; row++) {
+			if(row > 0 && body.is_full())
+				return true;
+			if(column == 0)
+				writer.Uint64(delta.ids[row]);
+			else
+				write_status_value(writer, fields[column - 1].get(*delta.torrents_status[row]));
+		}
+		writer.EndArray();
+		row = 0;
+	}
+	writer.EndObject();
+	writer.EndObject();
+	return false;
+}
 
 void RestAPI::respond_invalid_parameter(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> const request, std::string const parameter) {
 	rapidjson::Document document;
@@ -1664,8 +1870,6 @@ void RestAPI::respond_invalid_parameter(std::shared_ptr<HttpServer::Response> re
 	errors.PushBack(e, allocator);
 	document.AddMember("errors", errors, allocator);
 
-	std::string json = stringfy_document(document);
-
 	std::string http_status = "400 Bad Request";
 
 	std::string http_header;
@@ -1683,12 +1887,11 @@ void RestAPI::respond_invalid_parameter(std::shared_ptr<HttpServer::Response> re
 		http_header += "Access-Control-Allow-Credentials: " + credentials_str + "\r\n";
 	}
 
-	http_header += "Content-Length: " + std::to_string(json.length()) + "\r\n";
 
 	LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 		<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-	*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << json;
+	send_json(response, request, document, http_status, http_header);
 
 }
 
@@ -1728,106 +1931,26 @@ bool RestAPI::validate_parameter(SimpleWeb::CaseInsensitiveMultimap const &query
 	return false;
 }
 
-std::string RestAPI::decode_basic_auth(std::string authorization_base64) {
-	std::stringstream ss(authorization_base64);
-	std::string s;
-	char delim = ' ';
-
-	getline(ss, s, delim);
-	if(s != "Basic") {
-		return std::string("");
-	}
-
-	getline(ss, s, delim);
-	return base64_decode(s);
-}
-
-bool RestAPI::is_authorization_valid(std::string authorization_base64) {
-	sqlite3 *db;
-	sqlite3_stmt *stmt;
-
-	std::string authorization = decode_basic_auth(authorization_base64);
-	if(authorization.size() == 0) {
-		return false;
-	}
-	std::vector<std::string> user_pass = split_string(authorization, ':');
-	if(user_pass.size() != 2) {
-		return false;
-	}
-	std::string username = user_pass.at(0);
-	std::string password = user_pass.at(1);
-
-	std::stringstream sql;
-	sql << "select id,username,password,salt from users where username = ?";
-
-	fs::path users_db_path;
-	try {
-		users_db_path = fs::path(config.get_config<std::string>("directory.database_path"));
-	}
-	catch(config_key_error const &e) {
-		LOG_ERROR << "Could not find database config. Authorization for user " << username << " denied." << " Could not get config: " << e.what();
-		return false;
-	}
-
-	if(sqlite3_open(users_db_path.string().c_str(), &db) != SQLITE_OK) {
-		LOG_ERROR << "Could not open database " << users_db_path.string() << ". SQLite3 error_msg: " << sqlite3_errmsg(db); 
-		sqlite3_close(db);
-		return false;
-	}
-
-	if(sqlite3_prepare_v2(db, sql.str().c_str(), -1, &stmt, NULL) != SQLITE_OK) {
-		LOG_ERROR << "Could not compile SQL: " << sql.str() << ". SQLite3 error_msg: " << sqlite3_errmsg(db); 
-		sqlite3_close(db);
-		sqlite3_finalize(stmt);
-		return false;
-	}
-
-	int ret_code = 0;
-	bool found = false;
-	int id;
-	std::string username_db;
-	std::string password_db;
-	std::string salt_db;
-	sqlite3_bind_text(stmt, 1, username.c_str(), username.size(), SQLITE_STATIC);
-	while((ret_code = sqlite3_step(stmt)) == SQLITE_ROW) {
-		id = sqlite3_column_int(stmt, 0);
-		username_db = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-		password_db = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-		salt_db = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-		found = true;
-	}
-
-	if(!found) {
-		LOG_DEBUG << "Authorization for user " << username << " denied." << " User not found in database.";
-		sqlite3_finalize(stmt);
-		sqlite3_close(db);
-		return false;
-	}
-
-	if(ret_code != SQLITE_DONE) {
-		LOG_ERROR << "Problem while evaluating SQL: " << sql.str() << ". SQLite3 error_msg: " << sqlite3_errmsg(db);
-	}
-
-	sqlite3_finalize(stmt);
-	sqlite3_close(db);
-
-	std::string password_hash = generate_password_hash(password.c_str(), (unsigned char*)salt_db.c_str());
-	if(password_hash == password_db) {
-		LOG_DEBUG << "Authorization for user " << username << " allowed.";
-		return true;
-	}
-	else {
-		LOG_DEBUG << "Authorization for user " << username << " denied." << " Wrong password.";
-		return false;
-	}	
-}
-
 void RestAPI::torrents_trackers_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
 	if(!validate_authorization(request)) {
 		respond_invalid_authorization(response, request);
 		return;
 	}
 
+	std::map<std::string, api_parameter> required_parameters = {};
+	std::map<std::string, api_parameter> optional_parameters = {
+		{"fields",{"fields","",api_parameter_format::text,{}}} };
+	SimpleWeb::CaseInsensitiveMultimap query = request->parse_query_string();
+	std::string invalid_parameter = validate_all_parameters(query, required_parameters, optional_parameters);
+	FieldMask fields;
+	if(invalid_parameter.length() == 0 && query.find("fields") != query.end()
+			&& !fields.compile(optional_parameters.find("fields")->second.value, tracker_field_names))
+		invalid_parameter = "fields";
+	if(invalid_parameter.length() > 0) { 
+		respond_invalid_parameter(response, request, invalid_parameter);
+		return;
+	}
+
 	std::vector<std::vector<lt::announce_entry>> requested_torrent_trackers;
 	std::vector<unsigned long int> ids = split_string_to_ulong(request->path_match[1], ',');
 	if(ids.size() == 0) // If no ids were specified, consider all ids
@@ -1853,7 +1976,6 @@ void RestAPI::torrents_trackers_get(std::shared_ptr<HttpServer::Response> respon
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	// TODO - change the name of the variables here. I copied it from elsewhere
 	if(result == 0) {
 		char const *message = "Succesfuly retrieved torrent trackers";
@@ -1866,19 +1988,27 @@ void RestAPI::torrents_trackers_get(std::shared_ptr<HttpServer::Response> respon
 			rapidjson::Value temp_value;
 			for(lt::announce_entry tf : torrent_trackers) {
 				rapidjson::Value f(rapidjson::kObjectType);
-				f.AddMember("tier", tf.tier, allocator);
-				temp_value.SetString(tf.url.c_str(), tf.url.length(), allocator);
-				f.AddMember("url", temp_value, allocator);
-				f.AddMember("next_announce", lt::duration_cast<lt::seconds>(tf.next_announce - std::chrono::system_clock::now()).count(), allocator);
-				std::string is_working;
-				if(tf.is_working())
-					is_working = "true";
-				else
-					is_working = "false";
-				temp_value.SetString(is_working.c_str(), is_working.length(), allocator);
-				f.AddMember("is_working", temp_value, allocator);
-				temp_value.SetString(tf.message.c_str(), tf.message.length(), allocator);
-				f.AddMember("message", temp_value, allocator);
+				if(fields.has(tracker_tier))
+					f.AddMember("tier", tf.tier, allocator);
+				if(fields.has(tracker_url)) {
+					temp_value.SetString(tf.url.c_str(), tf.url.length(), allocator);
+					f.AddMember("url", temp_value, allocator);
+				}
+				if(fields.has(tracker_next_announce))
+					f.AddMember("next_announce", lt::duration_cast<lt::seconds>(tf.next_announce - std::chrono::system_clock::now()).count(), allocator);
+				if(fields.has(tracker_is_working)) {
+					std::string is_working;
+					if(tf.is_working())
+						is_working = "true";
+					else
+						is_working = "false";
+					temp_value.SetString(is_working.c_str(), is_working.length(), allocator);
+					f.AddMember("is_working", temp_value, allocator);
+				}
+				if(fields.has(tracker_message)) {
+					temp_value.SetString(tf.message.c_str(), tf.message.length(), allocator);
+					f.AddMember("message", temp_value, allocator);
+				}
 				files.PushBack(f, allocator);
 			}
 			t.AddMember("trackers", files, allocator);
@@ -1889,23 +2019,12 @@ void RestAPI::torrents_trackers_get(std::shared_ptr<HttpServer::Response> respon
 		}
 		document.AddMember("torrents", torrents, allocator);
 
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -1917,24 +2036,12 @@ void RestAPI::torrents_trackers_get(std::shared_ptr<HttpServer::Response> respon
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -1965,7 +2072,6 @@ void RestAPI::program_status_get(std::shared_ptr<HttpServer::Response> response,
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	// TODO - change the name of the variables here. I copied it from elsewhere
 	char const *message = "Succesfuly retrieved program status";
 	document.AddMember("message", rapidjson::StringRef(message), allocator);
@@ -1996,26 +2102,241 @@ void RestAPI::program_status_get(std::shared_ptr<HttpServer::Response> response,
 	status.AddMember("num_peers_connected", session_status.num_peers_connected, allocator);
 	status.AddMember("num_peers_half_open", session_status.num_peers_half_open, allocator);
 	status.AddMember("total_peers_connections", session_status.total_peers_connections, allocator);
+	rapidjson::Value alert_latency(rapidjson::kObjectType);
+	alert_latency.AddMember("alerts_handled", session_status.alerts_handled, allocator);
+	alert_latency.AddMember("last", session_status.alert_latency_last, allocator);
+	alert_latency.AddMember("max", session_status.alert_latency_max, allocator);
+	alert_latency.AddMember("average", session_status.alerts_handled > 0 ?
+			session_status.alert_latency_total / session_status.alerts_handled : 0, allocator);
+	status.AddMember("alert_latency", alert_latency, allocator);
+	FastresumeLoader::progress const fastresume_progress = torrent_manager.get_fastresume_progress();
+	rapidjson::Value fastresume(rapidjson::kObjectType);
+	fastresume.AddMember("total", static_cast<uint64_t>(fastresume_progress.total), allocator);
+	fastresume.AddMember("loaded", static_cast<uint64_t>(fastresume_progress.loaded), allocator);
+	fastresume.AddMember("failed", static_cast<uint64_t>(fastresume_progress.failed), allocator);
+	fastresume.AddMember("finished", fastresume_progress.finished, allocator);
+	status.AddMember("fastresume_loading", fastresume, allocator);
 	program.AddMember("status", status, allocator);		
 	document.AddMember("program", program, allocator);
 
-	std::string json = stringfy_document(document);	
+	http_status = "200 OK";
+
+	LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
+		<< " to " << request->remote_endpoint_address() << " Message: " << message;
+
+	send_json(response, request, document, http_status, http_header);
+}
 
-	if(accepts_gzip_encoding(request->header)) {
-		ss_response << gzip_encode(json);
-		http_header += "Content-Encoding: gzip\r\n";
+/* Prometheus scrape target. torrents=true adds per torrent gauges. Everything comes from the counters and status caches,
+ so a scrape never waits on libtorrent. */
+void RestAPI::metrics_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
+	if(!validate_authorization(request)) {
+		respond_invalid_authorization(response, request);
+		return;
 	}
-	else {
-		ss_response << json;
+
+	std::map<std::string, api_parameter> required_parameters = {};
+	std::map<std::string, api_parameter> optional_parameters = {
+		{"torrents",{"torrents","false",api_parameter_format::boolean,{"true","false"}}} };
+	SimpleWeb::CaseInsensitiveMultimap query = request->parse_query_string();
+	std::string invalid_parameter = validate_all_parameters(query, required_parameters, optional_parameters);
+	if(invalid_parameter.length() > 0) { 
+		respond_invalid_parameter(response, request, invalid_parameter);
+		return;
+	}
+
+	// Keeps its capacity between scrapes, so rendering does not reallocate once it has grown to the usual size
+	thread_local std::string body;
+	body.clear();
+	std::shared_ptr<SessionCounters::sample const> sample = torrent_manager.get_session_counters().get_last_sample();
+	if(sample)
+		metrics_exporter.render_session(body, *sample);
+	if(str_to_bool(optional_parameters.find("torrents")->second.value)) {
+		TorrentManager::status_delta delta;
+		torrent_manager.get_torrents_status_delta(delta, std::vector<unsigned long int>(), 0);
+		metrics_exporter.render_torrents(body, delta.ids, delta.torrents_status);
+	}
+
+	std::string http_header;
+	std::string http_status = "200 OK";
+	send_body(response, request, http_status, http_header, "text/plain; version=0.0.4; charset=utf-8", body.data(), body.size(),
+			body_class::text);
+
+	LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
+		<< " to " << request->remote_endpoint_address();
+}
+
+/* resolution: 1 (last hour, one sample per second) or 60 (last week, one sample per minute). from/to: unix time window.
+ Each series is an array aligned with the time array. */
+void RestAPI::program_status_history_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
+	if(!validate_authorization(request)) {
+		respond_invalid_authorization(response, request);
+		return;
+	}
+
+	std::map<std::string, api_parameter> required_parameters = {};
+	std::map<std::string, api_parameter> optional_parameters = {
+		{"resolution",{"resolution","1",api_parameter_format::int_number,{"1","60"}}},
+		{"from",{"from","0",api_parameter_format::int_number,{}}},
+		{"to",{"to","0",api_parameter_format::int_number,{}}} };
+	SimpleWeb::CaseInsensitiveMultimap query = request->parse_query_string();
+	std::string invalid_parameter = validate_all_parameters(query, required_parameters, optional_parameters);
+	if(invalid_parameter.length() > 0) { 
+		respond_invalid_parameter(response, request, invalid_parameter);
+		return;
+	}
+
+	int const resolution = std::stoi(optional_parameters.find("resolution")->second.value);
+	std::time_t const from = std::stol(optional_parameters.find("from")->second.value);
+	std::time_t to = std::stol(optional_parameters.find("to")->second.value);
+	if(to == 0)
+		to = std::numeric_limits<std::time_t>::max();
+	SessionHistory::window window;
+	torrent_manager.get_session_history().get_window(window, resolution, from, to);
+
+	std::string http_header;
+	std::string origin_str;
+	std::string credentials_str = "true";
+	if(enable_CORS) {
+		auto header = request->header;
+		
+		auto origin = header.find("Origin");
+		if(origin != header.end()) {
+			origin_str = origin->second;
+		}
+
+		http_header += "Access-Control-Allow-Origin: " + origin_str + "\r\n";
+		http_header += "Access-Control-Allow-Credentials: " + credentials_str + "\r\n";
 	}
-	http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-	http_header += "Content-Type: application/json\r\n";
+
+	rapidjson::Document document;
+	document.SetObject();
+	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
+	std::string http_status;
+	char const *message = "Succesfuly retrieved program status history";
+	document.AddMember("message", rapidjson::StringRef(message), allocator);
+	rapidjson::Value history(rapidjson::kObjectType);
+	history.AddMember("resolution", window.resolution, allocator);
+	rapidjson::Value times(rapidjson::kArrayType);
+	times.Reserve(window.times.size(), allocator);
+	for(std::time_t time : window.times) {
+		times.PushBack(static_cast<int64_t>(time), allocator);
+	}
+	history.AddMember("time", times, allocator);
+	rapidjson::Value series(rapidjson::kObjectType);
+	std::vector<SessionHistory::series> const &all_series = SessionHistory::get_series();
+	for(std::size_t index = 0; index < all_series.size(); index++) {
+		rapidjson::Value values(rapidjson::kArrayType);
+		values.Reserve(window.values[index].size(), allocator);
+		for(long value : window.values[index]) {
+			values.PushBack(static_cast<int64_t>(value), allocator);
+		}
+		series.AddMember(rapidjson::StringRef(all_series[index].name), values, allocator);
+	}
+	history.AddMember("series", series, allocator);
+	document.AddMember("history", history, allocator);
+
 	http_status = "200 OK";
 
 	LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 		<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-	*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+	send_json(response, request, document, http_status, http_header);
+}
+
+// names: comma separated libtorrent metric names (e.g. disk.num_jobs,peer.num_peers_connected). All counters when missing.
+void RestAPI::program_counters_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
+	if(!validate_authorization(request)) {
+		respond_invalid_authorization(response, request);
+		return;
+	}
+
+	std::map<std::string, api_parameter> required_parameters = {};
+	std::map<std::string, api_parameter> optional_parameters = {
+		{"names",{"names","",api_parameter_format::text,{}}} };
+	SimpleWeb::CaseInsensitiveMultimap query = request->parse_query_string();
+	std::string invalid_parameter = validate_all_parameters(query, required_parameters, optional_parameters);
+	if(invalid_parameter.length() > 0) { 
+		respond_invalid_parameter(response, request, invalid_parameter);
+		return;
+	}
+
+	SessionCounters const &session_counters = torrent_manager.get_session_counters();
+	std::vector<SessionCounters::metric const*> requested_metrics;
+	std::string missing_name;
+	std::string names = optional_parameters.find("names")->second.value;
+	if(names.length() == 0) {
+		for(SessionCounters::metric const &m : session_counters.get_metrics()) {
+			requested_metrics.push_back(&m);
+		}
+	}
+	else {
+		for(std::string const &name : split_string(names, ',')) {
+			SessionCounters::metric const *m = session_counters.find(name);
+			if(!m) {
+				missing_name = name;
+				break;
+			}
+			requested_metrics.push_back(m);
+		}
+	}
+	// Empty until the first session_stats_alert is handled
+	std::shared_ptr<SessionCounters::sample const> sample = session_counters.get_last_sample();
+
+	std::string http_header;
+	std::string origin_str;
+	std::string credentials_str = "true";
+	if(enable_CORS) {
+		auto header = request->header;
+		
+		auto origin = header.find("Origin");
+		if(origin != header.end()) {
+			origin_str = origin->second;
+		}
+
+		http_header += "Access-Control-Allow-Origin: " + origin_str + "\r\n";
+		http_header += "Access-Control-Allow-Credentials: " + credentials_str + "\r\n";
+	}
+
+	rapidjson::Document document;
+	document.SetObject();
+	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
+	std::string http_status;
+	char const *message;
+	if(missing_name.length() == 0) {
+		message = "Succesfuly retrieved program counters";
+		document.AddMember("message", rapidjson::StringRef(message), allocator);
+		document.AddMember("interval", sample ? static_cast<int64_t>(sample->interval.count()) : 0, allocator);
+		rapidjson::Value counters(rapidjson::kObjectType);
+		for(SessionCounters::metric const *m : requested_metrics) {
+			rapidjson::Value c(rapidjson::kObjectType);
+			c.AddMember("type", rapidjson::StringRef(m->is_gauge ? "gauge" : "counter"), allocator);
+			c.AddMember("value", sample ? sample->values[m->value_index] : 0, allocator);
+			if(!m->is_gauge)
+				c.AddMember("rate", sample ? sample->rates[m->value_index] : 0.0, allocator);
+			counters.AddMember(rapidjson::StringRef(m->name.c_str(), m->name.length()), c, allocator);
+		}
+		document.AddMember("counters", counters, allocator);
+		http_status = "200 OK";
+	}
+	else {
+		rapidjson::Value errors(rapidjson::kArrayType);
+		rapidjson::Value e(rapidjson::kObjectType);
+		e.AddMember("code", 3300, allocator);
+		message = error_codes.find(3300)->second.c_str();
+		e.AddMember("message", rapidjson::StringRef(message), allocator);
+		rapidjson::Value temp_value;
+		temp_value.SetString(missing_name.c_str(), missing_name.length(), allocator);
+		e.AddMember("name", temp_value, allocator);
+		errors.PushBack(e, allocator);
+		document.AddMember("errors", errors, allocator);
+		http_status = "404 Not Found";
+	}
+
+	LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
+		<< " to " << request->remote_endpoint_address() << " Message: " << message;
+
+	send_json(response, request, document, http_status, http_header);
 }
 
 void RestAPI::program_settings_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
@@ -2045,7 +2366,6 @@ void RestAPI::program_settings_get(std::shared_ptr<HttpServer::Response> respons
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	// TODO - change the name of the variables here. I copied it from elsewhere
 	char const *message = "Succesfuly retrieved program settings";
 	document.AddMember("message", rapidjson::StringRef(message), allocator);
@@ -2075,23 +2395,12 @@ void RestAPI::program_settings_get(std::shared_ptr<HttpServer::Response> respons
 	program.AddMember("settings", settings, allocator);		
 	document.AddMember("program", program, allocator);
 
-	std::string json = stringfy_document(document);	
-
-	if(accepts_gzip_encoding(request->header)) {
-		ss_response << gzip_encode(json);
-		http_header += "Content-Encoding: gzip\r\n";
-	}
-	else {
-		ss_response << json;
-	}
-	http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-	http_header += "Content-Type: application/json\r\n";
 	http_status = "200 OK";
 
 	LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 		<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-	*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+	send_json(response, request, document, http_status, http_header);
 }
 
 
@@ -2101,6 +2410,20 @@ void RestAPI::torrents_info_get(std::shared_ptr<HttpServer::Response> response,
 		return;
 	}
 
+	std::map<std::string, api_parameter> required_parameters = {};
+	std::map<std::string, api_parameter> optional_parameters = {
+		{"fields",{"fields","",api_parameter_format::text,{}}} };
+	SimpleWeb::CaseInsensitiveMultimap query = request->parse_query_string();
+	std::string invalid_parameter = validate_all_parameters(query, required_parameters, optional_parameters);
+	FieldMask fields;
+	if(invalid_parameter.length() == 0 && query.find("fields") != query.end()
+			&& !fields.compile(optional_parameters.find("fields")->second.value, info_field_names))
+		invalid_parameter = "fields";
+	if(invalid_parameter.length() > 0) { 
+		respond_invalid_parameter(response, request, invalid_parameter);
+		return;
+	}
+
 	std::vector<unsigned long int> ids = split_string_to_ulong(request->path_match[1], ',');
 	// TODO - Inefficient. When ids.size() = 0 should be treated inside the calls, not here.
 	if(ids.size() == 0) // If no ids were specified, consider all ids
@@ -2127,7 +2450,6 @@ void RestAPI::torrents_info_get(std::shared_ptr<HttpServer::Response> response,
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "Succesfuly retrieved torrent info";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
@@ -2137,30 +2459,47 @@ void RestAPI::torrents_info_get(std::shared_ptr<HttpServer::Response> response,
 			rapidjson::Value t(rapidjson::kObjectType);
 			rapidjson::Value s(rapidjson::kObjectType);
 			rapidjson::Value temp_value;
-			s.AddMember("total_size", ti->total_size(), allocator);
-			s.AddMember("num_pieces", ti->num_pieces(), allocator);
-			s.AddMember("piece_length", ti->piece_length(), allocator);
+			if(fields.has(info_total_size))
+				s.AddMember("total_size", ti->total_size(), allocator);
+			if(fields.has(info_num_pieces))
+				s.AddMember("num_pieces", ti->num_pieces(), allocator);
+			if(fields.has(info_piece_length))
+				s.AddMember("piece_length", ti->piece_length(), allocator);
 			/* info_hash: If this handle is to a torrent that hasn't loaded yet (for instance by being added) by a URL,
 			   the returned value is undefined. */
-			std::stringstream ss_info_hash;
-			ss_info_hash << ti->info_hash();
-			std::string info_hash = ss_info_hash.str();
-			temp_value.SetString(info_hash.c_str(), info_hash.length(), allocator);
-			s.AddMember("info_hash", temp_value, allocator);	
-			s.AddMember("num_files", ti->num_files(), allocator);
-			temp_value.SetString(ti->ssl_cert().c_str(), ti->ssl_cert().length(), allocator);
-			s.AddMember("ssl_cert", temp_value, allocator);
-			s.AddMember("priv", ti->priv(), allocator);
-			s.AddMember("is_i2p", ti->is_i2p(), allocator);
-			s.AddMember("is_loaded", ti->is_loaded(), allocator);
-			if(ti->creation_date())
+			if(fields.has(info_info_hash)) {
+				std::stringstream ss_info_hash;
+				ss_info_hash << ti->info_hash();
+				std::string info_hash = ss_info_hash.str();
+				temp_value.SetString(info_hash.c_str(), info_hash.length(), allocator);
+				s.AddMember("info_hash", temp_value, allocator);	
+			}
+			if(fields.has(info_num_files))
+				s.AddMember("num_files", ti->num_files(), allocator);
+			if(fields.has(info_ssl_cert)) {
+				temp_value.SetString(ti->ssl_cert().c_str(), ti->ssl_cert().length(), allocator);
+				s.AddMember("ssl_cert", temp_value, allocator);
+			}
+			if(fields.has(info_priv))
+				s.AddMember("priv", ti->priv(), allocator);
+			if(fields.has(info_is_i2p))
+				s.AddMember("is_i2p", ti->is_i2p(), allocator);
+			if(fields.has(info_is_loaded))
+				s.AddMember("is_loaded", ti->is_loaded(), allocator);
+			if(fields.has(info_creation_date) && ti->creation_date())
 				s.AddMember("creation_date", ti->creation_date().get(), allocator);
-			temp_value.SetString(ti->name().c_str(), ti->name().length(), allocator);
-			s.AddMember("name", temp_value, allocator);
-			temp_value.SetString(ti->comment().c_str(), ti->comment().length(), allocator);
-			s.AddMember("comment", temp_value, allocator);
-			temp_value.SetString(ti->creator().c_str(), ti->creator().length(), allocator);
-			s.AddMember("creator", temp_value, allocator);
+			if(fields.has(info_name)) {
+				temp_value.SetString(ti->name().c_str(), ti->name().length(), allocator);
+				s.AddMember("name", temp_value, allocator);
+			}
+			if(fields.has(info_comment)) {
+				temp_value.SetString(ti->comment().c_str(), ti->comment().length(), allocator);
+				s.AddMember("comment", temp_value, allocator);
+			}
+			if(fields.has(info_creator)) {
+				temp_value.SetString(ti->creator().c_str(), ti->creator().length(), allocator);
+				s.AddMember("creator", temp_value, allocator);
+			}
 			t.AddMember("info", s, allocator);
 			std::string temp_id = std::to_string(*it_ids);
 			temp_value.SetString(temp_id.c_str(), temp_id.length(), allocator);
@@ -2169,24 +2508,12 @@ void RestAPI::torrents_info_get(std::shared_ptr<HttpServer::Response> response,
 		}
 		document.AddMember("torrents", torrents, allocator);
 
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -2198,24 +2525,12 @@ void RestAPI::torrents_info_get(std::shared_ptr<HttpServer::Response> response,
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -2251,7 +2566,6 @@ void RestAPI::torrents_settings_get(std::shared_ptr<HttpServer::Response> respon
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "Succesfuly retrieved torrent settings";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
@@ -2275,24 +2589,12 @@ void RestAPI::torrents_settings_get(std::shared_ptr<HttpServer::Response> respon
 		}
 		document.AddMember("torrents", torrents, allocator);
 
-		std::string json = stringfy_document(document);	
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -2304,24 +2606,12 @@ void RestAPI::torrents_settings_get(std::shared_ptr<HttpServer::Response> respon
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -2393,27 +2683,15 @@ void RestAPI::torrents_settings_set(std::shared_ptr<HttpServer::Response> respon
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "Succesfuly changed torrent settings";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
-		std::string json = stringfy_document(document);	
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -2425,24 +2703,12 @@ void RestAPI::torrents_settings_set(std::shared_ptr<HttpServer::Response> respon
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -2519,27 +2785,15 @@ void RestAPI::program_settings_set(std::shared_ptr<HttpServer::Response> respons
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "Succesfuly changed program settings";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
-		std::string json = stringfy_document(document);	
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -2551,24 +2805,12 @@ void RestAPI::program_settings_set(std::shared_ptr<HttpServer::Response> respons
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
@@ -2636,27 +2878,15 @@ void RestAPI::queue_torrents_set(std::shared_ptr<HttpServer::Response> response,
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	if(result == 0) {
 		char const *message = "Succesfuly changed queue position";
 		document.AddMember("message", rapidjson::StringRef(message), allocator);
-		std::string json = stringfy_document(document);	
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-		
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "200 OK";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 	else {
 		rapidjson::Value errors(rapidjson::kArrayType);
@@ -2668,30 +2898,17 @@ void RestAPI::queue_torrents_set(std::shared_ptr<HttpServer::Response> response,
 		errors.PushBack(e, allocator);
 		document.AddMember("errors", errors, allocator);
 
-		std::string json = stringfy_document(document);
-
-		if(accepts_gzip_encoding(request->header)) {
-			ss_response << gzip_encode(json);
-			http_header += "Content-Encoding: gzip\r\n";
-		}
-		else {
-			ss_response << json;
-		}
-
-		http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-		http_header += "Content-Type: application/json\r\n";
 		http_status = "404 Not Found";
 
 		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 			<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-		*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+		send_json(response, request, document, http_status, http_header);
 	}
 }
 
-// TODO - this is TEMPORARY. a GET /authorization method to allow the front-end to verify the login. In the future we need to create a GET /token
-// similar to the PayPal API and work with access tokens. https://developer.paypal.com/docs/api/overview/#make-your-first-call
-// I dont like the way the responses to this request work. Improve. 
+/* Lets the front-end verify the login. When called with Basic credentials it also returns a bearer access token, so later
+ requests can send "Authorization: Bearer <token>" instead of the password until expires_in seconds go by. */
 void RestAPI::get_authorization(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
 	if(!validate_authorization(request)) {
 		respond_invalid_authorization(response, request);
@@ -2717,27 +2934,28 @@ void RestAPI::get_authorization(std::shared_ptr<HttpServer::Response> response,
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	char const *message = "valid Authorization. Access allowed";
 	document.AddMember("message", rapidjson::StringRef(message), allocator);
-
-	std::string json = stringfy_document(document);	
-
-	if(accepts_gzip_encoding(request->header)) {
-		ss_response << gzip_encode(json);
-		http_header += "Content-Encoding: gzip\r\n";
-	}
-	else {
-		ss_response << json;
+	// Only a password can get a new token. Clients that already use a token keep it until it expires.
+	std::string const decoded = decode_basic_auth(request->header.find("Authorization")->second);
+	std::vector<std::string> const user_pass = split_string(decoded, ':');
+	if(user_pass.size() == 2) {
+		std::string const token = authorization_manager.issue_token(user_pass.at(0));
+		if(!token.empty()) {
+			rapidjson::Value temp_value;
+			temp_value.SetString(token.c_str(), token.length(), allocator);
+			document.AddMember("token", temp_value, allocator);
+			document.AddMember("token_type", "Bearer", allocator);
+			document.AddMember("expires_in", static_cast<int64_t>(authorization_manager.get_token_lifetime().count()), allocator);
+		}
 	}
-	http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-	http_header += "Content-Type: application/json\r\n";
+
 	http_status = "200 OK";
 
 	LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 		<< " to " << request->remote_endpoint_address() << " Message: " << message;
 
-	*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+	send_json(response, request, document, http_status, http_header);
 }
 
 
@@ -2780,7 +2998,6 @@ void RestAPI::server_directory_get(std::shared_ptr<HttpServer::Response> respons
 	document.SetObject();
 	rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
 	std::string http_status;
-	std::stringstream ss_response;
 	fs::path p = required_parameters.find("path")->second.value;
 	// TODO - What if user has no permission to read directory? Error? Test this.
 	if(fs::is_directory(p)) {
@@ -2827,27 +3044,99 @@ void RestAPI::server_directory_get(std::shared_ptr<HttpServer::Response> respons
 		// TODO - log/respond. path is not directory
 	}
 
-	std::string json = stringfy_document(document);	
-
-	if(accepts_gzip_encoding(request->header)) {
-		ss_response << gzip_encode(json);
-		http_header += "Content-Encoding: gzip\r\n";
-	}
-	else {
-		ss_response << json;
-	}
-	http_header += "Content-Length: " + std::to_string(ss_response.str().length()) + "\r\n";
-	http_header += "Content-Type: application/json\r\n";
 	http_status = "200 OK";
 
 	LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
 		<< " to " << request->remote_endpoint_address();
 
-	*response << "HTTP/1.1 " << http_status << "\r\n" << http_header << "\r\n" << ss_response.str();
+	send_json(response, request, document, http_status, http_header);
+}
+
+/* Streams a file of a torrent while it downloads. Pieces under the requested ranges are downloaded first and each is sent as
+ soon as it is available, so playback can start before the torrent completes and a seek (a new Range request) only waits for
+ the pieces it needs. */
+void RestAPI::torrents_files_stream_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
+	if(!validate_authorization(request)) {
+		respond_invalid_authorization(response, request);
+		return;
+	}
+
+	std::shared_ptr<TorrentStream> stream;
+	unsigned long int id = 0;
+	try {
+		id = std::stoul(request->path_match[1]);
+		int const file = std::stoi(request->path_match[2]);
+		stream = torrent_manager.open_stream(id, file, stream_readahead, stream_timeout);
+	}
+	catch(std::out_of_range const &e) {
+		// Numbers too big to be an id or an index of anything
+	}
+
+	if(!stream) {
+		std::string http_header;
+		std::string origin_str;
+		std::string credentials_str = "true";
+		if(enable_CORS) {
+			auto header = request->header;
+			
+			auto origin = header.find("Origin");
+			if(origin != header.end()) {
+				origin_str = origin->second;
+			}
+
+			http_header += "Access-Control-Allow-Origin: " + origin_str + "\r\n";
+			http_header += "Access-Control-Allow-Credentials: " + credentials_str + "\r\n";
+		}
+
+		rapidjson::Document document;
+		document.SetObject();
+		rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
+		rapidjson::Value errors(rapidjson::kArrayType);
+		rapidjson::Value e(rapidjson::kObjectType);
+		e.AddMember("code", 3310, allocator);
+		char const *message = error_codes.find(3310)->second.c_str();
+		e.AddMember("message", rapidjson::StringRef(message), allocator);
+		e.AddMember("id", id, allocator);
+		errors.PushBack(e, allocator);
+		document.AddMember("errors", errors, allocator);
+
+		std::string http_status = "404 Not Found";
+
+		LOG_DEBUG << "HTTP " << request->method << " " << request->path << " "  << http_status
+			<< " to " << request->remote_endpoint_address() << " Message: " << message;
+
+		send_json(response, request, document, http_status, http_header);
+		return;
+	}
+
+	SimpleWeb::CaseInsensitiveMultimap header;
+	if(enable_CORS) {
+		auto origin = request->header.find("Origin");
+		header.emplace("Access-Control-Allow-Origin", origin != request->header.end() ? origin->second : "");
+		header.emplace("Access-Control-Allow-Credentials", "true");
+	}
+	// The content of a file in a torrent never changes, so the info hash and the file index identify it
+	std::stringstream etag;
+	etag << "\"" << stream->get_info_hash() << "-" << request->path_match[2] << "\"";
+	std::shared_ptr<stream_body> body = std::make_shared<stream_body>();
+	body->stream = stream;
+	SimpleWeb::StatusCode const status = prepare_ranged_body(request, stream->size(), etag.str(), std::string(), header, *body);
+	response->write(status, header);
+	LOG_DEBUG << "HTTP " << request->method << " " << request->path << " " << SimpleWeb::status_code(status)
+		<< " to " << request->remote_endpoint_address() << " Streaming " << stream->get_name();
+	if(status == SimpleWeb::StatusCode::client_error_range_not_satisfiable)
+		return;
+	// The headers go out right away, so the client does not give up while the first piece downloads
+	response->send([response, body](const SimpleWeb::error_code &ec) {
+		if(ec) {
+			LOG_DEBUG << "Stream interrupted: " << ec.message();
+			return;
+		}
+		send_stream_body(response, body, 0);
+	});
 }
 
 // TODO - This is INSECURE. The Client has access to the entire filesystem. Fix this allowing only access to the torrents folders and files.
-// TODO - As far as I know the video file here is being sent sequentially, therefore the client will have problems jumping forward in the torrent video stream (more noticeably in slower and remote connections). This is ok for now, another approach should be implemented soon. Search for HTTP 206 Partial Content and streaming!! ( I am not sure about that. Test before in a slow, non localhost connection)
 void RestAPI::stream_get(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
 
 	// TODO - VERY IMPORTANT. ADD THE AUTHORIZATION CHECK HERE. 
@@ -2874,60 +3163,26 @@ void RestAPI::stream_get(std::shared_ptr<HttpServer::Response> response, std::sh
 		//    Uncomment the following line to enable Cache-Control
 		//    header.emplace("Cache-Control", "max-age=86400");
 
-#ifdef HAVE_OPENSSL
-		//    Uncomment the following lines to enable ETag
-		//    {
-		//      ifstream ifs(path.string(), ifstream::in | ios::binary);
-		//      if(ifs) {
-		//        auto hash = SimpleWeb::Crypto::to_hex_string(SimpleWeb::Crypto::md5(ifs));
-		//        header.emplace("ETag", "\"" + hash + "\"");
-		//        auto it = request->header.find("If-None-Match");
-		//        if(it != request->header.end()) {
-		//          if(!it->second.empty() && it->second.compare(1, hash.size(), hash) == 0) {
-		//            response->write(SimpleWeb::StatusCode::redirection_not_modified, header);
-		//            return;
-		//          }
-		//        }
-		//      }
-		//      else
-		//        throw invalid_argument("could not read file");
-		//    }
-#endif
-
-		auto ifs = std::make_shared<std::ifstream>();
-		ifs->open(path.string(), std::ifstream::in | std::ios::binary | std::ios::ate);
-
-		if(*ifs) {
-			auto length = ifs->tellg();
-			ifs->seekg(0, std::ios::beg);
-
-			header.emplace("Content-Length", std::to_string(length)); // TODO - There are more headers that SHOULD be here so clients will know the filename, file extension, video format etc. Like Content-Disposition. Google about this. What headers are needed to stream? 
-			response->write(header);
-
-			// Trick to define a recursive function within this scope (for your convenience)
-			class FileServer {
-				public:
-					static void read_and_send(const std::shared_ptr<HttpServer::Response> &response, const std::shared_ptr<std::ifstream> &ifs) {
-						// Read and send 128 KB at a time
-						static std::vector<char> buffer(131072); // Safe when server is running on one thread
-						std::streamsize read_length;
-						if((read_length = ifs->read(&buffer[0], buffer.size()).gcount()) > 0) {
-							response->write(&buffer[0], read_length);
-							if(read_length == static_cast<std::streamsize>(buffer.size())) {
-								response->send([response, ifs](const SimpleWeb::error_code &ec) {
-										if(!ec)
-										read_and_send(response, ifs);
-										else
-										std::cerr << "Connection interrupted" << std::endl; // TODO - log
-										});
-							}
-						}
-					}
-			};
-			FileServer::read_and_send(response, ifs);
-		}
-		else
+		int const fd = ::open(path.string().c_str(), O_RDONLY | O_CLOEXEC);
+		if(fd < 0)
 			throw std::invalid_argument("could not read file");
+		struct stat file_status;
+		if(::fstat(fd, &file_status) != 0) {
+			::close(fd);
+			throw std::invalid_argument("could not read file");
+		}
+		std::uint64_t const size = file_status.st_size;
+		std::shared_ptr<file_body> body = std::make_shared<file_body>(fd);
+
+		// Built from the size and modification time, so a file that changes gets a new ETag without being hashed
+		std::stringstream etag;
+		etag << std::hex << "\"" << size << "-" << file_status.st_mtim.tv_sec << "-" << file_status.st_mtim.tv_nsec << "\"";
+		SimpleWeb::StatusCode const status = prepare_ranged_body(request, size, etag.str(),
+				format_http_date(file_status.st_mtim.tv_sec), header, *body);
+		response->write(status, header); // TODO - There are more headers that SHOULD be here so clients will know the filename, file extension, video format etc. Like Content-Disposition. Google about this. What headers are needed to stream? 
+		if(status == SimpleWeb::StatusCode::client_error_range_not_satisfiable)
+			return;
+		send_file_body(response, body, 0);
 	}
 	catch(const std::exception &e) {
 		response->write(SimpleWeb::StatusCode::client_error_bad_request, "Could not open path " + request->path + ": " + e.what());
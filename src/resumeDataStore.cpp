@@ -0,0 +1,231 @@
+#include "resumeDataStore.h"
+#include <libtorrent/bencode.hpp>
+#include <iterator>
+#include <unordered_map>
+#include "utility.h"
+#include "plog/Log.h"
+
+ResumeDataStore::ResumeDataStore() : db(NULL), save_stmt(NULL), remove_stmt(NULL), busy(false), stopping(false) {
+	thread = std::thread([this]() { run(); });
+}
+
+// Everything queued is written before the thread stops
+ResumeDataStore::~ResumeDataStore() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeup.notify_one();
+	thread.join();
+
+	sqlite3_finalize(save_stmt);
+	sqlite3_finalize(remove_stmt);
+	sqlite3_close(db);
+}
+
+bool ResumeDataStore::execute(char const *sql) {
+	char *error_msg = NULL;
+	if(sqlite3_exec(db, sql, NULL, NULL, &error_msg) != SQLITE_OK) {
+		LOG_ERROR << "Problem while evaluating SQL: " << sql << ". SQLite3 error_msg: " << (error_msg ? error_msg : "");
+		sqlite3_free(error_msg);
+		return false;
+	}
+	return true;
+}
+
+/* WAL lets the auth queries read the database while a batch is being written. synchronous=NORMAL only syncs on checkpoints,
+ so a power loss may lose the last batches but never corrupts the database. */
+bool ResumeDataStore::open(fs::path const &database_path) {
+	std::lock_guard<std::mutex> lock(db_mutex);
+	if(sqlite3_open(database_path.string().c_str(), &db) != SQLITE_OK) {
+		LOG_ERROR << "Could not open database " << database_path.string() << ". SQLite3 error_msg: " << sqlite3_errmsg(db);
+		sqlite3_close(db);
+		db = NULL;
+		return false;
+	}
+	sqlite3_busy_timeout(db, 5000);
+
+	if(!execute("PRAGMA journal_mode=WAL;") ||
+			!execute("PRAGMA synchronous=NORMAL;") ||
+			!execute("CREATE TABLE IF NOT EXISTS fastresume (info_hash TEXT PRIMARY KEY NOT NULL, resume_data BLOB NOT NULL);")) {
+		sqlite3_close(db);
+		db = NULL;
+		return false;
+	}
+
+	char const *save_sql = "INSERT OR REPLACE INTO fastresume (info_hash, resume_data) VALUES (?, ?);";
+	char const *remove_sql = "DELETE FROM fastresume WHERE info_hash = ?;";
+	if(sqlite3_prepare_v2(db, save_sql, -1, &save_stmt, NULL) != SQLITE_OK ||
+			sqlite3_prepare_v2(db, remove_sql, -1, &remove_stmt, NULL) != SQLITE_OK) {
+		LOG_ERROR << "Could not compile SQL for fastresume. SQLite3 error_msg: " << sqlite3_errmsg(db);
+		sqlite3_finalize(save_stmt);
+		sqlite3_finalize(remove_stmt);
+		save_stmt = NULL;
+		remove_stmt = NULL;
+		sqlite3_close(db);
+		db = NULL;
+		return false;
+	}
+	return true;
+}
+
+/* Imports the <info hash>.fastresume files written by older versions in a single transaction, then deletes them. Rows already
+ in the database are newer, so they are kept. Returns the number of files imported. */
+unsigned long int ResumeDataStore::migrate_files(fs::path const &fastresume_path) {
+	std::vector<fs::path> fastresume_files;
+	if(!fs::is_directory(fastresume_path) || !get_files_in_folder(fastresume_path, ".fastresume", fastresume_files))
+		return 0;
+	if(fastresume_files.empty())
+		return 0;
+
+	std::lock_guard<std::mutex> lock(db_mutex);
+	if(!db)
+		return 0;
+	sqlite3_stmt *stmt;
+	char const *sql = "INSERT OR IGNORE INTO fastresume (info_hash, resume_data) VALUES (?, ?);";
+	if(sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+		LOG_ERROR << "Could not compile SQL: " << sql << ". SQLite3 error_msg: " << sqlite3_errmsg(db);
+		return 0;
+	}
+
+	execute("BEGIN;");
+	std::vector<fs::path> imported;
+	for(fs::path const &fastresume_file : fastresume_files) {
+		std::vector<char> buffer;
+		if(!file_to_buffer(buffer, fastresume_file.string()) || buffer.empty()) {
+			LOG_ERROR << "Could not open fastresume file: " << fastresume_file.string();
+			continue;
+		}
+		std::string const info_hash = fastresume_file.stem().string();
+		sqlite3_bind_text(stmt, 1, info_hash.c_str(), info_hash.size(), SQLITE_STATIC);
+		sqlite3_bind_blob(stmt, 2, buffer.data(), buffer.size(), SQLITE_STATIC);
+		if(sqlite3_step(stmt) == SQLITE_DONE)
+			imported.push_back(fastresume_file);
+		else
+			LOG_ERROR << "Could not import fastresume file " << fastresume_file.string() << ". SQLite3 error_msg: " << sqlite3_errmsg(db);
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+	}
+	sqlite3_finalize(stmt);
+
+	if(!execute("COMMIT;")) {
+		execute("ROLLBACK;");
+		return 0;
+	}
+
+	// The files are only deleted once their data is committed
+	for(fs::path const &fastresume_file : imported) {
+		boost::system::error_code ec;
+		fs::remove(fastresume_file, ec);
+	}
+	LOG_INFO << "Migrated " << imported.size() << " fastresume files from " << fastresume_path.string() << " to the database";
+	return imported.size();
+}
+
+// One sequential scan of the table. Rows are returned as the bencoded resume data.
+bool ResumeDataStore::load_all(std::vector<std::vector<char>> &resume_data) {
+	std::lock_guard<std::mutex> lock(db_mutex);
+	if(!db)
+		return false;
+	sqlite3_stmt *stmt;
+	char const *sql = "SELECT resume_data FROM fastresume;";
+	if(sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+		LOG_ERROR << "Could not compile SQL: " << sql << ". SQLite3 error_msg: " << sqlite3_errmsg(db);
+		return false;
+	}
+
+	int ret_code;
+	while((ret_code = sqlite3_step(stmt)) == SQLITE_ROW) {
+		char const *blob = static_cast<char const*>(sqlite3_column_blob(stmt, 0));
+		int const size = sqlite3_column_bytes(stmt, 0);
+		resume_data.emplace_back(blob, blob + size);
+	}
+	if(ret_code != SQLITE_DONE) {
+		LOG_ERROR << "Problem while evaluating SQL: " << sql << ". SQLite3 error_msg: " << sqlite3_errmsg(db);
+	}
+	sqlite3_finalize(stmt);
+	return ret_code == SQLITE_DONE;
+}
+
+void ResumeDataStore::save(std::string const &info_hash, boost::shared_ptr<lt::entry> const resume_data) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(job{info_hash, resume_data});
+	}
+	wakeup.notify_one();
+}
+
+void ResumeDataStore::remove(std::string const &info_hash) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(job{info_hash, boost::shared_ptr<lt::entry>()});
+	}
+	wakeup.notify_one();
+}
+
+// Blocks until every job queued so far is committed
+void ResumeDataStore::flush() {
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]() { return jobs.empty() && !busy; });
+}
+
+void ResumeDataStore::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true) {
+		wakeup.wait(lock, [this]() { return !jobs.empty() || stopping; });
+		if(jobs.empty() && stopping)
+			break;
+
+		std::vector<job> batch(jobs.begin(), jobs.end());
+		jobs.clear();
+		busy = true;
+		lock.unlock();
+		write_batch(batch);
+		lock.lock();
+		busy = false;
+		if(jobs.empty())
+			idle.notify_all();
+	}
+}
+
+void ResumeDataStore::write_batch(std::vector<job> &batch) {
+	std::lock_guard<std::mutex> lock(db_mutex);
+	if(!db) {
+		LOG_ERROR << "Fastresume not saved. The database is not open";
+		return;
+	}
+
+	// Only the last job for each torrent matters
+	std::unordered_map<std::string, std::size_t> last_job;
+	for(std::size_t index = 0; index < batch.size(); index++) {
+		last_job[batch[index].info_hash] = index;
+	}
+
+	execute("BEGIN;");
+	std::vector<char> buffer;
+	for(std::size_t index = 0; index < batch.size(); index++) {
+		job const &j = batch[index];
+		if(last_job[j.info_hash] != index)
+			continue;
+
+		sqlite3_stmt *stmt = j.resume_data ? save_stmt : remove_stmt;
+		sqlite3_bind_text(stmt, 1, j.info_hash.c_str(), j.info_hash.size(), SQLITE_STATIC);
+		if(j.resume_data) {
+			buffer.clear();
+			lt::bencode(std::back_inserter(buffer), *j.resume_data);
+			sqlite3_bind_blob(stmt, 2, buffer.data(), buffer.size(), SQLITE_STATIC);
+		}
+		if(sqlite3_step(stmt) != SQLITE_DONE) {
+			LOG_ERROR << "Could not save fastresume for " << j.info_hash << ". SQLite3 error_msg: " << sqlite3_errmsg(db);
+		}
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+	}
+
+	if(execute("COMMIT;")) {
+		LOG_DEBUG << "Saved fastresume batch of " << last_job.size() << " torrents";
+	}
+	else {
+		execute("ROLLBACK;");
+	}
+}
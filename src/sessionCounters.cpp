@@ -0,0 +1,58 @@
+#include "sessionCounters.h"
+
+SessionCounters::SessionCounters() {
+	std::vector<lt::stats_metric> session_metrics = lt::session_stats_metrics();
+	metrics.reserve(session_metrics.size());
+	by_name.reserve(session_metrics.size());
+	for(lt::stats_metric const &m : session_metrics) {
+		by_name.emplace(m.name, metrics.size());
+		metrics.push_back(metric{m.name, m.value_index, m.type == lt::stats_metric::type_gauge});
+	}
+}
+
+std::vector<SessionCounters::metric> const &SessionCounters::get_metrics() const {
+	return metrics;
+}
+
+// Returns NULL if libtorrent has no metric with this name
+SessionCounters::metric const *SessionCounters::find(std::string const &name) const {
+	auto it = by_name.find(name);
+	if(it == by_name.end())
+		return NULL;
+	return &metrics[it->second];
+}
+
+// Same as lt::find_metric_idx(). Meant to be called once, when setting up, and not for every sample.
+int SessionCounters::find_index(std::string const &name) const {
+	metric const *m = find(name);
+	return m ? m->value_index : -1;
+}
+
+// Only the alert loop calls this. Readers get the published samples through get_last_sample().
+std::shared_ptr<SessionCounters::sample const> SessionCounters::update(boost::uint64_t const *values, std::size_t const count,
+		std::chrono::steady_clock::time_point const time) {
+	std::shared_ptr<sample const> previous = get_last_sample();
+	std::shared_ptr<sample> next = std::make_shared<sample>();
+	next->time = time;
+	next->interval = std::chrono::milliseconds(0);
+	next->values.assign(values, values + count);
+	next->rates.assign(count, 0.0);
+
+	if(previous && previous->values.size() == count && time > previous->time) {
+		next->interval = std::chrono::duration_cast<std::chrono::milliseconds>(time - previous->time);
+		double const seconds = std::chrono::duration<double>(time - previous->time).count();
+		for(metric const &m : metrics) {
+			if(m.is_gauge || m.value_index < 0 || static_cast<std::size_t>(m.value_index) >= count)
+				continue;
+			next->rates[m.value_index] = (next->values[m.value_index] - previous->values[m.value_index]) / seconds;
+		}
+	}
+
+	std::atomic_store(&last_sample, std::shared_ptr<sample const>(next));
+	return next;
+}
+
+// NULL until the first session_stats_alert is handled
+std::shared_ptr<SessionCounters::sample const> SessionCounters::get_last_sample() const {
+	return std::atomic_load(&last_sample);
+}
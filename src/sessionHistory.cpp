@@ -0,0 +1,96 @@
+#include "sessionHistory.h"
+
+std::size_t const SessionHistory::seconds_capacity;
+std::size_t const SessionHistory::minutes_capacity;
+
+SessionHistory::ring::ring(int const resolution, std::size_t const capacity) : resolution(resolution), capacity(capacity),
+	head(0), count(0), times(capacity, 0), values(capacity * SessionHistory::get_series().size(), 0) {
+}
+
+// Returns the row where the values of the new sample must be written
+long *SessionHistory::ring::push(std::time_t const time) {
+	std::size_t const position = head;
+	times[position] = time;
+	head = (head + 1) % capacity;
+	if(count < capacity)
+		count++;
+	return &values[position * SessionHistory::get_series().size()];
+}
+
+SessionHistory::SessionHistory() : seconds(1, seconds_capacity), minutes(60, minutes_capacity), current_minute(0),
+	samples_in_minute(0), minute_sums(get_series().size(), 0) {
+}
+
+std::vector<SessionHistory::series> const &SessionHistory::get_series() {
+	static std::vector<series> const all_series = {
+		{"download_rate", &SessionStatus::download_rate, true},
+		{"upload_rate", &SessionStatus::upload_rate, true},
+		{"payload_download_rate", &SessionStatus::payload_download_rate, true},
+		{"payload_upload_rate", &SessionStatus::payload_upload_rate, true},
+		{"ip_overhead_download_rate", &SessionStatus::ip_overhead_download_rate, true},
+		{"ip_overhead_upload_rate", &SessionStatus::ip_overhead_upload_rate, true},
+		{"dht_download_rate", &SessionStatus::dht_download_rate, true},
+		{"dht_upload_rate", &SessionStatus::dht_upload_rate, true},
+		{"tracker_download_rate", &SessionStatus::tracker_download_rate, true},
+		{"tracker_upload_rate", &SessionStatus::tracker_upload_rate, true},
+		{"total_peers_connections", &SessionStatus::total_peers_connections, false},
+		{"dht_nodes", &SessionStatus::dht_nodes, false}
+	};
+	return all_series;
+}
+
+void SessionHistory::add(std::time_t const time, SessionStatus const &status) {
+	std::vector<series> const &all_series = get_series();
+	std::lock_guard<std::mutex> lock(mutex);
+
+	long *row = seconds.push(time);
+	for(std::size_t index = 0; index < all_series.size(); index++) {
+		row[index] = status.*all_series[index].member;
+	}
+
+	std::time_t const minute = time - time % 60;
+	if(minute != current_minute)
+		flush_minute();
+	current_minute = minute;
+	samples_in_minute++;
+	for(std::size_t index = 0; index < all_series.size(); index++) {
+		if(all_series[index].is_rate)
+			minute_sums[index] += row[index];
+		else
+			minute_sums[index] = row[index];
+	}
+}
+
+// Moves the samples of the minute being accumulated into the minutes ring
+void SessionHistory::flush_minute() {
+	if(samples_in_minute == 0)
+		return;
+	std::vector<series> const &all_series = get_series();
+	long *row = minutes.push(current_minute);
+	for(std::size_t index = 0; index < all_series.size(); index++) {
+		row[index] = all_series[index].is_rate ? minute_sums[index] / static_cast<long>(samples_in_minute) : minute_sums[index];
+		minute_sums[index] = 0;
+	}
+	samples_in_minute = 0;
+}
+
+// Copies the samples with from <= time <= to, oldest first. resolution must be 1 or 60. The minute still being filled is not included.
+void SessionHistory::get_window(window &w, int const resolution, std::time_t const from, std::time_t const to) {
+	std::vector<series> const &all_series = get_series();
+	std::lock_guard<std::mutex> lock(mutex);
+	ring const &r = (resolution == 60) ? minutes : seconds;
+
+	w.resolution = r.resolution;
+	w.times.clear();
+	w.values.assign(all_series.size(), std::vector<long>());
+	std::size_t const oldest = (r.head + r.capacity - r.count) % r.capacity;
+	for(std::size_t i = 0; i < r.count; i++) {
+		std::size_t const position = (oldest + i) % r.capacity;
+		if(r.times[position] < from || r.times[position] > to)
+			continue;
+		w.times.push_back(r.times[position]);
+		for(std::size_t index = 0; index < all_series.size(); index++) {
+			w.values[index].push_back(r.values[position * all_series.size() + index]);
+		}
+	}
+}
@@ -0,0 +1,164 @@
+#include "staticAssetCache.h"
+#include "responseBody.h"
+#include "utility.h"
+#include "plog/Log.h"
+#include <openssl/sha.h>
+#include <sys/stat.h>
+#include <cctype>
+#include <cstdio>
+
+namespace {
+
+char const *get_content_type(std::string const &extension) {
+	static std::unordered_map<std::string, char const*> const content_types = {
+		{".html", "text/html; charset=utf-8"},
+		{".js", "application/javascript; charset=utf-8"},
+		{".css", "text/css; charset=utf-8"},
+		{".json", "application/json"},
+		{".map", "application/json"},
+		{".svg", "image/svg+xml"},
+		{".txt", "text/plain; charset=utf-8"},
+		{".png", "image/png"},
+		{".jpg", "image/jpeg"},
+		{".gif", "image/gif"},
+		{".ico", "image/x-icon"},
+		{".woff", "font/woff"},
+		{".woff2", "font/woff2"}};
+	auto content_type = content_types.find(extension);
+	return content_type != content_types.end() ? content_type->second : "application/octet-stream";
+}
+
+// Images and fonts are compressed already
+bool is_compressible(std::string const &content_type) {
+	return content_type.compare(0, 5, "text/") == 0 || content_type.compare(0, 12, "application/") == 0 ||
+		content_type == "image/svg+xml" || content_type == "image/x-icon";
+}
+
+// Bundler output such as index.3042b6ee.js: a hex hash of at least 8 digits between two dots
+bool has_content_hash(std::string const &filename) {
+	std::size_t const last_dot = filename.rfind('.');
+	if(last_dot == std::string::npos || last_dot == 0)
+		return false;
+	std::size_t const hash_dot = filename.rfind('.', last_dot - 1);
+	if(hash_dot == std::string::npos || last_dot - hash_dot - 1 < 8)
+		return false;
+	for(std::size_t i = hash_dot + 1; i < last_dot; i++) {
+		if(!std::isxdigit(static_cast<unsigned char>(filename[i])))
+			return false;
+	}
+	return true;
+}
+
+std::string make_etag(std::string const &body, char const *suffix) {
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	SHA256(reinterpret_cast<unsigned char const*>(body.data()), body.size(), digest);
+	char hex[2 * 16 + 1];
+	// Half of the digest is plenty to tell versions of a file apart
+	for(int i = 0; i < 16; i++) {
+		std::snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+	}
+	return "\"" + std::string(hex) + suffix + "\"";
+}
+
+bool get_file_version(fs::path const &path, StaticAssetCache::file_version &version) {
+	struct stat file_stat;
+	if(::stat(path.c_str(), &file_stat) != 0)
+		return false;
+	version.size = file_stat.st_size;
+	version.inode = file_stat.st_ino;
+	version.modified_ns = std::int64_t(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec;
+	return true;
+}
+
+std::shared_ptr<StaticAssetCache::asset const> load_asset(fs::path const &path, StaticAssetCache::file_version const &version) {
+	std::vector<char> buffer;
+	if(version.size > 0 && !file_to_buffer(buffer, path.string()))
+		return NULL;
+
+	std::shared_ptr<StaticAssetCache::asset> loaded = std::make_shared<StaticAssetCache::asset>();
+	loaded->body.assign(buffer.begin(), buffer.end());
+	loaded->content_type = get_content_type(path.extension().string());
+	loaded->immutable = has_content_hash(path.filename().string());
+	loaded->version = version;
+	loaded->etag = make_etag(loaded->body, "");
+	if(is_compressible(loaded->content_type)) {
+		response_body const compressed = compress_body(content_coding::gzip, 9, loaded->body.data(), loaded->body.size());
+		if(compressed.data && compressed.size < loaded->body.size()) {
+			loaded->gzip_body.assign(compressed.data, compressed.size);
+			loaded->gzip_etag = make_etag(loaded->body, "-gzip");
+		}
+	}
+	return loaded;
+}
+
+}
+
+bool StaticAssetCache::file_version::operator==(file_version const &other) const {
+	return size == other.size && inode == other.inode && modified_ns == other.modified_ns;
+}
+
+StaticAssetCache::StaticAssetCache(fs::path const root, std::chrono::steady_clock::duration const check_interval) : root(root),
+	check_interval(check_interval), table(std::make_shared<asset_table>()), next_check(std::chrono::steady_clock::time_point::min()) {
+}
+
+std::shared_ptr<StaticAssetCache::asset const> StaticAssetCache::find(std::string const &path) {
+	reload_if_changed();
+	std::shared_ptr<asset_table const> const assets = std::atomic_load(&table);
+
+	std::string key = path.substr(0, path.find_first_of("?#"));
+	key.erase(0, key.find_first_not_of('/'));
+	if(key.empty() || key.back() == '/')
+		key += "index.html";
+	auto found = assets->find(key);
+	if(found == assets->end())
+		found = assets->find(key + "/index.html");
+	return found != assets->end() ? found->second : NULL;
+}
+
+// Only one thread rescans. The others keep serving the current table meanwhile.
+void StaticAssetCache::reload_if_changed() {
+	std::unique_lock<std::mutex> lock(reload_mutex, std::try_to_lock);
+	if(!lock.owns_lock() || std::chrono::steady_clock::now() < next_check)
+		return;
+	next_check = std::chrono::steady_clock::now() + check_interval;
+	lock.unlock();
+	reload();
+}
+
+bool StaticAssetCache::reload() {
+	std::lock_guard<std::mutex> lock(reload_mutex);
+	std::shared_ptr<asset_table const> const current = std::atomic_load(&table);
+	std::shared_ptr<asset_table> next = std::make_shared<asset_table>();
+	bool changed = false;
+	try {
+		for(fs::recursive_directory_iterator it(root), end; it != end; it++) {
+			if(!fs::is_regular_file(it->status()))
+				continue;
+			std::string const key = fs::relative(it->path(), root).generic_string();
+			file_version version;
+			if(!get_file_version(it->path(), version))
+				continue;
+
+			auto known = current->find(key);
+			if(known != current->end() && known->second->version == version) {
+				next->emplace(key, known->second);
+				continue;
+			}
+			std::shared_ptr<asset const> const loaded = load_asset(it->path(), version);
+			if(loaded) {
+				next->emplace(key, loaded);
+				changed = true;
+			}
+		}
+	}
+	catch(fs::filesystem_error const &e) {
+		LOG_ERROR << "Could not load web UI files from " << root.string() << ": " << e.what();
+		return false;
+	}
+
+	if(changed || next->size() != current->size()) {
+		std::atomic_store(&table, std::shared_ptr<asset_table const>(next));
+		LOG_INFO << "Loaded " << next->size() << " web UI files from " << root.string();
+	}
+	return true;
+}
@@ -1,7 +1,9 @@
 #include "torrent.h"
+#include "torrentStatusFields.h"
 #include <libtorrent/torrent_info.hpp>
 #include <libtorrent/peer_info.hpp>
 #include "plog/Log.h"
+#include <sstream>
 
 void Torrent::set_handle(lt::torrent_handle handle) {
 	this->handle = handle;
@@ -11,68 +13,47 @@ lt::torrent_handle &Torrent::get_handle() {
 	return handle;
 }
 
-Torrent::Torrent(unsigned long int const id) : id(id) {
+Torrent::Torrent(unsigned long int const id, lt::sha1_hash const info_hash) : id(id), info_hash(info_hash),
+	download_limit(-1), upload_limit(-1) {
 }
 
 unsigned long int const Torrent::get_id() {
 	return id;
 }
 
-std::vector<Torrent::torrent_file> Torrent::get_torrent_files(bool const piece_granularity) {
-	std::vector<Torrent::torrent_file> torrent_files;
-	
-	
+lt::sha1_hash const &Torrent::get_info_hash() {
+	return info_hash;
+}
+
+Torrent::file_listing Torrent::get_file_listing(bool const piece_granularity, bool const query_progress, bool const query_priority) {
+	file_listing listing;
 	//  If the torrent doesn't have metadata, the pointer will not be initialized (i.e. a NULL pointer).
-	boost::shared_ptr<const lt::torrent_info> ti = handle.torrent_file();
-	if(ti) {
-		std::vector<boost::int64_t> progress;
-		if(piece_granularity)
-			handle.file_progress(progress, lt::torrent_handle::piece_granularity);	
+	listing.info = handle.torrent_file();
+	if(listing.info) {
+		if(!query_progress)
+			listing.progress.assign(listing.info->num_files(), 0);
+		else if(piece_granularity)
+			handle.file_progress(listing.progress, lt::torrent_handle::piece_granularity);
 		else
-			handle.file_progress(progress);
-		std::vector<int> priorities = handle.file_priorities();
-
-		for(int i = 0; i < ti->num_files(); i++) {
-			Torrent::torrent_file tf;
-			tf.index = i; 
-			tf.progress = progress.at(i);	
-			tf.priority = priorities.at(i);
-			tf.name = ti->files().file_name(i);
-			tf.size = ti->files().file_size(i);
-			tf.path = ti->files().file_path(i);
-			torrent_files.push_back(tf);
-		}
+			handle.file_progress(listing.progress);
+		if(query_priority)
+			listing.priorities = handle.file_priorities();
+		else
+			listing.priorities.assign(listing.info->num_files(), 0);
 	}
-
-	return torrent_files;
+	return listing;
 }
 
-// TODO - the struct Torrent::torrent_peer is useless. Substitute it for libtorrent::torrent_peer. Use it instead. 
-std::vector<Torrent::torrent_peer> Torrent::get_torrent_peers() {
-	std::vector<Torrent::torrent_peer> torrent_peers;
-	
-	std::vector<lt::peer_info> peer_infos;
+bool Torrent::get_peer_info(std::vector<lt::peer_info> &peers) {
 	try {
-		handle.get_peer_info(peer_infos); // TODO - treat exceptions in ALL references to handle in other parts of the code. Read about invalid_handle exception here: https://www.libtorrent.org/reference-Core.html#torrent_handle 
+		handle.get_peer_info(peers); // TODO - treat exceptions in ALL references to handle in other parts of the code. Read about invalid_handle exception here: https://www.libtorrent.org/reference-Core.html#torrent_handle 
 	}
 	catch(const lt::libtorrent_exception &e) {
 		LOG_ERROR << "Could not get torrent peers info";
-		return std::vector<Torrent::torrent_peer>();
+		peers.clear();
+		return false;
 	}
-
-	for(lt::peer_info p : peer_infos) {
-		Torrent::torrent_peer peer;
-		peer.ip = p.ip;
-		peer.client = p.client;
-		peer.down_speed = p.down_speed;
-		peer.up_speed = p.up_speed;
-		peer.down_total = p.total_download;
-		peer.up_total = p.total_upload;
-		peer.progress = p.progress;
-		torrent_peers.push_back(peer);	
-	}
-
-	return torrent_peers;
+	return true;
 }
 
 std::vector<lt::announce_entry> Torrent::get_torrent_trackers() {
@@ -93,10 +74,100 @@ Torrent::~Torrent() {
 }
 
 lt::torrent_status Torrent::get_torrent_status() {
-	
-	lt::torrent_status status = handle.status();
+	return get_status_snapshot()->status;
+}
+
+/* The cache is seeded by the alert loop when the torrent is added (see seed_status()) and fed from state_update_alert after
+ that, so readers never wait for libtorrent. A torrent that was never seeded gets an empty status that is not cached and has no
+ sequence, so it is always reported as changed. */
+std::shared_ptr<Torrent::status_snapshot const> Torrent::get_status_snapshot() {
+	std::shared_ptr<status_snapshot const> snapshot = std::atomic_load(&cached_status);
+	if(!snapshot) {
+		std::shared_ptr<status_snapshot> empty = std::make_shared<status_snapshot>();
+		empty->status.handle = handle;
+		empty->status.info_hash = info_hash;
+		empty->download_limit = download_limit;
+		empty->upload_limit = upload_limit;
+		std::stringstream ss_info_hash;
+		ss_info_hash << info_hash;
+		empty->info_hash = ss_info_hash.str();
+		empty->sequence = 0;
+		snapshot = empty;
+	}
+	return snapshot;
+}
+
+/* Publishes a first snapshot from what the torrent was added with, without asking libtorrent. It reads as checking its resume
+ data until the next state update, which replaces it within a second. */
+void Torrent::seed_status(lt::add_torrent_params const &params, std::uint64_t const sequence) {
+	lt::torrent_status status;
+	status.handle = handle;
+	status.info_hash = info_hash;
+	status.name = params.ti ? params.ti->name() : params.name;
+	status.save_path = params.save_path;
+	status.has_metadata = static_cast<bool>(params.ti);
+	status.state = lt::torrent_status::checking_resume_data;
+	publish_status(status, sequence);
+}
+
+// Only reads the cache, so it is false until the first state update is cached
+bool Torrent::is_paused() {
+	std::shared_ptr<status_snapshot const> snapshot = std::atomic_load(&cached_status);
+	return snapshot && snapshot->status.paused;
+}
+
+/* Only the alert loop calls update_status() and update_limits(), so there is a single writer and the snapshot being replaced
+ is always the last one published. Both return false and keep the current snapshot if nothing changed. */
+bool Torrent::update_status(lt::torrent_status const &status, std::uint64_t const sequence) {
+	return publish_status(status, sequence);
+}
+
+// Applies limits changed through set_torrent_settings(). libtorrent does not always post a state update for them.
+bool Torrent::update_limits(std::uint64_t const sequence) {
+	std::shared_ptr<status_snapshot const> current = std::atomic_load(&cached_status);
+	if(!current)
+		return false;
+	return publish_status(current->status, sequence);
+}
+
+// Used to seed the limits from the add_torrent_params, so they never have to be asked to libtorrent
+void Torrent::set_limits(int const download_limit, int const upload_limit) {
+	this->download_limit = download_limit;
+	this->upload_limit = upload_limit;
+}
+
+bool Torrent::publish_status(lt::torrent_status const &status, std::uint64_t const sequence) {
+	std::shared_ptr<status_snapshot const> current = std::atomic_load(&cached_status);
+	std::shared_ptr<status_snapshot> next = std::make_shared<status_snapshot>();
+	next->status = status;
+	next->download_limit = download_limit;
+	next->upload_limit = upload_limit;
+	if(current) {
+		next->info_hash = current->info_hash;
+	}
+	else {
+		std::stringstream ss_info_hash;
+		ss_info_hash << info_hash;
+		next->info_hash = ss_info_hash.str();
+	}
+
+	std::vector<status_field> const &fields = get_torrent_status_fields();
+	next->field_sequences.resize(fields.size(), sequence);
+	bool changed = !current;
+	if(current) {
+		for(std::size_t index = 0; index < fields.size(); index++) {
+			if(fields[index].get(*next) == fields[index].get(*current))
+				next->field_sequences[index] = current->field_sequences[index];
+			else
+				changed = true;
+		}
+	}
+	if(!changed)
+		return false;
 
-	return status;
+	next->sequence = sequence;
+	std::atomic_store(&cached_status, std::shared_ptr<status_snapshot const>(next));
+	return true;
 }
 
 boost::shared_ptr<const lt::torrent_info> Torrent::get_torrent_info() {
@@ -108,10 +179,11 @@ boost::shared_ptr<const lt::torrent_info> Torrent::get_torrent_info() {
 
 Torrent::torrent_settings Torrent::get_torrent_settings() {
 
+	std::shared_ptr<status_snapshot const> snapshot = get_status_snapshot();
 	Torrent::torrent_settings ts;
-	ts.download_limit = handle.download_limit();
-	ts.upload_limit = handle.upload_limit();
-	ts.sequential_download = handle.status().sequential_download;
+	ts.download_limit = snapshot->download_limit;
+	ts.upload_limit = snapshot->upload_limit;
+	ts.sequential_download = snapshot->status.sequential_download;
 
 	return ts;
 }
@@ -119,10 +191,12 @@ Torrent::torrent_settings Torrent::get_torrent_settings() {
 void Torrent::set_torrent_settings(torrent_settings const ts) {
 	if(ts.upload_limit) {
 		handle.set_upload_limit(ts.upload_limit.get());
+		upload_limit = ts.upload_limit.get();
 	}
 	
 	if(ts.download_limit) {
 		handle.set_download_limit(ts.download_limit.get());
+		download_limit = ts.download_limit.get();
 	}
 
 	if(ts.sequential_download) {
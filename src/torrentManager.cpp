@@ -6,23 +6,74 @@
 #include <fstream>
 #include <sstream>
 #include <typeinfo>
+#include <algorithm>
+#include <thread>
 #include <libtorrent/extensions/ut_metadata.hpp>
 #include <libtorrent/extensions/ut_pex.hpp>
 #include <libtorrent/extensions/smart_ban.hpp>
 #include <libtorrent/session_stats.hpp>
+#include <libtorrent/performance_counters.hpp>
+#include <libtorrent/error_code.hpp>
 
-TorrentManager::TorrentManager(ConfigManager &config) : config(config) {
+std::chrono::steady_clock::duration const TorrentManager::registry_batch_delay = std::chrono::milliseconds(500);
+std::chrono::steady_clock::duration const TorrentManager::listener_linger = std::chrono::seconds(10);
+
+TorrentManager::TorrentManager(ConfigManager &config) : config(config), status_sequence(0), pending_adds(0),
+	pending_status_change(false), adds_in_flight(0), loading_stopped(false), updates_parked(false), last_listener(0) {
 	greatest_id = 1;
 	outstanding_resume_data = 0;
+	removed_torrents_floor = 0;
+
+	status_indexes.has_incoming_connections = session_counters.find_index("net.has_incoming_connections");
+	status_indexes.sent_bytes = session_counters.find_index("net.sent_bytes");
+	status_indexes.recv_bytes = session_counters.find_index("net.recv_bytes");
+	status_indexes.sent_ip_overhead_bytes = session_counters.find_index("net.sent_ip_overhead_bytes");
+	status_indexes.recv_ip_overhead_bytes = session_counters.find_index("net.recv_ip_overhead_bytes");
+	status_indexes.dht_bytes_out = session_counters.find_index("dht.dht_bytes_out");
+	status_indexes.dht_bytes_in = session_counters.find_index("dht.dht_bytes_in");
+	status_indexes.dht_nodes = session_counters.find_index("dht.dht_nodes");
+	status_indexes.sent_tracker_bytes = session_counters.find_index("net.sent_tracker_bytes");
+	status_indexes.recv_tracker_bytes = session_counters.find_index("net.recv_tracker_bytes");
+	status_indexes.sent_payload_bytes = session_counters.find_index("net.sent_payload_bytes");
+	status_indexes.recv_payload_bytes = session_counters.find_index("net.recv_payload_bytes");
+	status_indexes.num_peers_connected = session_counters.find_index("peer.num_peers_connected");
+	status_indexes.num_peers_half_open = session_counters.find_index("peer.num_peers_half_open");
+	apply_alert_queue_size();
 }
 
 TorrentManager::~TorrentManager() {
+	stop_loading_fastresume();
 	// This can be made async if necessary
 	session.~session(); 
 }
 
-void TorrentManager::add_torrent_async(const lt::add_torrent_params &atp) {
+void TorrentManager::async_add(lt::add_torrent_params const &atp) {
+	adds_in_flight++;
 	session.async_add_torrent(atp);
+	wake_timers();
+}
+
+/* Gives up after loading was stopped, since nobody may be handling alerts anymore, and after a while without any
+ add_torrent_alert, so a lost alert slows the load down instead of stalling it */
+void TorrentManager::wait_for_add_slot() {
+	std::unique_lock<std::mutex> lock(adds_in_flight_mutex);
+	if(!add_done.wait_for(lock, std::chrono::seconds(10),
+				[this]() { return loading_stopped || adds_in_flight < max_adds_in_flight; })) {
+		LOG_WARNING << "No add_torrent_alert for 10 seconds with " << adds_in_flight << " adds in flight";
+	}
+}
+
+// An alert queue smaller than max_adds_in_flight would drop add_torrent_alerts during a bulk load
+void TorrentManager::apply_alert_queue_size() {
+	if(session.get_settings().get_int(lt::settings_pack::alert_queue_size) >= min_alert_queue_size)
+		return;
+	lt::settings_pack pack;
+	pack.set_int(lt::settings_pack::alert_queue_size, min_alert_queue_size);
+	session.apply_settings(pack);
+}
+
+void TorrentManager::add_torrent_async(const lt::add_torrent_params &atp) {
+	async_add(atp);
 	
 	// TODO - this is logging incorrectly!!
 	LOG_INFO << "Torrent with filename " << atp.save_path << " marked for asynchronous addition";
@@ -30,19 +81,21 @@ void TorrentManager::add_torrent_async(const lt::add_torrent_params &atp) {
 
 /* Debug only */
 void TorrentManager::update_torrent_console_view() {
-	for(std::shared_ptr<Torrent> torrent : torrents) {
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	for(std::shared_ptr<Torrent> torrent : *snapshot) {
+		lt::torrent_status const &status = torrent->get_status_snapshot()->status;
 		std::cout << "id: " << torrent->get_id() << " / ";
-		std::cout << "name: " << torrent->get_handle().status().name << " / ";
-		//std::cout << "hash: " << torrent->get_handle().status().info_hash << " / ";
-		std::cout << "down: " << torrent->get_handle().status().download_rate / 1000 << "Kb/s" << " / ";
-		std::cout << "up: " << torrent->get_handle().status().upload_rate / 1000 << "Kb/s" << " / ";
-		std::cout << "p: " << torrent->get_handle().status().progress * 100.0 << "%" << " / ";
-		std::cout << "t_down: " << torrent->get_handle().status().total_download / 1000 << "Kb" << " / ";
-		std::cout << "t_up: " << torrent->get_handle().status().total_upload / 1000 << "Kb" << " / ";
-		std::cout << "seeds: " << torrent->get_handle().status().num_seeds<< " / ";
-		std::cout << "peers: " << torrent->get_handle().status().num_peers << " / ";
-		std::cout << "paused: " << torrent->get_handle().status().paused << " / ";
-		std::cout << "queue_pos: " << torrent->get_handle().status().queue_position << " / ";
+		std::cout << "name: " << status.name << " / ";
+		//std::cout << "hash: " << status.info_hash << " / ";
+		std::cout << "down: " << status.download_rate / 1000 << "Kb/s" << " / ";
+		std::cout << "up: " << status.upload_rate / 1000 << "Kb/s" << " / ";
+		std::cout << "p: " << status.progress * 100.0 << "%" << " / ";
+		std::cout << "t_down: " << status.total_download / 1000 << "Kb" << " / ";
+		std::cout << "t_up: " << status.total_upload / 1000 << "Kb" << " / ";
+		std::cout << "seeds: " << status.num_seeds<< " / ";
+		std::cout << "peers: " << status.num_peers << " / ";
+		std::cout << "paused: " << status.paused << " / ";
+		std::cout << "queue_pos: " << status.queue_position << " / ";
 		std::cout << std::endl;
 	}
 	std::cout << std::endl << std::endl;
@@ -57,8 +110,36 @@ void TorrentManager::check_alerts(lt::alert *a) {
 		alerts.push_back(a);		
 	}
 
+	/* Changes to the torrent set are made on a private copy of the registry, which is published once the whole batch is handled.
+	 A copy that only got new torrents may be kept for the next batches while more adds are on their way. */
+	std::shared_ptr<TorrentRegistry> &next_torrents = pending_torrents;
+	bool only_added = true;
+	/* Every change in this batch gets the same sequence, which becomes visible to readers after the batch is published. It
+	 stays the same for the following batches while the registry copy is held back. */
+	std::uint64_t const sequence = status_sequence + 1;
+	bool status_changed = false;
+
+	std::vector<std::shared_ptr<Torrent>> changed;
+	{
+		std::lock_guard<std::mutex> lock(limits_changed_mutex);
+		changed.swap(limits_changed);
+	}
+	for(std::shared_ptr<Torrent> const &torrent : changed) {
+		if(torrent->update_limits(sequence))
+			status_changed = true;
+	}
+
 	// TODO - There are a lot more alert messages that need to be here	
+	long alert_latency_last = 0;
+	long alert_latency_max = 0;
+	long alert_latency_total = 0;
 	for (lt::alert const *a : alerts) {
+		long const latency = std::chrono::duration_cast<std::chrono::microseconds>(lt::clock_type::now() - a->timestamp()).count();
+		alert_latency_last = latency;
+		alert_latency_total += latency;
+		if(latency > alert_latency_max)
+			alert_latency_max = latency;
+
 		switch(a->type()) {
 			case lt::torrent_finished_alert::alert_type:
 			{
@@ -73,19 +154,77 @@ void TorrentManager::check_alerts(lt::alert *a) {
 			case lt::add_torrent_alert::alert_type: 
 			{
 				lt::add_torrent_alert const* a_temp = lt::alert_cast<lt::add_torrent_alert>(a);
+				{
+					std::lock_guard<std::mutex> lock(adds_in_flight_mutex);
+					if(adds_in_flight > 0)
+						adds_in_flight--;
+				}
+				add_done.notify_all();
 				if(a_temp->error) {
 					LOG_ERROR << "add_torrent_alert: " << a_temp->error.message();
 					break;
 				}	
-				std::shared_ptr<Torrent> torrent = std::make_shared<Torrent>(generate_torrent_id());
+				std::shared_ptr<Torrent> torrent = std::make_shared<Torrent>(generate_torrent_id(), a_temp->handle.info_hash());
 				torrent->set_handle(a_temp->handle);
-				torrents.push_back(torrent);
+				torrent->set_limits(a_temp->params.download_limit, a_temp->params.upload_limit);
+				torrent->seed_status(a_temp->params, sequence);
+				if(!next_torrents) {
+					next_torrents = torrents.copy();
+					pending_since = std::chrono::steady_clock::now();
+				}
+				if(!next_torrents->insert(torrent)) {
+					LOG_ERROR << "add_torrent_alert: torrent " << torrent->get_info_hash() << " is already registered";
+					break;
+				}
+				pending_adds++;
+				status_changed = true;
 				LOG_INFO << "add_torrent_alert: " << a_temp->message();
 				break;
 			}
 			case lt::torrent_removed_alert::alert_type:
 			{
 				lt::torrent_removed_alert const * a_temp = lt::alert_cast<lt::torrent_removed_alert>(a);
+				only_added = false;
+				if(!next_torrents)
+					next_torrents = torrents.copy();
+				std::shared_ptr<Torrent> torrent = next_torrents->find(a_temp->info_hash);
+				// Queued after any save of the same torrent, so the store never brings the row back
+				std::stringstream ss_hash;
+				ss_hash << a_temp->info_hash;
+				resume_data_store.remove(ss_hash.str());
+				if(torrent) {
+					next_torrents->erase(a_temp->info_hash);
+					piece_waiter.torrent_removed(torrent->get_id());
+					std::lock_guard<std::mutex> lock(removed_torrents_mutex);
+					removed_torrents.emplace_back(sequence, torrent->get_id());
+					if(removed_torrents.size() > max_removed_torrents) {
+						removed_torrents_floor = removed_torrents.front().first;
+						removed_torrents.pop_front();
+					}
+					status_changed = true;
+				}
+				LOG_INFO << "torrent_removed_alert: " << a_temp->message();
+				break;
+			}
+			case lt::save_resume_data_alert::alert_type:
+			{
+				lt::save_resume_data_alert const * a_temp = lt::alert_cast<lt::save_resume_data_alert>(a);
+				if(outstanding_resume_data > 0)
+					outstanding_resume_data--;
+				std::stringstream ss_hash;
+				ss_hash << a_temp->handle.info_hash();
+				resume_data_store.save(ss_hash.str(), a_temp->resume_data);
+				break;
+			}
+			case lt::save_resume_data_failed_alert::alert_type:
+			{
+				lt::save_resume_data_failed_alert const * a_temp = lt::alert_cast<lt::save_resume_data_failed_alert>(a);
+				if(outstanding_resume_data > 0)
+					outstanding_resume_data--;
+				// Asking with only_if_modified fails this way for every torrent that did not change
+				if(a_temp->error == lt::errors::resume_data_not_modified)
+					break;
+				LOG_ERROR << "Save fastresume data failed: " << a_temp->message();
 				break;
 			}
 			case lt::torrent_deleted_alert::alert_type:
@@ -98,340 +237,326 @@ void TorrentManager::check_alerts(lt::alert *a) {
 		  		lt::torrent_paused_alert const * a_temp = lt::alert_cast<lt::torrent_paused_alert>(a);
 				break;
 			}
-			case lt::session_stats_alert::alert_type:
+			case lt::state_update_alert::alert_type:
 			{
-		  		lt::session_stats_alert const * a_temp = lt::alert_cast<lt::session_stats_alert>(a);
-				SessionStatus last_session_status = session_status;
-
-				auto interval = std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now() - interval_last_point).count();
-
-				int const index_has_incoming_connections = lt::find_metric_idx("net.has_incoming_connections");
-				if(index_has_incoming_connections != -1) {
-					session_status.has_incoming_connections = a_temp->values[index_has_incoming_connections];
-				}
-
-				int const index_sent_bytes = lt::find_metric_idx("net.sent_bytes");
-				if(index_sent_bytes != -1) {
-					session_status.total_upload = a_temp->values[index_sent_bytes];
-					session_status.upload_rate = (session_status.total_upload - last_session_status.total_upload)/(interval);				
-				}
-
-				int const index_recv_bytes = lt::find_metric_idx("net.recv_bytes");
-				if(index_recv_bytes != -1) {
-					session_status.total_download = a_temp->values[index_recv_bytes];
-					session_status.download_rate = (session_status.total_download - last_session_status.total_download)/(interval);				
-				}
-
-				int const index_sent_ip_overhead_bytes = lt::find_metric_idx("net.sent_ip_overhead_bytes");
-				if(index_sent_ip_overhead_bytes!= -1) {
-					session_status.ip_overhead_upload = a_temp->values[index_sent_ip_overhead_bytes];
-					session_status.ip_overhead_upload_rate = (session_status.ip_overhead_upload - last_session_status.ip_overhead_upload)/(interval);				
-				}
-
-				int const index_recv_ip_overhead_bytes = lt::find_metric_idx("net.recv_ip_overhead_bytes");
-				if(index_recv_ip_overhead_bytes!= -1) {
-					session_status.ip_overhead_download = a_temp->values[index_recv_ip_overhead_bytes];
-					session_status.ip_overhead_download_rate = (session_status.ip_overhead_download - last_session_status.ip_overhead_download)/(interval);				
-				}
-
-				int const index_dht_bytes_out = lt::find_metric_idx("dht.dht_bytes_out");
-				if(index_dht_bytes_out!= -1) {
-					session_status.dht_upload = a_temp->values[index_dht_bytes_out];
-					session_status.dht_upload_rate = (session_status.dht_upload - last_session_status.dht_upload)/(interval);				
-				}
-
-				int const index_dht_bytes_in = lt::find_metric_idx("dht.dht_bytes_in");
-				if(index_dht_bytes_in!= -1) {
-					session_status.dht_download = a_temp->values[index_dht_bytes_in];
-					session_status.dht_download_rate = (session_status.dht_download - last_session_status.dht_download)/(interval);				
-				}
-
-				int const index_dht_nodes = lt::find_metric_idx("dht.dht_nodes");
-				if(index_dht_nodes!= -1) {
-					session_status.dht_nodes = a_temp->values[index_dht_nodes];
-				}
-
-				int const index_tracker_upload = lt::find_metric_idx("net.sent_tracker_bytes");
-				if(index_tracker_upload!= -1) {
-					session_status.tracker_upload = a_temp->values[index_tracker_upload];
-					session_status.tracker_upload_rate = (session_status.tracker_upload - last_session_status.tracker_upload)/(interval);				
+				// Only torrents whose status changed since the last post_torrent_updates() are in the alert
+				lt::state_update_alert const * a_temp = lt::alert_cast<lt::state_update_alert>(a);
+				std::shared_ptr<TorrentRegistry const> registry = next_torrents ? next_torrents : torrents.snapshot();
+				for(lt::torrent_status const &status : a_temp->status) {
+					std::shared_ptr<Torrent> torrent = registry->find(status.info_hash);
+					if(torrent && torrent->update_status(status, sequence))
+						status_changed = true;
 				}
-
-				int const index_tracker_download = lt::find_metric_idx("net.recv_tracker_bytes");
-				if(index_tracker_download!= -1) {
-					session_status.tracker_download = a_temp->values[index_tracker_download];
-					session_status.tracker_download_rate = (session_status.tracker_download - last_session_status.tracker_download)/(interval);				
-				}
-
-				int const index_sent_payload_bytes = lt::find_metric_idx("net.sent_payload_bytes");
-				if(index_sent_payload_bytes != -1) {
-					session_status.total_payload_upload = a_temp->values[index_sent_payload_bytes];
-					session_status.payload_upload_rate = (session_status.total_payload_upload - last_session_status.total_payload_upload)/(interval);				
-				}
-
-				int const index_recv_payload_bytes = lt::find_metric_idx("net.recv_payload_bytes");
-				if(index_recv_payload_bytes != -1) {
-					session_status.total_payload_download = a_temp->values[index_recv_payload_bytes];
-					session_status.payload_download_rate = (session_status.total_payload_download - last_session_status.total_payload_download)/(interval);				
-				}
-
-				int const index_num_peers_connected = lt::find_metric_idx("peer.num_peers_connected");
-				int const index_num_peers_half_open = lt::find_metric_idx("peer.num_peers_half_open");
-				if(index_num_peers_connected != -1 && index_num_peers_half_open != -1) {
-					session_status.total_peers_connections = a_temp->values[index_num_peers_connected] + a_temp->values[index_num_peers_half_open];
+				break;
+			}
+			case lt::read_piece_alert::alert_type:
+			{
+				// Pieces are only read for streams, which wait for them in piece_waiter
+				lt::read_piece_alert const * a_temp = lt::alert_cast<lt::read_piece_alert>(a);
+				std::shared_ptr<TorrentRegistry const> registry = next_torrents ? next_torrents : torrents.snapshot();
+				std::shared_ptr<Torrent> torrent = registry->find(a_temp->handle.info_hash());
+				if(!torrent)
+					break;
+				if(a_temp->ec) {
+					LOG_DEBUG << "read_piece_alert: " << a_temp->ec.message();
+					piece_waiter.piece_read(torrent->get_id(), a_temp->piece, boost::shared_array<char>(), 0);
 				}
-				
-				interval_last_point = std::chrono::steady_clock::now();
+				else
+					piece_waiter.piece_read(torrent->get_id(), a_temp->piece, a_temp->buffer, a_temp->size);
+				break;
+			}
+			case lt::session_stats_alert::alert_type:
+			{
+		  		lt::session_stats_alert const * a_temp = lt::alert_cast<lt::session_stats_alert>(a);
+				std::shared_ptr<SessionCounters::sample const> sample = session_counters.update(a_temp->values,
+						lt::counters::num_counters, std::chrono::steady_clock::now());
+				update_session_status(*sample);
 				break;
 			}
 		}
 	}	
+
+	if(status_changed)
+		pending_status_change = true;
+	bool const hold = next_torrents && only_added && adds_in_flight > 0 && pending_adds < registry_batch_size &&
+		std::chrono::steady_clock::now() - pending_since < registry_batch_delay;
+	if(!hold) {
+		if(next_torrents) {
+			torrents.publish(next_torrents);
+			next_torrents.reset();
+			pending_adds = 0;
+		}
+		if(pending_status_change)
+			status_sequence = sequence;
+		pending_status_change = false;
+	}
+
+	if(!alerts.empty()) {
+		std::lock_guard<std::mutex> lock(session_status_mutex);
+		session_status.alerts_handled += alerts.size();
+		session_status.alert_latency_last = alert_latency_last;
+		session_status.alert_latency_total += alert_latency_total;
+		if(alert_latency_max > session_status.alert_latency_max)
+			session_status.alert_latency_max = alert_latency_max;
+	}
+}
+
+// Rates in SessionStatus are in bytes per millisecond
+void TorrentManager::update_session_status(SessionCounters::sample const &sample) {
+	auto value = [&sample](int const index) -> long {
+		return index != -1 ? sample.values[index] : 0;
+	};
+	auto rate = [&sample](int const index) -> long {
+		return index != -1 ? sample.rates[index] / 1000 : 0;
+	};
+
+	std::lock_guard<std::mutex> lock(session_status_mutex);
+	session_status.has_incoming_connections = value(status_indexes.has_incoming_connections);
+	session_status.total_upload = value(status_indexes.sent_bytes);
+	session_status.upload_rate = rate(status_indexes.sent_bytes);
+	session_status.total_download = value(status_indexes.recv_bytes);
+	session_status.download_rate = rate(status_indexes.recv_bytes);
+	session_status.ip_overhead_upload = value(status_indexes.sent_ip_overhead_bytes);
+	session_status.ip_overhead_upload_rate = rate(status_indexes.sent_ip_overhead_bytes);
+	session_status.ip_overhead_download = value(status_indexes.recv_ip_overhead_bytes);
+	session_status.ip_overhead_download_rate = rate(status_indexes.recv_ip_overhead_bytes);
+	session_status.dht_upload = value(status_indexes.dht_bytes_out);
+	session_status.dht_upload_rate = rate(status_indexes.dht_bytes_out);
+	session_status.dht_download = value(status_indexes.dht_bytes_in);
+	session_status.dht_download_rate = rate(status_indexes.dht_bytes_in);
+	session_status.dht_nodes = value(status_indexes.dht_nodes);
+	session_status.tracker_upload = value(status_indexes.sent_tracker_bytes);
+	session_status.tracker_upload_rate = rate(status_indexes.sent_tracker_bytes);
+	session_status.tracker_download = value(status_indexes.recv_tracker_bytes);
+	session_status.tracker_download_rate = rate(status_indexes.recv_tracker_bytes);
+	session_status.total_payload_upload = value(status_indexes.sent_payload_bytes);
+	session_status.payload_upload_rate = rate(status_indexes.sent_payload_bytes);
+	session_status.total_payload_download = value(status_indexes.recv_payload_bytes);
+	session_status.payload_download_rate = rate(status_indexes.recv_payload_bytes);
+	session_status.num_peers_connected = value(status_indexes.num_peers_connected);
+	session_status.num_peers_half_open = value(status_indexes.num_peers_half_open);
+	session_status.total_peers_connections = session_status.num_peers_connected + session_status.num_peers_half_open;
+	session_history.add(std::time(NULL), session_status);
 }
 
 // TODO - function name in incorrect format
 // TODO - why there are 2 functions like this ? one called get_torrents_status and one called get_status_torrents
-unsigned long int TorrentManager::get_torrents_status(std::vector<lt::torrent_status> &torrents_status, std::vector<unsigned long int> ids) {
+// Reads the status cache only. It never waits on libtorrent's network thread.
+unsigned long int TorrentManager::get_torrents_status(std::vector<std::shared_ptr<Torrent::status_snapshot const>> &torrents_status, std::vector<unsigned long int> ids) {
+	note_listener();
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
 
 	// No ids specified. Get all torrents status
 	if(ids.size() == 0) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			torrents_status.push_back((*it)->get_handle().status()); // TODO - create get torrent status function
+		torrents_status.reserve(snapshot->size());
+		for(std::shared_ptr<Torrent> const &torrent : *snapshot) {
+			torrents_status.push_back(torrent->get_status_snapshot());
 		}
 		return 0;
 	}
 
-	// TODO - This in O(n) and not necessary. Embbed this in the for loop below that adds the items to the vector. When not found, return the id.
-	// Check if it exists on the fly 
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
-	}
+	std::vector<std::shared_ptr<Torrent>> found;
+	unsigned long int missing_id = snapshot->find_all(found, ids);
+	if(missing_id != 0)
+		return missing_id;
 
 	// Get torrent status in ids
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				torrents_status.push_back((*it)->get_handle().status());
+	torrents_status.reserve(found.size());
+	for(std::shared_ptr<Torrent> const &torrent : found) {
+		torrents_status.push_back(torrent->get_status_snapshot());
+	}
+
+	return 0;
+}
+
+/* Torrents (and fields) changed after since, plus the ids removed after since when no ids are given. A full listing is returned
+ instead when since is 0, newer than the current sequence (e.g. the program was restarted) or older than the removals still known. */
+unsigned long int TorrentManager::get_torrents_status_delta(status_delta &delta, std::vector<unsigned long int> ids, std::uint64_t const since) {
+	note_listener();
+	// The sequence must be read before the snapshots. Changes published meanwhile are sent again in the next poll, but never lost.
+	delta.sequence = status_sequence;
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+
+	delta.full = (since == 0 || since > delta.sequence);
+	if(ids.size() == 0) {
+		std::lock_guard<std::mutex> lock(removed_torrents_mutex);
+		if(since < removed_torrents_floor)
+			delta.full = true;
+		if(!delta.full) {
+			for(std::pair<std::uint64_t, unsigned long int> const &removed : removed_torrents) {
+				if(removed.first > since && removed.first <= delta.sequence)
+					delta.removed_ids.push_back(removed.second);
 			}
 		}
 	}
 
+	std::vector<std::shared_ptr<Torrent>> found;
+	if(ids.size() == 0) {
+		found.assign(snapshot->begin(), snapshot->end());
+	}
+	else {
+		unsigned long int missing_id = snapshot->find_all(found, ids);
+		if(missing_id != 0)
+			return missing_id;
+	}
+
+	for(std::shared_ptr<Torrent> const &torrent : found) {
+		std::shared_ptr<Torrent::status_snapshot const> torrent_status = torrent->get_status_snapshot();
+		if(delta.full || torrent_status->sequence == 0 || torrent_status->sequence > since) {
+			delta.ids.push_back(torrent->get_id());
+			delta.torrents_status.push_back(torrent_status);
+		}
+	}
 
 	return 0;
 }
 
+std::uint64_t TorrentManager::get_status_sequence() {
+	return status_sequence;
+}
+
 unsigned long int const TorrentManager::generate_torrent_id() {
 	return greatest_id++; 
 }
 
-// An torrent_deleted_alert is posted when the removal occurs 
+// An torrent_removed_alert is posted when the removal occurs and torrent_deleted_alert when its files are deleted
 unsigned long int TorrentManager::remove_torrent(const std::vector<unsigned long int> ids, bool remove_data) {
-	// TODO - this is sooooo inefficient. Use a Map instead of Vector to store torrents and change this code.
-	
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
-	}
-
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	std::vector<std::shared_ptr<Torrent>> found;
+	unsigned long int missing_id = snapshot->find_all(found, ids);
+	if(missing_id != 0)
+		return missing_id;
 
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				lt::torrent_handle handle = (*it)->get_handle();
-				session.remove_torrent(handle, remove_data);
-				(*it).reset();
-				torrents.erase(it);
-				break;	
-			}
-		}
+	// The torrent leaves the registry when its torrent_removed_alert is handled by the alert loop
+	for(std::shared_ptr<Torrent> const &torrent : found) {
+		session.remove_torrent(torrent->get_handle(), remove_data);
 	}
 	return 0;
 }
 
 unsigned long int TorrentManager::recheck_torrents(const std::vector<unsigned long int> ids) {
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
 
 	// No ids specified. Recheck all torrents
 	if(ids.size() == 0) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			lt::torrent_handle handle = (*it)->get_handle();
-			handle.force_recheck();
+		for(std::shared_ptr<Torrent> const &torrent : *snapshot) {
+			torrent->get_handle().force_recheck();
 		}
 		return 0;
 	}
 
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
-	}
+	std::vector<std::shared_ptr<Torrent>> found;
+	unsigned long int missing_id = snapshot->find_all(found, ids);
+	if(missing_id != 0)
+		return missing_id;
 
 	// Recheck torrents in ids
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				lt::torrent_handle handle = (*it)->get_handle();
-				handle.force_recheck();
-			}
-		}
+	for(std::shared_ptr<Torrent> const &torrent : found) {
+		torrent->get_handle().force_recheck();
 	}
 	return 0;
 }
 
 unsigned long int TorrentManager::stop_torrents(const std::vector<unsigned long int> ids, bool force_stop) {
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	std::vector<std::shared_ptr<Torrent>> found;
 
 	// No ids specified. Stop all torrents
 	if(ids.size() == 0) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			lt::torrent_handle handle = (*it)->get_handle();
-			if(force_stop)
-				handle.pause();
-			else
-				handle.pause(lt::torrent_handle::graceful_pause);
-		}
-		return 0;
+		found.assign(snapshot->begin(), snapshot->end());
 	}
-
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
+	else {
+		unsigned long int missing_id = snapshot->find_all(found, ids);
+		if(missing_id != 0)
+			return missing_id;
 	}
 
-	// Stop torrents in ids
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				lt::torrent_handle handle = (*it)->get_handle();
-				if(force_stop)
-					handle.pause();
-				else
-					handle.pause(lt::torrent_handle::graceful_pause);
-			}
-		}
+	for(std::shared_ptr<Torrent> const &torrent : found) {
+		lt::torrent_handle handle = torrent->get_handle();
+		if(force_stop)
+			handle.pause();
+		else
+			handle.pause(lt::torrent_handle::graceful_pause);
 	}
 	return 0;
 }
 
 std::vector<unsigned long int> TorrentManager::get_all_ids() {
-	std::vector<unsigned long int> ids;
-	for(std::shared_ptr<Torrent> t : torrents) {
-		ids.push_back(t->get_id());
-	}
-	return ids;
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	return snapshot->get_all_ids();
 }
 
-unsigned long int TorrentManager::get_files_torrents(std::vector<std::vector<Torrent::torrent_file>> &torrent_files, const std::vector<unsigned long int> ids, bool piece_granularity) {
+unsigned long int TorrentManager::find_torrents(std::vector<std::shared_ptr<Torrent>> &found, const std::vector<unsigned long int> ids) {
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	return snapshot->find_all(found, ids);
+}
 
-	// TODO - put this check in a function and use it in all other API methods to reduce redundancy
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
-	}
+unsigned long int TorrentManager::get_trackers_torrents(std::vector<std::vector<lt::announce_entry>> &torrent_trackers, const std::vector<unsigned long int> ids) {
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	std::vector<std::shared_ptr<Torrent>> found;
+	unsigned long int missing_id = snapshot->find_all(found, ids);
+	if(missing_id != 0)
+		return missing_id;
 
-	// Get files from torrents in ids
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				std::vector<Torrent::torrent_file> tf = (*it)->get_torrent_files(piece_granularity);
-				torrent_files.push_back(tf);
-			}
-		}
+	// Get trackers from torrents in ids
+	torrent_trackers.reserve(found.size());
+	for(std::shared_ptr<Torrent> const &torrent : found) {
+		torrent_trackers.push_back(torrent->get_torrent_trackers());
 	}
 
 	return 0;
 }
 
-unsigned long int TorrentManager::get_trackers_torrents(std::vector<std::vector<lt::announce_entry>> &torrent_trackers, const std::vector<unsigned long int> ids) {
-	// TODO - put this check in a function and use it in all other API methods to reduce redundancy
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
-	}
+// Reminder: It returns the alert but does not pop it from the queue
+lt::alert const* TorrentManager::wait_for_alert(lt::time_duration max_wait) {
+	lt::alert const* a = session.wait_for_alert(max_wait);
+	return a;
+}
 
-	// Get trackers from torrents in ids
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				std::vector<lt::announce_entry> tt = (*it)->get_torrent_trackers();
-				torrent_trackers.push_back(tt);
-			}
-		}
+// notify is called by libtorrent from its own thread. See EventLoop::notify().
+void TorrentManager::set_alert_notify(std::function<void()> const &notify) {
+	session.set_alert_notify(notify);
+}
+
+void TorrentManager::set_timer_wakeup(std::function<void()> const &wakeup) {
+	{
+		std::lock_guard<std::mutex> lock(timer_wakeup_mutex);
+		timer_wakeup = wakeup;
 	}
+	piece_waiter.set_first_waiter_notify(wakeup);
+}
 
-	return 0;
+// Only takes the lock when the timers were parked, which is the rare case
+void TorrentManager::wake_timers() {
+	if(!updates_parked.exchange(false))
+		return;
+	std::lock_guard<std::mutex> lock(timer_wakeup_mutex);
+	if(timer_wakeup)
+		timer_wakeup();
 }
 
-unsigned long int TorrentManager::get_peers_torrents(std::vector<std::vector<Torrent::torrent_peer>> &torrent_peers, const std::vector<unsigned long int> ids) {
-	// TODO - put this check in a function and use it in all other API methods to reduce redundancy
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
-	}
+void TorrentManager::note_listener() {
+	last_listener = std::chrono::steady_clock::now().time_since_epoch().count();
+	wake_timers();
+}
 
-	// Get peers from torrents in ids
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				std::vector<Torrent::torrent_peer> tp = (*it)->get_torrent_peers();
-				torrent_peers.push_back(tp);
-			}
-		}
+/* Whether post_torrent_updates() and post_session_stats() have anything to do. An unpaused torrent can change at any time, and
+ a client that asked for status recently will probably ask again. */
+bool TorrentManager::needs_updates() {
+	std::chrono::steady_clock::time_point const listener{std::chrono::steady_clock::duration(last_listener.load())};
+	if(std::chrono::steady_clock::now() - listener < listener_linger || adds_in_flight > 0)
+		return true;
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	for(std::shared_ptr<Torrent> const &torrent : *snapshot) {
+		if(!torrent->is_paused())
+			return true;
 	}
-
-	return 0;
+	updates_parked = true;
+	return false;
 }
 
-// Reminder: It returns the alert but does not pop it from the queue
-lt::alert const* TorrentManager::wait_for_alert(lt::time_duration max_wait) {
-	lt::alert const* a = session.wait_for_alert(max_wait);
-	return a;
+bool TorrentManager::has_piece_waiters() {
+	return piece_waiter.size() > 0;
 }
 
 bool TorrentManager::load_session_state() {
@@ -459,6 +584,7 @@ bool TorrentManager::load_session_state() {
 	}
 
 	session.load_state(node);
+	apply_alert_queue_size();
 	LOG_DEBUG << "Session state loaded";
 	return true;
 }
@@ -490,127 +616,111 @@ bool TorrentManager::save_session_state() {
 	}
 }
 
-void TorrentManager::save_fastresume(int resume_flags) {
-	fs::path fastresume_path;
-	
-	try {
-		fastresume_path = fs::path(config.get_config<std::string>("directory.fastresume_path"));
-	}
-	catch(const config_key_error &e) {
-		LOG_ERROR << "Fastresume not saved. Could not get config: " << e.what();
-		return;
-	}
-	
-	for(std::shared_ptr<Torrent> torrent : torrents) {
+/* Only asks libtorrent for the resume data. The save_resume_data_alert replies are handled by check_alerts(), which hands them
+ to the ResumeDataStore, so this never waits. only_if_needed uses the cached need_save_resume to skip torrents with nothing new.
+ Pass false when shutting down, because the cache may be up to a second behind. */
+void TorrentManager::save_fastresume(int resume_flags, bool const only_if_needed) {
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	for(std::shared_ptr<Torrent> const &torrent : *snapshot) {
 		lt::torrent_handle h = torrent->get_handle();
 		if(!h.is_valid())
 			continue;
-		lt::torrent_status s = h.status();
+		lt::torrent_status const &s = torrent->get_status_snapshot()->status;
 		if(!s.has_metadata)
 			continue;
-		if(!s.need_save_resume)
+		if(only_if_needed && !s.need_save_resume)
 			continue;
 		h.save_resume_data(resume_flags);
 		outstanding_resume_data++;
 	}
+}
 
+/* Handles alerts until every outstanding save_resume_data_alert arrived or timeout expires, then waits for the store to commit
+ them. Only meant for shutdown, when the event loop is not running anymore. */
+void TorrentManager::wait_for_fastresume(std::chrono::seconds const timeout) {
+	std::chrono::steady_clock::time_point const deadline = std::chrono::steady_clock::now() + timeout;
 	while(outstanding_resume_data > 0) {
-		lt::alert *a = session.wait_for_alert(std::chrono::seconds(10));
-
-		if(a==0) {
+		std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+		if(now >= deadline) {
 			LOG_DEBUG << "Wait for resume data alert timed out";
 			break;
 		}
-
-		std::vector<lt::alert*> alerts;
-		session.pop_alerts(&alerts);
-
-		for(lt::alert *a : alerts) {
-			if(lt::alert_cast<lt::save_resume_data_failed_alert>(a)) {
-				LOG_ERROR << "Save fastresume data failed: " << a->message();
-				outstanding_resume_data--;
-				continue;
-			}
-		
-			lt::save_resume_data_alert const *rd = lt::alert_cast<lt::save_resume_data_alert>(a);
-			if(rd == 0) {
-				check_alerts(a);
-				continue;
-			}
-				
-			outstanding_resume_data--;
-			lt::torrent_handle h = rd->handle;
-			lt::torrent_status ts = h.status(lt::torrent_handle::query_name);
-			std::stringstream ss_name;
-			ss_name << ts.info_hash;
-			fs::path out_file = fastresume_path.string()+ ss_name.str() +".fastresume";
-			std::ofstream out(out_file.c_str(), std::ios_base::binary);
-			out.unsetf(std::ios_base::skipws);
-			if(out.is_open()) {
-				lt::bencode(std::ostream_iterator<char>(out), *rd->resume_data);
-				LOG_DEBUG << "Saved fastresume: " << out_file;
-			}
-			else {
-				LOG_ERROR << "Could not save fastresume: " << out_file;
-			}
-		}
+		session.wait_for_alert(std::chrono::duration_cast<lt::time_duration>(deadline - now));
+		check_alerts();
 	}
+	resume_data_store.flush();
 }
 
+/* Opens the resume data store and starts adding every torrent in it in the background, so the API can be served while a
+ large session is still loading. Fastresume files left in directory.fastresume_path by older versions are moved into the
+ database first. Progress is reported by get_fastresume_progress(). */
 void TorrentManager::load_fastresume() {
-	fs::path fastresume_path;
+	fs::path database_path;
 	try {
-		fastresume_path = fs::path(config.get_config<std::string>("directory.fastresume_path"));
+		database_path = fs::path(config.get_config<std::string>("directory.database_path"));
 	}
 	catch(const config_key_error &e) {
 		LOG_ERROR << "Fastresume not loaded. Could not get config: " << e.what();
 		return;
 	}
-
-	std::vector <fs::path> all_fastresume_files; 
-	if(!get_files_in_folder(fastresume_path, ".fastresume", all_fastresume_files)) {
-		LOG_ERROR << "Problem with fastresume directory " << fastresume_path.string() << ". Is this directory valid?";
+	if(!resume_data_store.open(database_path)) {
+		LOG_ERROR << "Fastresume not loaded. Could not open the database at " << database_path.string();
 		return;
 	}
 
-	for(fs::path fastresume_file : all_fastresume_files) {
-		std::vector<char> fastresume_buffer;
+	try {
+		fs::path fastresume_path = fs::path(config.get_config<std::string>("directory.fastresume_path"));
+		resume_data_store.migrate_files(fastresume_path);
+	}
+	catch(const config_key_error &e) {
+		// Nothing to migrate
+	}
 
-		{
-			std::ifstream ifs;
-			ifs.unsetf(std::ios_base::skipws);
-			ifs.open(fastresume_file.c_str(), std::ios_base::binary);
-			if(ifs.is_open()) {
-				std::istream_iterator<char> start(ifs), end;
-				fastresume_buffer = std::vector<char>(start, end);
-			}
-			else {
-				LOG_ERROR << "Could not open fastresume file: " << fastresume_file.string();	
-				continue;
+	fastresume_loader.start(
+		[this](std::vector<std::vector<char>> &resume_data) { return resume_data_store.load_all(resume_data); },
+		[this](std::vector<char> &fastresume_buffer, lt::add_torrent_params &atp) { return decode_fastresume(fastresume_buffer, atp); },
+		[this](std::vector<lt::add_torrent_params> &batch) {
+			for(lt::add_torrent_params const &atp : batch) {
+				wait_for_add_slot();
+				async_add(atp);
 			}
-		}
+		},
+		std::max(1u, std::thread::hardware_concurrency()), fastresume_batch_size);
+}
 
-	       	lt::bdecode_node fastresume_node;	
-		lt::error_code ec;
-		char const *fastresume_buf = fastresume_buffer.data();
-		int ret = lt::bdecode(fastresume_buf, fastresume_buf+fastresume_buffer.size(), fastresume_node, ec); 
-		if(ec) {
-			LOG_ERROR << "Problem occurred while decoding fastresume buffer: " << ec.message();
-			continue;
-		}
+// Called on shutdown. Torrents that were not added yet keep their resume data in the database.
+void TorrentManager::stop_loading_fastresume() {
+	{
+		std::lock_guard<std::mutex> lock(adds_in_flight_mutex);
+		loading_stopped = true;
+	}
+	add_done.notify_all();
+	fastresume_loader.stop();
+}
 
-		ec.clear();
-		lt::add_torrent_params atp = this->read_resume_data(fastresume_node, ec);
-		/* NOTE: using lt::add_torrent_params::resume_data is/will (???) be deprecated by libtorrent. The recommended way to 
-		 load fastresume data is to use lt::read_resume_data(). This is currently (2017-12-11) only available in master branch, 
-		 but maybe it will be available in future releases. Remember that. A few changes will be needed here.
-		 More info here: https://github.com/arvidn/libtorrent/pull/1776 */
-		atp.resume_data = fastresume_buffer;
-		
-		session.async_add_torrent(atp);
+FastresumeLoader::progress TorrentManager::get_fastresume_progress() {
+	return fastresume_loader.get_progress();
+}
 
-		LOG_DEBUG << "Fastresume torrent marked for asynchronous addition: " << fastresume_file.string();
+// Runs on the loader workers, so it only touches its arguments
+bool TorrentManager::decode_fastresume(std::vector<char> &fastresume_buffer, lt::add_torrent_params &atp) {
+       	lt::bdecode_node fastresume_node;	
+	lt::error_code ec;
+	char const *fastresume_buf = fastresume_buffer.data();
+	lt::bdecode(fastresume_buf, fastresume_buf+fastresume_buffer.size(), fastresume_node, ec); 
+	if(ec) {
+		LOG_ERROR << "Problem occurred while decoding fastresume buffer: " << ec.message();
+		return false;
 	}
+
+	ec.clear();
+	atp = this->read_resume_data(fastresume_node, ec);
+	/* NOTE: using lt::add_torrent_params::resume_data is/will (???) be deprecated by libtorrent. The recommended way to 
+	 load fastresume data is to use lt::read_resume_data(). This is currently (2017-12-11) only available in master branch, 
+	 but maybe it will be available in future releases. Remember that. A few changes will be needed here.
+	 More info here: https://github.com/arvidn/libtorrent/pull/1776 */
+	atp.resume_data = std::move(fastresume_buffer);
+	return true;
 }
 
 /* NOTE: (2017-12-14) This is a forked function from libtorrent master branch. This function is not in official releases yet, but I am using it
@@ -623,6 +733,9 @@ lt::add_torrent_params TorrentManager::read_resume_data(lt::bdecode_node const&
 {
 	lt::add_torrent_params ret;
 	ret.save_path = rd.dict_find_string_value("save_path");
+	// Not needed by libtorrent (it reads them from resume_data too), but they seed the cached limits in add_torrent_alert
+	ret.upload_limit = rd.dict_find_int_value("upload_rate_limit", -1);
+	ret.download_limit = rd.dict_find_int_value("download_rate_limit", -1);
 
 	return ret;
 }
@@ -679,62 +792,37 @@ void TorrentManager::load_session_extensions() {
 }
 
 unsigned long int TorrentManager::start_torrents(const std::vector<unsigned long int> ids) {
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	std::vector<std::shared_ptr<Torrent>> found;
 
 	// No ids specified. Start all torrents
 	if(ids.size() == 0) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			lt::torrent_handle handle = (*it)->get_handle();
-				handle.resume();
-		}
-		return 0;
+		found.assign(snapshot->begin(), snapshot->end());
 	}
-
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
+	else {
+		unsigned long int missing_id = snapshot->find_all(found, ids);
+		if(missing_id != 0)
+			return missing_id;
 	}
 
-	// Start torrents in ids
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				lt::torrent_handle handle = (*it)->get_handle();
-					handle.resume();
-			}
-		}
+	for(std::shared_ptr<Torrent> const &torrent : found) {
+		torrent->get_handle().resume();
 	}
+	wake_timers();
 	return 0;
 }
 
 unsigned long int TorrentManager::get_status_torrents(std::vector<lt::torrent_status> &torrent_status, const std::vector<unsigned long int> ids) {
-	// TODO - put this check in a function and use it in all other API methods to reduce redundancy
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
-	}
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	std::vector<std::shared_ptr<Torrent>> found;
+	unsigned long int missing_id = snapshot->find_all(found, ids);
+	if(missing_id != 0)
+		return missing_id;
 
 	// Get status from torrents in ids
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				lt::torrent_status status = (*it)->get_torrent_status();
-				torrent_status.push_back(status);
-			}
-		}
+	torrent_status.reserve(found.size());
+	for(std::shared_ptr<Torrent> const &torrent : found) {
+		torrent_status.push_back(torrent->get_torrent_status());
 	}
 
 	return 0;
@@ -745,9 +833,26 @@ void TorrentManager::post_session_stats() {
 	session.post_session_stats();
 }
 
+// The answer is a state_update_alert handled by check_alerts(), which refreshes the status cache
+void TorrentManager::post_torrent_updates() {
+	session.post_torrent_updates(Torrent::status_query_flags);
+}
+
 SessionStatus const TorrentManager::get_session_status() {
+	note_listener();
+	std::lock_guard<std::mutex> lock(session_status_mutex);
 	return session_status;
+}
 
+SessionHistory &TorrentManager::get_session_history() {
+	note_listener();
+	return session_history;
+}
+
+// Metrics never change after construction. Samples are read through SessionCounters::get_last_sample().
+SessionCounters const &TorrentManager::get_session_counters() {
+	note_listener();
+	return session_counters;
 }
 
 lt::settings_pack const TorrentManager::get_session_settings() {
@@ -756,86 +861,53 @@ lt::settings_pack const TorrentManager::get_session_settings() {
 }
 
 unsigned long int TorrentManager::get_torrents_info(std::vector<boost::shared_ptr<const lt::torrent_info>> &torrents_info, const std::vector<unsigned long int> ids) {
-	// TODO - put this check in a function and use it in all other API methods to reduce redundancy
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
-	}
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	std::vector<std::shared_ptr<Torrent>> found;
+	unsigned long int missing_id = snapshot->find_all(found, ids);
+	if(missing_id != 0)
+		return missing_id;
 
 	// Get info from torrents in ids
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				boost::shared_ptr<const lt::torrent_info> ti = (*it)->get_torrent_info();
-				torrents_info.push_back(ti);
-			}
-		}
+	torrents_info.reserve(found.size());
+	for(std::shared_ptr<Torrent> const &torrent : found) {
+		torrents_info.push_back(torrent->get_torrent_info());
 	}
 
 	return 0;
 }
 
 unsigned long int TorrentManager::get_settings_torrents(std::vector<Torrent::torrent_settings> &torrent_settings, const std::vector<unsigned long int> ids) {
-
-	// TODO - put this check in a function and use it in all other API methods to reduce redundancy
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
-	}
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	std::vector<std::shared_ptr<Torrent>> found;
+	unsigned long int missing_id = snapshot->find_all(found, ids);
+	if(missing_id != 0)
+		return missing_id;
 
 	// Get settings from torrents in ids
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				Torrent::torrent_settings ts = (*it)->get_torrent_settings();
-				torrent_settings.push_back(ts);
-			}
-		}
+	torrent_settings.reserve(found.size());
+	for(std::shared_ptr<Torrent> const &torrent : found) {
+		torrent_settings.push_back(torrent->get_torrent_settings());
 	}
 
 	return 0;
 }
 
 unsigned long int TorrentManager::set_settings_torrents(std::vector<Torrent::torrent_settings> &torrent_settings, const std::vector<unsigned long int> ids) {
-
-	// TODO - put this check in a function and use it in all other API methods to reduce redundancy
-	// Check if all torrents in ids in fact exist
-	for(unsigned long int id : ids) {
-		bool found = false;
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				found = true;
-			}
-		}
-		if(!found)
-			return id;
-	}
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
+	std::vector<std::shared_ptr<Torrent>> found;
+	unsigned long int missing_id = snapshot->find_all(found, ids);
+	if(missing_id != 0)
+		return missing_id;
 
 	// Set settings for torrents in ids
-	int index = 0;
-	for(unsigned long int id : ids) {
-		for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-			if((*it)->get_id() == id) {
-				(*it)->set_torrent_settings(torrent_settings.at(index));
-			}
-		}
-		index++;
+	for(std::size_t index = 0; index < found.size(); index++) {
+		found.at(index)->set_torrent_settings(torrent_settings.at(index));
 	}
 
+	// The alert loop publishes the new limits to the status cache
+	std::lock_guard<std::mutex> lock(limits_changed_mutex);
+	limits_changed.insert(limits_changed.end(), found.begin(), found.end());
+
 	return 0;
 }
 
@@ -847,29 +919,34 @@ unsigned long int TorrentManager::set_session_settings(lt::settings_pack const &
 }
 
 unsigned long int TorrentManager::set_session_queue(std::string const queue_position, const std::vector<unsigned long int> ids) {
+	std::shared_ptr<TorrentRegistry const> snapshot = torrents.snapshot();
 
 	if(ids.size() != 1) {
 		// TODO - log/return error. only one id is allowed
 	}
 	unsigned long int id  =  ids.at(0);
 
-	// TODO - put this check in a function and use it in all other API methods to reduce redundancy
-	// Check if all torrents in ids in fact exist
-	bool found = false;
-	for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-		if((*it)->get_id() == id) {
-			found = true;
-		}
-	}
-	if(!found)
+	std::shared_ptr<Torrent> torrent = snapshot->find(id);
+	if(!torrent)
 		return id;
 
 	// Set queue for torrent
-	for(std::vector<std::shared_ptr<Torrent>>::iterator it = torrents.begin(); it != torrents.end(); it++) {
-		if((*it)->get_id() == id) {
-			(*it)->set_queue_position(queue_position);
-		}
-	}
+	torrent->set_queue_position(queue_position);
 
 	return 0;
 }
+
+std::shared_ptr<TorrentStream> TorrentManager::open_stream(unsigned long int const id, int const file, std::uint64_t const readahead,
+		std::chrono::steady_clock::duration const timeout) {
+	std::shared_ptr<Torrent> torrent = torrents.snapshot()->find(id);
+	if(!torrent)
+		return std::shared_ptr<TorrentStream>();
+	boost::shared_ptr<const lt::torrent_info> info = torrent->get_torrent_info();
+	if(!info || file < 0 || file >= info->num_files())
+		return std::shared_ptr<TorrentStream>();
+	return std::make_shared<TorrentStream>(torrent->get_handle(), info, id, file, piece_waiter, piece_deadlines, readahead, timeout);
+}
+
+void TorrentManager::expire_piece_waiters() {
+	piece_waiter.expire(std::chrono::steady_clock::now());
+}
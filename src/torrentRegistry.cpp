@@ -0,0 +1,124 @@
+#include "torrentRegistry.h"
+
+TorrentRegistry::TorrentRegistry() {
+}
+
+// The indexes hold iterators into the list, so they must be rebuilt to point into the copied list
+TorrentRegistry::TorrentRegistry(TorrentRegistry const &other) {
+	by_id.reserve(other.by_id.size());
+	by_info_hash.reserve(other.by_info_hash.size());
+	for(std::shared_ptr<Torrent> const &torrent : other.torrents) {
+		insert(torrent);
+	}
+}
+
+TorrentRegistry& TorrentRegistry::operator=(TorrentRegistry const &other) {
+	if(this != &other) {
+		TorrentRegistry copy(other);
+		torrents.swap(copy.torrents);
+		by_id.swap(copy.by_id);
+		by_info_hash.swap(copy.by_info_hash);
+	}
+	return *this;
+}
+
+// Returns false if a torrent with the same id or info hash is already registered
+bool TorrentRegistry::insert(std::shared_ptr<Torrent> const torrent) {
+	if(by_id.count(torrent->get_id()) > 0 || by_info_hash.count(torrent->get_info_hash()) > 0) {
+		return false;
+	}
+	torrent_list::iterator it = torrents.insert(torrents.end(), torrent);
+	by_id.emplace(torrent->get_id(), it);
+	by_info_hash.emplace(torrent->get_info_hash(), it);
+	return true;
+}
+
+bool TorrentRegistry::erase(unsigned long int const id) {
+	auto it_id = by_id.find(id);
+	if(it_id == by_id.end()) {
+		return false;
+	}
+	torrent_list::iterator it = it_id->second;
+	by_info_hash.erase((*it)->get_info_hash());
+	by_id.erase(it_id);
+	torrents.erase(it);
+	return true;
+}
+
+bool TorrentRegistry::erase(lt::sha1_hash const &info_hash) {
+	auto it_info_hash = by_info_hash.find(info_hash);
+	if(it_info_hash == by_info_hash.end()) {
+		return false;
+	}
+	return erase((*it_info_hash->second)->get_id());
+}
+
+std::shared_ptr<Torrent> TorrentRegistry::find(unsigned long int const id) const {
+	auto it = by_id.find(id);
+	if(it == by_id.end()) {
+		return std::shared_ptr<Torrent>();
+	}
+	return *it->second;
+}
+
+std::shared_ptr<Torrent> TorrentRegistry::find(lt::sha1_hash const &info_hash) const {
+	auto it = by_info_hash.find(info_hash);
+	if(it == by_info_hash.end()) {
+		return std::shared_ptr<Torrent>();
+	}
+	return *it->second;
+}
+
+// Resolves every id in ids, in the same order. Returns the first id that does not exist, or 0 if all of them were found.
+unsigned long int TorrentRegistry::find_all(std::vector<std::shared_ptr<Torrent>> &found, std::vector<unsigned long int> const &ids) const {
+	found.reserve(found.size() + ids.size());
+	for(unsigned long int id : ids) {
+		std::shared_ptr<Torrent> torrent = find(id);
+		if(!torrent) {
+			return id;
+		}
+		found.push_back(torrent);
+	}
+	return 0;
+}
+
+std::vector<unsigned long int> TorrentRegistry::get_all_ids() const {
+	std::vector<unsigned long int> ids;
+	ids.reserve(torrents.size());
+	for(std::shared_ptr<Torrent> const &torrent : torrents) {
+		ids.push_back(torrent->get_id());
+	}
+	return ids;
+}
+
+std::size_t TorrentRegistry::size() const {
+	return torrents.size();
+}
+
+bool TorrentRegistry::empty() const {
+	return torrents.empty();
+}
+
+TorrentRegistry::const_iterator TorrentRegistry::begin() const {
+	return torrents.begin();
+}
+
+TorrentRegistry::const_iterator TorrentRegistry::end() const {
+	return torrents.end();
+}
+
+SharedTorrentRegistry::SharedTorrentRegistry() : current(std::make_shared<TorrentRegistry>()) {
+}
+
+std::shared_ptr<TorrentRegistry const> SharedTorrentRegistry::snapshot() const {
+	return std::atomic_load(&current);
+}
+
+// Writer side. The copy is private to the caller until it is published.
+std::shared_ptr<TorrentRegistry> SharedTorrentRegistry::copy() const {
+	return std::make_shared<TorrentRegistry>(*snapshot());
+}
+
+void SharedTorrentRegistry::publish(std::shared_ptr<TorrentRegistry const> const registry) {
+	std::atomic_store(&current, registry);
+}
@@ -0,0 +1,126 @@
+#include "torrentStatusFields.h"
+#include "responseBody.h"
+
+status_field_value::status_field_value(int const value) : type(int_value), int_number(value), double_number(0), boolean(false), text(NULL) {
+}
+
+status_field_value::status_field_value(boost::int64_t const value) : type(int_value), int_number(value), double_number(0), boolean(false), text(NULL) {
+}
+
+status_field_value::status_field_value(double const value) : type(double_value), int_number(0), double_number(value), boolean(false), text(NULL) {
+}
+
+status_field_value::status_field_value(bool const value) : type(bool_value), int_number(0), double_number(0), boolean(value), text(NULL) {
+}
+
+status_field_value::status_field_value(std::string const &value) : type(string_value), int_number(0), double_number(0), boolean(false), text(&value) {
+}
+
+bool status_field_value::operator==(status_field_value const &other) const {
+	if(type != other.type)
+		return false;
+	switch(type) {
+		case int_value:
+			return int_number == other.int_number;
+		case double_value:
+			return double_number == other.double_number;
+		case bool_value:
+			return boolean == other.boolean;
+		case string_value:
+			return *text == *other.text;
+	}
+	return false;
+}
+
+bool status_field_value::operator!=(status_field_value const &other) const {
+	return !(*this == other);
+}
+
+/* TODO - time_since_upload, time_since_download, active_time, finished_time and seeding_time are deprecated in libtorrent 1.2.
+ Use last_upload, last_download, seeding_duration, finished_duration and active_duration instead.
+ info_hash: If this handle is to a torrent that hasn't loaded yet (for instance by being added) by a URL, the value is undefined. */
+std::vector<status_field> const &get_torrent_status_fields() {
+	static std::vector<status_field> const fields = {
+		{"name", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.name); }},
+		{"download_rate", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.download_rate); }},
+		{"download_limit", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.download_limit); }},
+		{"upload_rate", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.upload_rate); }},
+		{"upload_limit", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.upload_limit); }},
+		{"progress", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.progress); }},
+		{"total_download", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.total_download); }},
+		{"total_payload_download", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.total_payload_download); }},
+		{"download_payload_rate", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.download_payload_rate); }},
+		{"total_payload_upload", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.total_payload_upload); }},
+		{"upload_payload_rate", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.upload_payload_rate); }},
+		{"total_failed_bytes", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.total_failed_bytes); }},
+		{"total_redundant_bytes", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.total_redundant_bytes); }},
+		{"total_done", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.total_done); }},
+		{"total_upload", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.total_upload); }},
+		{"num_seeds", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.num_seeds); }},
+		{"save_path", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.save_path); }},
+		{"next_announce", [](Torrent::status_snapshot const &snapshot) { return status_field_value(static_cast<boost::int64_t>(lt::duration_cast<lt::seconds>(snapshot.status.next_announce).count())); }},
+		{"current_tracker", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.current_tracker); }},
+		{"num_peers", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.num_peers); }},
+		{"total_wanted_done", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.total_wanted_done); }},
+		{"total_wanted", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.total_wanted); }},
+		{"all_time_upload", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.all_time_upload); }},
+		{"all_time_download", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.all_time_download); }},
+		{"added_time", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.added_time); }},
+		{"completed_time", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.completed_time); }},
+		{"last_seen_complete", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.last_seen_complete); }},
+		{"storage_mode", [](Torrent::status_snapshot const &snapshot) { return status_field_value(static_cast<int>(snapshot.status.storage_mode)); }},
+		{"progress_ppm", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.progress_ppm); }},
+		{"queue_position", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.queue_position); }},
+		{"num_complete", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.num_complete); }},
+		{"num_incomplete", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.num_incomplete); }},
+		{"list_seeds", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.list_seeds); }},
+		{"list_peers", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.list_peers); }},
+		{"connect_candidates", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.connect_candidates); }},
+		{"num_pieces", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.num_pieces); }},
+		{"distributed_full_copies", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.distributed_full_copies); }},
+		{"distributed_fraction", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.distributed_fraction); }},
+		{"distributed_copies", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.distributed_copies); }},
+		{"block_size", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.block_size); }},
+		{"num_uploads", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.num_uploads); }},
+		{"num_connections", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.num_connections); }},
+		{"uploads_limit", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.uploads_limit); }},
+		{"connections_limit", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.connections_limit); }},
+		{"up_bandwidth_queue", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.up_bandwidth_queue); }},
+		{"down_bandwidth_queue", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.down_bandwidth_queue); }},
+		{"seed_rank", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.seed_rank); }},
+		{"checking_resume_data", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.checking_resume_data); }},
+		{"need_save_resume", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.need_save_resume); }},
+		{"is_seeding", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.is_seeding); }},
+		{"is_finished", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.is_finished); }},
+		{"has_metadata", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.has_metadata); }},
+		{"has_incoming", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.has_incoming); }},
+		{"moving_storage", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.moving_storage); }},
+		{"announcing_to_trackers", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.announcing_to_trackers); }},
+		{"announcing_to_lsd", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.announcing_to_lsd); }},
+		{"announcing_to_dht", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.announcing_to_dht); }},
+		{"time_since_upload", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.time_since_upload); }},
+		{"time_since_download", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.time_since_download); }},
+		{"active_time", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.active_time); }},
+		{"finished_time", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.finished_time); }},
+		{"seeding_time", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.status.seeding_time); }},
+		{"info_hash", [](Torrent::status_snapshot const &snapshot) { return status_field_value(snapshot.info_hash); }}
+	};
+	return fields;
+}
+
+void write_status_value(ValueWriter &writer, status_field_value const &value) {
+	switch(value.type) {
+		case status_field_value::int_value:
+			writer.Int64(value.int_number);
+			break;
+		case status_field_value::double_value:
+			writer.Double(value.double_number);
+			break;
+		case status_field_value::bool_value:
+			writer.Bool(value.boolean);
+			break;
+		case status_field_value::string_value:
+			writer.String(value.text->c_str(), value.text->length());
+			break;
+	}
+}
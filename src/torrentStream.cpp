@@ -0,0 +1,136 @@
+#include "torrentStream.h"
+#include "plog/Log.h"
+#include <algorithm>
+#include <limits>
+
+std::chrono::steady_clock::duration const TorrentStream::retry_interval = std::chrono::seconds(5);
+
+TorrentStream::TorrentStream(lt::torrent_handle const &handle, boost::shared_ptr<const lt::torrent_info> const info,
+		unsigned long int const id, int const file, PieceWaiter &waiter, PieceDeadlines &deadlines, std::uint64_t const readahead,
+		std::chrono::steady_clock::duration const timeout) : handle(handle), info(info), id(id), file(file), waiter(waiter),
+	deadlines(deadlines), readahead(readahead), timeout(timeout), window_first(-1), window_last(-1), cached_piece(-1),
+	cached_size(0) {
+}
+
+TorrentStream::~TorrentStream() {
+	std::lock_guard<std::mutex> lock(window_mutex);
+	move_window(-1, -1);
+}
+
+std::uint64_t TorrentStream::size() const {
+	return info->files().file_size(file);
+}
+
+std::string TorrentStream::get_name() const {
+	return info->files().file_name(file);
+}
+
+lt::sha1_hash TorrentStream::get_info_hash() const {
+	return info->info_hash();
+}
+
+int TorrentStream::get_piece(std::uint64_t const position) const {
+	return info->files().map_file(file, position, 1).piece;
+}
+
+bool TorrentStream::find_cached(int const piece, boost::shared_array<char> &data, int &size) {
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if(piece != cached_piece)
+		return false;
+	data = cached_data;
+	size = cached_size;
+	return true;
+}
+
+// Only one piece is kept, so a stream holds at most one piece in memory besides the ones being sent
+void TorrentStream::cache(int const piece, boost::shared_array<char> const &data, int const size) {
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	cached_piece = piece;
+	cached_data = data;
+	cached_size = size;
+}
+
+/* Pieces that were in the window and are not anymore are released, and lose their deadline if no other stream holds them.
+ Pieces that stay keep theirs, which is earlier. Called with window_mutex held. */
+void TorrentStream::move_window(int const first, int const last) {
+	lt::torrent_handle &h = handle;
+	unsigned long int const torrent_id = id;
+	std::function<void(int const)> const reset = [&h, torrent_id](int const piece) {
+		try {
+			h.reset_piece_deadline(piece);
+		}
+		catch(const lt::libtorrent_exception &e) {
+			LOG_DEBUG << "Could not reset piece deadline of torrent " << torrent_id << ": " << e.what();
+		}
+	};
+	for(int piece = window_first; window_first >= 0 && piece <= window_last; piece++) {
+		if(piece < first || piece > last)
+			deadlines.release(id, piece, [&reset, piece]() { reset(piece); });
+	}
+	for(int piece = first; first >= 0 && piece <= last; piece++) {
+		if(piece >= window_first && piece <= window_last)
+			continue;
+		int const deadline = (piece - first) * deadline_step_ms;
+		deadlines.hold(id, piece, [&h, torrent_id, piece, deadline]() {
+			try {
+				h.set_piece_deadline(piece, deadline);
+			}
+			catch(const lt::libtorrent_exception &e) {
+				LOG_DEBUG << "Could not set piece deadline of torrent " << torrent_id << ": " << e.what();
+			}
+		});
+	}
+	window_first = first;
+	window_last = last;
+}
+
+void TorrentStream::read(std::uint64_t const position, std::uint64_t const max, read_handler const handler) {
+	if(position >= size() || max == 0) {
+		handler(boost::shared_array<char>(), NULL, 0);
+		return;
+	}
+	std::uint64_t const length = std::min<std::uint64_t>({max, size() - position,
+			static_cast<std::uint64_t>(std::numeric_limits<int>::max())});
+	lt::peer_request const request = info->files().map_file(file, position, static_cast<int>(length));
+	int const available = std::min(request.length, info->piece_size(request.piece) - request.start);
+
+	// A read somewhere else, like after a seek, moves the whole window there
+	std::uint64_t const window_end = std::min(position + std::max<std::uint64_t>(readahead, 1), size()) - 1;
+	{
+		std::lock_guard<std::mutex> lock(window_mutex);
+		move_window(request.piece, get_piece(window_end));
+	}
+
+	boost::shared_array<char> data;
+	int data_size;
+	if(find_cached(request.piece, data, data_size) && data_size >= request.start + available) {
+		handler(data, data.get() + request.start, available);
+		return;
+	}
+	wait_for_piece(request.piece, request.start, available, std::chrono::steady_clock::now() + timeout, handler);
+}
+
+void TorrentStream::wait_for_piece(int const piece, int const start, int const length,
+		std::chrono::steady_clock::time_point const give_up, read_handler const handler) {
+	std::shared_ptr<TorrentStream> self = shared_from_this();
+	std::chrono::steady_clock::time_point const retry = std::min(std::chrono::steady_clock::now() + retry_interval, give_up);
+	waiter.wait(id, piece, retry, [self, piece, start, length, give_up, handler](PieceWaiter::result const outcome,
+				boost::shared_array<char> const &data, int const size) {
+		if(outcome == PieceWaiter::result::read && size >= start + length) {
+			self->cache(piece, data, size);
+			handler(data, data.get() + start, length);
+		}
+		else if(outcome == PieceWaiter::result::expired && std::chrono::steady_clock::now() < give_up)
+			self->wait_for_piece(piece, start, length, give_up, handler);
+		else
+			handler(boost::shared_array<char>(), NULL, 0);
+	});
+	// Posts a read_piece_alert as soon as the piece is downloaded, or right away if it already is
+	try {
+		handle.set_piece_deadline(piece, 0, lt::torrent_handle::alert_when_available);
+	}
+	catch(const lt::libtorrent_exception &e) {
+		LOG_DEBUG << "Could not request piece " << piece << " of torrent " << id << ": " << e.what();
+		waiter.piece_read(id, piece, boost::shared_array<char>(), 0);
+	}
+}
@@ -5,16 +5,26 @@
 #include <cwchar>
 #include "restAPI.h"
 #include "torrentine.h"
+#include "eventLoop.h"
+#include <thread>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
 #include <cstdlib>
+#include <curl/curl.h>
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
 
-volatile sig_atomic_t shutdown_flag = 0;
 int main(int argc, char const* argv[])
 {
+	/* Shutdown signals are only handled by the signal thread below. They must be blocked before any other thread is created
+	 (libtorrent, RestAPI) so those threads inherit the mask. */
+	sigset_t shutdown_signals;
+	sigemptyset(&shutdown_signals);
+	sigaddset(&shutdown_signals, SIGINT);
+	sigaddset(&shutdown_signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &shutdown_signals, NULL);
+
 	fs::path config_file;
 	try {
 		parse_arguments(argc, argv, config_file);
@@ -41,54 +51,77 @@ int main(int argc, char const* argv[])
 	}
 
 	initialize_log(config);
+	// Torrents added by URL are downloaded with curl from the API worker threads. Global init is not thread safe.
+	curl_global_init(CURL_GLOBAL_DEFAULT);
 	
 	TorrentManager torrent_manager(config);
 	//torrent_manager.load_session_settings();
 	torrent_manager.load_session_state();
 	torrent_manager.load_session_extensions();
-	torrent_manager.load_fastresume();
+	torrent_manager.load_fastresume(); // Returns right away. Torrents keep being added while the API is served.
 
 	RestAPI api(config, torrent_manager);
 	api.start_server();
 
-	std::chrono::steady_clock::time_point last_save_fastresume = std::chrono::steady_clock::now();
-	std::chrono::steady_clock::time_point last_post_session_stats = std::chrono::steady_clock::now();
-	signal(SIGINT, shutdown_program);
-	while(!shutdown_flag) {
-		torrent_manager.update_torrent_console_view();
-		torrent_manager.check_alerts();
-		if(std::chrono::steady_clock::now() - last_post_session_stats > std::chrono::seconds(2)) {
-			torrent_manager.post_session_stats();
-			last_post_session_stats  = std::chrono::steady_clock::now();
-		} 
-		torrent_manager.wait_for_alert(lt::milliseconds(1000));	
-		// TODO - Ideally saving fastresume periodically should be done outside the main thread because this may take some time, but there
-		// are some special cases that need to be addressed before putting this in another thread. Libtorrent says:
-		// Make sure to not remove_torrent() before you receive the save_resume_data_alert though. What happens is that the removed torrent may 
-		// incorrectly still exist in the fastresume data.
-		if(std::chrono::steady_clock::now() - last_save_fastresume > std::chrono::seconds(60)) {
-			torrent_manager.save_fastresume(lt::torrent_handle::save_resume_flags_t::save_info_dict |
-							lt::torrent_handle::save_resume_flags_t::only_if_modified);
-			last_save_fastresume = std::chrono::steady_clock::now();
-		} 
+	EventLoop event_loop;
+	torrent_manager.set_alert_notify([&event_loop]() { event_loop.notify(); });
+	torrent_manager.set_timer_wakeup([&event_loop]() { event_loop.wake_timers(); });
+	// Status and stats timers park while every torrent is paused and nobody is asking for status
+	event_loop.add_timer(std::chrono::seconds(1), [&torrent_manager]() { torrent_manager.post_torrent_updates(); },
+			[&torrent_manager]() { return torrent_manager.needs_updates(); });
+	// One sample per second feeds the session history
+	event_loop.add_timer(std::chrono::seconds(1), [&torrent_manager]() { torrent_manager.post_session_stats(); },
+			[&torrent_manager]() { return torrent_manager.needs_updates(); });
+	// Streams waiting for pieces that did not arrive in time ask for them again or give up
+	event_loop.add_timer(std::chrono::seconds(1), [&torrent_manager]() { torrent_manager.expire_piece_waiters(); },
+			[&torrent_manager]() { return torrent_manager.has_piece_waiters(); });
+	// Only asks for the resume data. The ResumeDataStore thread writes the replies to the database as they arrive.
+	event_loop.add_timer(std::chrono::seconds(60), [&torrent_manager]() {
+		torrent_manager.save_fastresume(lt::torrent_handle::save_resume_flags_t::save_info_dict |
+						lt::torrent_handle::save_resume_flags_t::only_if_modified);
+	});
+	if(is_console_view_enabled(config)) {
+		event_loop.add_timer(std::chrono::seconds(1), [&torrent_manager]() { torrent_manager.update_torrent_console_view(); });
 	}
 
+	std::thread signal_thread([&shutdown_signals, &event_loop]() {
+		int signal_number;
+		sigwait(&shutdown_signals, &signal_number);
+		LOG_INFO << "Shutting down program";
+		event_loop.stop();
+	});
+
+	event_loop.run([&torrent_manager]() { torrent_manager.check_alerts(); });
+	signal_thread.join();
+	torrent_manager.stop_loading_fastresume();
+
+	// Alerts are handled by polling from here on. The notify callback must not outlive event_loop.
+	torrent_manager.set_alert_notify([]() {});
+	torrent_manager.set_timer_wakeup([]() {});
 	torrent_manager.pause_session(); // Session is paused so fastresume data will be valid once it finishes
 	torrent_manager.save_fastresume(lt::torrent_handle::save_resume_flags_t::flush_disk_cache  |
 					lt::torrent_handle::save_resume_flags_t::save_info_dict            |
-					lt::torrent_handle::save_resume_flags_t::only_if_modified);
+					lt::torrent_handle::save_resume_flags_t::only_if_modified, false);
+	torrent_manager.wait_for_fastresume(std::chrono::seconds(30));
 	torrent_manager.save_session_state();
 
 	config.save_config(config_file);
 	
 	api.stop_server();
+	curl_global_cleanup();
 	
 	return 0;
 }
 
-void shutdown_program(int s) {
-	LOG_INFO << "Shutting down program";
-	shutdown_flag = 1;	
+// The console view prints every torrent once a second, so it is only meant for debugging
+bool is_console_view_enabled(ConfigManager &config) {
+	try {
+		return config.get_config<std::string>("log.console_view") == "enabled";
+	}
+	catch(config_key_error const &e) {
+		LOG_DEBUG << "Console view disabled. Could not get config: " << e.what();
+		return false;
+	}
 }
 
 void parse_arguments(int const argc, char const* argv[], fs::path &config_file) {
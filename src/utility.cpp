@@ -9,9 +9,6 @@
 #include <openssl/evp.h>
 #include <openssl/sha.h>
 #include <openssl/crypto.h>
-#include <boost/iostreams/filtering_streambuf.hpp>
-#include <boost/iostreams/copy.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
 #include <curl/curl.h>
 
 std::string random_string(int const size, std::string chars) {
@@ -32,9 +29,14 @@ bool file_to_buffer(std::vector<char> &buffer, std::string const filename) {
 	else {	
 		ifs.seekg(0, std::ios_base::end);
 		std::streampos fileSize = ifs.tellg();
+		if(fileSize < 0)
+			return false;
 		buffer.resize(fileSize);
-		ifs.seekg(0, std::ios_base::beg);
-		ifs.read(&buffer[0], fileSize);
+		// &buffer[0] is not valid on an empty vector
+		if(fileSize > 0) {
+			ifs.seekg(0, std::ios_base::beg);
+			ifs.read(buffer.data(), fileSize);
+		}
 		return true;
 	}
 }
@@ -107,15 +109,6 @@ std::string generate_password_hash(const char* pass, const unsigned char* salt)
 	return std::string(hexResult, hexResult_size-1); // -1 to ignore '\0'. We dont need it in std::strings
 }
 
-std::string gzip_encode(std::string s) {
-	std::stringstream ss(s), ss_compressed;
-	boost::iostreams::filtering_streambuf< boost::iostreams::input> in;
-	in.push(boost::iostreams::gzip_compressor());
-	in.push(ss);
-	boost::iostreams::copy(in, ss_compressed);
-	return ss_compressed.str();
-}
-
 bool is_text_boolean(std::string const s) {
 	if(s == "true" || s == "false") {
 		return true;
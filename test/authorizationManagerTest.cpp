@@ -0,0 +1,97 @@
+#include "catch/catch.hpp"
+#include "authorizationManager.h"
+#include "utility.h"
+#include "cpp-base64/base64.h"
+
+namespace {
+
+std::string basic_header(std::string const &credentials) {
+	return "Basic " + base64_encode(reinterpret_cast<unsigned char const*>(credentials.data()), credentials.size());
+}
+
+void set_user(sqlite3 *db, std::string const &username, std::string const &password) {
+	std::string const salt = "0123456789abcdef";
+	std::string const password_hash = generate_password_hash(password.c_str(), (unsigned char*)salt.c_str());
+	sqlite3_stmt *stmt;
+	sqlite3_prepare_v2(db, "insert or replace into users (id, username, password, salt) values (1, ?, ?, ?)", -1, &stmt, NULL);
+	sqlite3_bind_text(stmt, 1, username.c_str(), username.size(), SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, password_hash.c_str(), password_hash.size(), SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 3, salt.c_str(), salt.size(), SQLITE_STATIC);
+	sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+}
+
+std::int64_t users_version(sqlite3 *db) {
+	sqlite3_stmt *stmt;
+	sqlite3_prepare_v2(db, "select version from users_version where id = 0", -1, &stmt, NULL);
+	std::int64_t version = -1;
+	if(sqlite3_step(stmt) == SQLITE_ROW)
+		version = sqlite3_column_int64(stmt, 0);
+	sqlite3_finalize(stmt);
+	return version;
+}
+
+}
+
+TEST_CASE( "Credentials are verified once and cached until the user changes", "[authorization_manager]" ) {
+	fs::path directory = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(directory);
+	fs::path database = directory / "torrentine.db";
+
+	sqlite3 *db;
+	REQUIRE( sqlite3_open(database.string().c_str(), &db) == SQLITE_OK );
+	sqlite3_exec(db, "create table users (id integer primary key, username text unique, password text, salt text)", NULL, NULL, NULL);
+	set_user(db, "admin", "secret");
+
+	{
+		AuthorizationManager authorization_manager;
+		REQUIRE( authorization_manager.open(database) );
+		REQUIRE( authorization_manager.is_authorization_valid(basic_header("admin:secret")) );
+		REQUIRE( authorization_manager.is_authorization_valid(basic_header("admin:secret")) );
+		REQUIRE_FALSE( authorization_manager.is_authorization_valid(basic_header("admin:wrong")) );
+		REQUIRE_FALSE( authorization_manager.is_authorization_valid(basic_header("nobody:secret")) );
+		REQUIRE_FALSE( authorization_manager.is_authorization_valid("Bearer abc") );
+
+		// A write that does not touch the users table leaves users_version alone and keeps the cached header valid
+		std::int64_t const version = users_version(db);
+		sqlite3_exec(db, "create table other (id integer); insert into other values (1)", NULL, NULL, NULL);
+		REQUIRE( users_version(db) == version );
+		REQUIRE( authorization_manager.is_authorization_valid(basic_header("admin:secret")) );
+
+		set_user(db, "admin", "changed");
+		REQUIRE( users_version(db) > version );
+		REQUIRE_FALSE( authorization_manager.is_authorization_valid(basic_header("admin:secret")) );
+		REQUIRE( authorization_manager.is_authorization_valid(basic_header("admin:changed")) );
+	}
+
+	SECTION( "Cached credentials expire" ) {
+		AuthorizationManager authorization_manager(std::chrono::milliseconds(0));
+		REQUIRE( authorization_manager.open(database) );
+		REQUIRE( authorization_manager.is_authorization_valid(basic_header("admin:changed")) );
+		sqlite3_exec(db, "delete from users", NULL, NULL, NULL);
+		REQUIRE_FALSE( authorization_manager.is_authorization_valid(basic_header("admin:changed")) );
+	}
+
+	sqlite3_close(db);
+	fs::remove_all(directory);
+}
+
+TEST_CASE( "Bearer tokens are accepted until they expire", "[authorization_manager]" ) {
+	AuthorizationManager authorization_manager;
+	REQUIRE( authorization_manager.issue_token("admin").empty() );
+	REQUIRE_FALSE( authorization_manager.is_authorization_valid("Bearer abc.def") );
+
+	authorization_manager.configure_tokens("server secret", std::chrono::seconds(60));
+	std::string const token = authorization_manager.issue_token("admin", 1000);
+	REQUIRE( authorization_manager.is_token_valid(token, 1059) );
+	REQUIRE_FALSE( authorization_manager.is_token_valid(token, 1060) );
+	REQUIRE( authorization_manager.is_authorization_valid("Bearer " + authorization_manager.issue_token("admin")) );
+
+	// Changing the payload or the secret breaks the signature
+	std::string forged = token;
+	forged[0] = forged[0] == 'A' ? 'B' : 'A';
+	REQUIRE_FALSE( authorization_manager.is_token_valid(forged, 1000) );
+	REQUIRE_FALSE( authorization_manager.is_token_valid("no dot", 1000) );
+	authorization_manager.configure_tokens("another secret", std::chrono::seconds(60));
+	REQUIRE_FALSE( authorization_manager.is_token_valid(token, 1000) );
+}
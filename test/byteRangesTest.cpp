@@ -0,0 +1,78 @@
+#include "catch/catch.hpp"
+#include "byteRanges.h"
+#include <string>
+#include <vector>
+
+TEST_CASE( "Range headers are parsed into sorted, merged ranges", "[byte_ranges]" ) {
+	std::vector<byte_range> ranges;
+
+	REQUIRE( parse_range_header("bytes=0-499", 10000, ranges) == range_request::partial );
+	REQUIRE( ranges.size() == 1 );
+	REQUIRE( ranges[0].first == 0 );
+	REQUIRE( ranges[0].last == 499 );
+	REQUIRE( ranges[0].length() == 500 );
+
+	// Open ended and suffix ranges, and a last position past the end of the file
+	REQUIRE( parse_range_header("bytes=9500-", 10000, ranges) == range_request::partial );
+	REQUIRE( (ranges[0].first == 9500 && ranges[0].last == 9999) );
+	REQUIRE( parse_range_header("bytes=-500", 10000, ranges) == range_request::partial );
+	REQUIRE( (ranges[0].first == 9500 && ranges[0].last == 9999) );
+	REQUIRE( parse_range_header("bytes=-20000", 10000, ranges) == range_request::partial );
+	REQUIRE( (ranges[0].first == 0 && ranges[0].last == 9999) );
+	REQUIRE( parse_range_header("Bytes = 9000-20000", 10000, ranges) == range_request::partial );
+	REQUIRE( (ranges[0].first == 9000 && ranges[0].last == 9999) );
+
+	REQUIRE( parse_range_header("bytes=5000-5999, 0-99 ,, 50-150, 6010-6100", 10000, ranges) == range_request::partial );
+	REQUIRE( ranges.size() == 2 );
+	REQUIRE( (ranges[0].first == 0 && ranges[0].last == 150) );
+	REQUIRE( (ranges[1].first == 5000 && ranges[1].last == 6100) );
+	REQUIRE( parse_range_header("bytes=0-0,9999-9999", 10000, ranges) == range_request::partial );
+	REQUIRE( ranges.size() == 2 );
+
+	// Unsatisfiable ranges are dropped while any other range can be served
+	REQUIRE( parse_range_header("bytes=20000-30000,0-9", 10000, ranges) == range_request::partial );
+	REQUIRE( ranges.size() == 1 );
+}
+
+TEST_CASE( "Range headers that can not be served", "[byte_ranges]" ) {
+	std::vector<byte_range> ranges;
+
+	REQUIRE( parse_range_header("bytes=10000-", 10000, ranges) == range_request::unsatisfiable );
+	REQUIRE( parse_range_header("bytes=-0", 10000, ranges) == range_request::unsatisfiable );
+	REQUIRE( parse_range_header("bytes=0-", 0, ranges) == range_request::unsatisfiable );
+	REQUIRE( parse_range_header("bytes=-10", 0, ranges) == range_request::unsatisfiable );
+
+	// Syntax errors and other units mean the header is ignored
+	REQUIRE( parse_range_header("", 10000, ranges) == range_request::whole );
+	REQUIRE( parse_range_header("bytes=", 10000, ranges) == range_request::whole );
+	REQUIRE( parse_range_header("bytes=500-100", 10000, ranges) == range_request::whole );
+	REQUIRE( parse_range_header("bytes=a-100", 10000, ranges) == range_request::whole );
+	REQUIRE( parse_range_header("bytes=100", 10000, ranges) == range_request::whole );
+	REQUIRE( parse_range_header("bytes=0-99999999999999999999999", 10000, ranges) == range_request::whole );
+	REQUIRE( parse_range_header("items=0-10", 10000, ranges) == range_request::whole );
+	REQUIRE( ranges.empty() );
+
+	std::string many = "bytes=0-0";
+	for(std::size_t i = 1; i <= max_byte_ranges; i++) {
+		many += "," + std::to_string(i * 1000) + "-" + std::to_string(i * 1000);
+	}
+	REQUIRE( parse_range_header(many, 1000000, ranges) == range_request::whole );
+}
+
+TEST_CASE( "Content-Range, If-Range and multipart separators", "[byte_ranges]" ) {
+	REQUIRE( get_content_range({100, 199}, 10000) == "bytes 100-199/10000" );
+	REQUIRE( get_unsatisfied_content_range(10000) == "bytes */10000" );
+
+	REQUIRE( format_http_date(784111777) == "Sun, 06 Nov 1994 08:49:37 GMT" );
+	REQUIRE( if_range_matches("\"abc\"", "\"abc\"", "Sun, 06 Nov 1994 08:49:37 GMT") );
+	REQUIRE_FALSE( if_range_matches("\"abd\"", "\"abc\"", "Sun, 06 Nov 1994 08:49:37 GMT") );
+	REQUIRE_FALSE( if_range_matches("W/\"abc\"", "\"abc\"", "Sun, 06 Nov 1994 08:49:37 GMT") );
+	REQUIRE( if_range_matches(" Sun, 06 Nov 1994 08:49:37 GMT", "\"abc\"", "Sun, 06 Nov 1994 08:49:37 GMT") );
+	REQUIRE_FALSE( if_range_matches("Sun, 06 Nov 1994 08:49:38 GMT", "\"abc\"", "Sun, 06 Nov 1994 08:49:37 GMT") );
+
+	std::vector<std::string> const separators = get_multipart_separators("b0undary", {{0, 9}, {100, 109}}, 1000);
+	REQUIRE( separators.size() == 3 );
+	REQUIRE( separators[0] == "--b0undary\r\nContent-Range: bytes 0-9/1000\r\n\r\n" );
+	REQUIRE( separators[1] == "\r\n--b0undary\r\nContent-Range: bytes 100-109/1000\r\n\r\n" );
+	REQUIRE( separators[2] == "\r\n--b0undary--\r\n" );
+}
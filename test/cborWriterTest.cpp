@@ -0,0 +1,83 @@
+#include "catch/catch.hpp"
+#include "cborWriter.h"
+#include "responseBody.h"
+#include "rapidjson/stringbuffer.h"
+#include <string>
+
+namespace {
+
+std::string bytes(std::initializer_list<unsigned char> const list) {
+	return std::string(list.begin(), list.end());
+}
+
+}
+
+TEST_CASE( "CBOR items are written as in RFC 7049", "[cbor_writer]" ) {
+	rapidjson::StringBuffer buffer;
+	CborWriter<rapidjson::StringBuffer> writer(buffer);
+	auto written = [&buffer]() {
+		std::string const out(buffer.GetString(), buffer.GetSize());
+		buffer.Clear();
+		return out;
+	};
+
+	writer.Uint64(0);
+	REQUIRE( written() == bytes({0x00}) );
+	writer.Int(23);
+	REQUIRE( written() == bytes({0x17}) );
+	writer.Int(24);
+	REQUIRE( written() == bytes({0x18, 0x18}) );
+	writer.Uint(1000);
+	REQUIRE( written() == bytes({0x19, 0x03, 0xe8}) );
+	writer.Uint64(1000000000000);
+	REQUIRE( written() == bytes({0x1b, 0x00, 0x00, 0x00, 0xe8, 0xd4, 0xa5, 0x10, 0x00}) );
+	writer.Int(-1);
+	REQUIRE( written() == bytes({0x20}) );
+	writer.Int64(-1000);
+	REQUIRE( written() == bytes({0x39, 0x03, 0xe7}) );
+	writer.Double(1.5);
+	REQUIRE( written() == bytes({0xfa, 0x3f, 0xc0, 0x00, 0x00}) );
+	writer.Double(1.1);
+	REQUIRE( written() == bytes({0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a}) );
+	writer.Double(1e300);
+	REQUIRE( written() == bytes({0xfb, 0x7e, 0x37, 0xe4, 0x3c, 0x88, 0x00, 0x75, 0x9c}) );
+	writer.Bool(true);
+	writer.Bool(false);
+	writer.Null();
+	REQUIRE( written() == bytes({0xf5, 0xf4, 0xf6}) );
+	writer.String("IETF");
+	REQUIRE( written() == bytes({0x64, 0x49, 0x45, 0x54, 0x46}) );
+
+	writer.StartObject();
+	writer.Key("a");
+	writer.Int(1);
+	writer.Key("b");
+	writer.StartArray();
+	writer.Int(2);
+	writer.Int(3);
+	writer.EndArray();
+	writer.EndObject();
+	REQUIRE( written() == bytes({0xbf, 0x61, 0x61, 0x01, 0x61, 0x62, 0x9f, 0x02, 0x03, 0xff, 0xff}) );
+}
+
+TEST_CASE( "Documents and streamed listings give the same CBOR", "[cbor_writer]" ) {
+	rapidjson::Document document;
+	document.SetObject();
+	document.AddMember("message", "ok", document.GetAllocator());
+	document.AddMember("progress", 0.25, document.GetAllocator());
+	response_body const body = write_cbor_body(document);
+
+	rapidjson::StringBuffer buffer;
+	ValueWriterAdapter<CborWriter<rapidjson::StringBuffer>, rapidjson::StringBuffer> adapter(buffer);
+	ValueWriter &writer = adapter;
+	writer.StartObject();
+	writer.Key("message");
+	writer.String("ok");
+	writer.Key("progress");
+	writer.Double(0.25);
+	writer.EndObject();
+
+	REQUIRE( std::string(body.data, body.size) == std::string(buffer.GetString(), buffer.GetSize()) );
+	REQUIRE( std::string(body.data, body.size) == bytes({0xbf, 0x67, 'm', 'e', 's', 's', 'a', 'g', 'e', 0x62, 'o', 'k',
+				0x68, 'p', 'r', 'o', 'g', 'r', 'e', 's', 's', 0xfa, 0x3e, 0x80, 0x00, 0x00, 0xff}) );
+}
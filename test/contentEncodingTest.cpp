@@ -0,0 +1,47 @@
+#include "catch/catch.hpp"
+#include "contentEncoding.h"
+
+TEST_CASE( "Accept-Encoding is negotiated with q-values", "[content_encoding]" ) {
+	REQUIRE( negotiate_content_coding("") == content_coding::identity );
+	REQUIRE( negotiate_content_coding("gzip") == content_coding::gzip );
+	REQUIRE( negotiate_content_coding("deflate, gzip") == content_coding::gzip );
+	REQUIRE( negotiate_content_coding("br,  deflate") == content_coding::deflate );
+	REQUIRE( negotiate_content_coding(" GZIP ;Q=0.5 , deflate;q=0.8") == content_coding::deflate );
+	REQUIRE( negotiate_content_coding("gzip;q=0, deflate;q=0") == content_coding::identity );
+	REQUIRE( negotiate_content_coding("identity, br") == content_coding::identity );
+
+	// * covers every coding that is not listed
+	REQUIRE( negotiate_content_coding("*") != content_coding::identity );
+	REQUIRE( negotiate_content_coding("gzip;q=0, *;q=0.5") != content_coding::gzip );
+	REQUIRE( negotiate_content_coding("*;q=0") == content_coding::identity );
+
+	REQUIRE( accepts_content_coding("deflate;q=1, gzip;q=0.1", content_coding::gzip) );
+	REQUIRE( accepts_content_coding("*", content_coding::gzip) );
+	REQUIRE_FALSE( accepts_content_coding("gzip;q=0", content_coding::gzip) );
+	REQUIRE_FALSE( accepts_content_coding("deflate", content_coding::gzip) );
+	REQUIRE( accepts_content_coding("", content_coding::identity) );
+}
+
+TEST_CASE( "Accept is negotiated with q-values and specificity", "[content_encoding]" ) {
+	REQUIRE( prefers_media_type("application/cbor", "application/cbor", "application/json") );
+	REQUIRE( prefers_media_type("application/cbor, */*", "application/cbor", "application/json") );
+	REQUIRE( prefers_media_type("Application/CBOR;q=0.9, application/json;q=0.5", "application/cbor", "application/json") );
+	REQUIRE_FALSE( prefers_media_type("", "application/cbor", "application/json") );
+	REQUIRE_FALSE( prefers_media_type("*/*", "application/cbor", "application/json") );
+	REQUIRE_FALSE( prefers_media_type("application/*", "application/cbor", "application/json") );
+	REQUIRE_FALSE( prefers_media_type("application/cbor;q=0", "application/cbor", "application/json") );
+	REQUIRE_FALSE( prefers_media_type("application/cbor;q=0, */*", "application/cbor", "application/json") );
+	REQUIRE_FALSE( prefers_media_type("application/cbor;q=0.5, application/json", "application/cbor", "application/json") );
+	REQUIRE_FALSE( prefers_media_type("application/cbor, application/json", "application/cbor", "application/json") );
+}
+
+TEST_CASE( "Compression levels are set per body class", "[content_encoding]" ) {
+	compression_settings settings;
+	settings.api_level = 4;
+	settings.listing_level = 1;
+	settings.text_level = 9;
+	REQUIRE( settings.get_level(body_class::api) == 4 );
+	REQUIRE( settings.get_level(body_class::listing) == 1 );
+	REQUIRE( settings.get_level(body_class::text) == 9 );
+	REQUIRE( get_content_coding_name(content_coding::gzip) == std::string("gzip") );
+}
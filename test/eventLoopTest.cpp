@@ -0,0 +1,60 @@
+#include "catch/catch.hpp"
+#include "eventLoop.h"
+#include <atomic>
+#include <thread>
+
+TEST_CASE( "Alerts are handled when notified and timers run periodically", "[event_loop]" ) {
+	EventLoop event_loop;
+	std::atomic<int> alert_batches(0);
+	std::atomic<int> timer_runs(0);
+	event_loop.add_timer(std::chrono::milliseconds(10), [&]() { timer_runs++; });
+
+	std::thread loop_thread([&]() {
+		event_loop.run([&]() { alert_batches++; });
+	});
+
+	event_loop.notify();
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	event_loop.stop();
+	loop_thread.join();
+
+	REQUIRE( alert_batches == 1 );
+	REQUIRE( timer_runs >= 2 );
+}
+
+TEST_CASE( "A stopped event loop returns without running anything", "[event_loop]" ) {
+	EventLoop event_loop;
+	bool ran = false;
+	event_loop.add_timer(std::chrono::milliseconds(0), [&]() { ran = true; });
+	event_loop.stop();
+	event_loop.run([&]() { ran = true; });
+	REQUIRE_FALSE( ran );
+}
+
+TEST_CASE( "Timers that are not armed stop until they are woken", "[event_loop]" ) {
+	EventLoop event_loop;
+	std::atomic<bool> armed(false);
+	std::atomic<int> checks(0);
+	std::atomic<int> timer_runs(0);
+	event_loop.add_timer(std::chrono::milliseconds(5), [&]() { timer_runs++; }, [&]() {
+		checks++;
+		return armed.load();
+	});
+
+	std::thread loop_thread([&]() {
+		event_loop.run([]() {});
+	});
+
+	// The timer is asked once and then parked, instead of being asked every 5 ms
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	REQUIRE( checks == 1 );
+	REQUIRE( timer_runs == 0 );
+
+	armed = true;
+	event_loop.wake_timers();
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	event_loop.stop();
+	loop_thread.join();
+
+	REQUIRE( timer_runs >= 2 );
+}
@@ -0,0 +1,58 @@
+#include "catch/catch.hpp"
+#include "fastresumeLoader.h"
+#include <mutex>
+#include <set>
+
+TEST_CASE( "Every buffer is decoded once and added in batches", "[fastresume_loader]" ) {
+	std::mutex mutex;
+	std::multiset<std::string> added;
+	std::size_t largest_batch = 0;
+
+	FastresumeLoader loader;
+	loader.start(
+		[](std::vector<std::vector<char>> &resume_data) {
+			for(int i = 0; i < 1000; i++) {
+				std::string const name = std::to_string(i);
+				resume_data.emplace_back(name.begin(), name.end());
+			}
+			return true;
+		},
+		[](std::vector<char> &resume_data, lt::add_torrent_params &atp) {
+			if(resume_data.back() == '7')
+				return false;
+			atp.save_path = std::string(resume_data.begin(), resume_data.end());
+			return true;
+		},
+		[&](std::vector<lt::add_torrent_params> &batch) {
+			std::lock_guard<std::mutex> lock(mutex);
+			largest_batch = std::max(largest_batch, batch.size());
+			for(lt::add_torrent_params const &atp : batch) {
+				added.insert(atp.save_path);
+			}
+		},
+		4, 32);
+	loader.wait();
+
+	FastresumeLoader::progress const progress = loader.get_progress();
+	REQUIRE( progress.finished );
+	REQUIRE( progress.total == 1000 );
+	REQUIRE( progress.failed == 100 );
+	REQUIRE( progress.loaded == 900 );
+	REQUIRE( added.size() == 900 );
+	REQUIRE( std::set<std::string>(added.begin(), added.end()).size() == 900 );
+	REQUIRE( added.count("7") == 0 );
+	REQUIRE( largest_batch == 32 );
+}
+
+TEST_CASE( "Loading an empty store finishes", "[fastresume_loader]" ) {
+	FastresumeLoader loader;
+	REQUIRE_FALSE( loader.get_progress().finished );
+	loader.start(
+		[](std::vector<std::vector<char>> &resume_data) { return true; },
+		[](std::vector<char> &resume_data, lt::add_torrent_params &atp) { return true; },
+		[](std::vector<lt::add_torrent_params> &batch) {},
+		4, 32);
+	loader.wait();
+	REQUIRE( loader.get_progress().finished );
+	REQUIRE( loader.get_progress().total == 0 );
+}
@@ -0,0 +1,23 @@
+#include "catch/catch.hpp"
+#include "fieldMask.h"
+
+TEST_CASE( "Field masks select the fields named in the list", "[field_mask]" ) {
+	std::vector<char const*> const names = {"name", "progress", "size", "path"};
+
+	FieldMask mask;
+	REQUIRE( mask.has(0) );
+	REQUIRE( mask.has(3) );
+
+	REQUIRE( mask.compile("size,name", names) );
+	REQUIRE( mask.has(0) );
+	REQUIRE_FALSE( mask.has(1) );
+	REQUIRE( mask.has(2) );
+	REQUIRE_FALSE( mask.has(3) );
+
+	// An unknown name is rejected and the mask keeps selecting every field
+	FieldMask rejected;
+	REQUIRE_FALSE( rejected.compile("name,sizes", names) );
+	REQUIRE_FALSE( rejected.compile("name,,size", names) );
+	REQUIRE( rejected.has(1) );
+	REQUIRE( rejected.has(3) );
+}
@@ -0,0 +1,76 @@
+#include "catch/catch.hpp"
+#include "fileSender.h"
+#include <boost/filesystem.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+
+namespace {
+
+struct transfer_result {
+	boost::system::error_code ec;
+	std::uint64_t sent = 0;
+	std::string received;
+};
+
+// Sends part of the file over a loopback connection and collects everything the other end reads until the sender closes it
+transfer_result transfer(std::string const &filename, std::uint64_t const offset, std::uint64_t const count) {
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::acceptor acceptor(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+	boost::asio::ip::tcp::socket sender(io_service);
+	boost::asio::ip::tcp::socket receiver(io_service);
+	sender.connect(acceptor.local_endpoint());
+	acceptor.accept(receiver);
+	// A small send buffer makes the sender wait for the receiver several times
+	sender.set_option(boost::asio::socket_base::send_buffer_size(8192));
+
+	transfer_result result;
+	int const fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	REQUIRE( fd >= 0 );
+	FileSender::start(sender, fd, offset, count, [&](boost::system::error_code const &ec, std::uint64_t const sent) {
+		result.ec = ec;
+		result.sent = sent;
+		sender.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+	});
+
+	std::vector<char> buffer(4096);
+	std::function<void()> read_some = [&]() {
+		receiver.async_read_some(boost::asio::buffer(buffer), [&](boost::system::error_code const &ec, std::size_t const length) {
+			result.received.append(buffer.data(), length);
+			if(!ec)
+				read_some();
+		});
+	};
+	read_some();
+	io_service.run();
+	return result;
+}
+
+}
+
+TEST_CASE( "Files are sent over the socket as they are on disk", "[file_sender]" ) {
+	boost::filesystem::path const filename = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+	std::string content;
+	for(int i = 0; content.size() < 3 * 1024 * 1024; i++) {
+		content += "piece " + std::to_string(i) + "\n";
+	}
+	std::ofstream(filename.string(), std::ios::binary) << content;
+
+	transfer_result result = transfer(filename.string(), 0, content.size());
+	REQUIRE( !result.ec );
+	REQUIRE( result.sent == content.size() );
+	REQUIRE( result.received == content );
+
+	result = transfer(filename.string(), 1000, 5000);
+	REQUIRE( !result.ec );
+	REQUIRE( result.received == content.substr(1000, 5000) );
+
+	// The file ends before the requested range does
+	result = transfer(filename.string(), content.size() - 10, 100);
+	REQUIRE( result.ec == boost::asio::error::eof );
+	REQUIRE( result.sent == 10 );
+	REQUIRE( result.received == content.substr(content.size() - 10) );
+
+	boost::filesystem::remove(filename);
+}
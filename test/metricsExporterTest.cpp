@@ -0,0 +1,30 @@
+#include "catch/catch.hpp"
+#include "metricsExporter.h"
+
+TEST_CASE( "Session counters are rendered in the text exposition format", "[metrics_exporter]" ) {
+	SessionCounters session_counters;
+	MetricsExporter exporter(session_counters);
+	SessionCounters::metric const *sent_bytes = session_counters.find("net.sent_bytes");
+	REQUIRE( sent_bytes != NULL );
+
+	std::vector<boost::uint64_t> values(session_counters.get_metrics().size(), 0);
+	values[sent_bytes->value_index] = 123456;
+	session_counters.update(values.data(), values.size(), std::chrono::steady_clock::now());
+
+	std::string out;
+	exporter.render_session(out, *session_counters.get_last_sample());
+	REQUIRE( out.find("# TYPE libtorrent_net_sent_bytes counter\nlibtorrent_net_sent_bytes 123456\n") != std::string::npos );
+}
+
+TEST_CASE( "Torrent label values are escaped", "[metrics_exporter]" ) {
+	SessionCounters session_counters;
+	MetricsExporter exporter(session_counters);
+	std::shared_ptr<Torrent::status_snapshot> snapshot = std::make_shared<Torrent::status_snapshot>();
+	snapshot->status.name = "a \"quoted\" name";
+	snapshot->status.num_peers = 7;
+	snapshot->info_hash = "00ff";
+
+	std::string out;
+	exporter.render_torrents(out, {42}, {snapshot});
+	REQUIRE( out.find("torrentine_torrent_peers{id=\"42\",info_hash=\"00ff\",name=\"a \\\"quoted\\\" name\"} 7\n") != std::string::npos );
+}
@@ -0,0 +1,32 @@
+#include "catch/catch.hpp"
+#include "pieceDeadlines.h"
+
+TEST_CASE( "A piece deadline is only reset by its last holder", "[piece_deadlines]" ) {
+	PieceDeadlines deadlines;
+	int sets = 0;
+	int resets = 0;
+	auto set = [&sets]() { sets++; };
+	auto reset = [&resets]() { resets++; };
+
+	deadlines.hold(1, 5, set);
+	deadlines.hold(1, 5, set);
+	deadlines.hold(2, 5, set);
+	REQUIRE( sets == 3 );
+	REQUIRE( deadlines.size() == 2 );
+
+	// The other stream on torrent 1 still needs piece 5
+	deadlines.release(1, 5, reset);
+	REQUIRE( resets == 0 );
+	deadlines.release(1, 5, reset);
+	REQUIRE( resets == 1 );
+	REQUIRE( deadlines.size() == 1 );
+
+	// Releasing a piece nobody holds does nothing
+	deadlines.release(1, 5, reset);
+	deadlines.release(3, 1, reset);
+	REQUIRE( resets == 1 );
+
+	deadlines.release(2, 5, reset);
+	REQUIRE( resets == 2 );
+	REQUIRE( deadlines.size() == 0 );
+}
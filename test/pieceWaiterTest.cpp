@@ -0,0 +1,77 @@
+#include "catch/catch.hpp"
+#include "pieceWaiter.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct outcome {
+	PieceWaiter::result result;
+	std::string data;
+};
+
+PieceWaiter::piece_handler record(std::vector<outcome> &outcomes) {
+	return [&outcomes](PieceWaiter::result const result, boost::shared_array<char> const &data, int const size) {
+		outcomes.push_back({result, data ? std::string(data.get(), size) : std::string()});
+	};
+}
+
+boost::shared_array<char> make_piece(std::string const &content) {
+	boost::shared_array<char> data(new char[content.size()]);
+	std::memcpy(data.get(), content.data(), content.size());
+	return data;
+}
+
+}
+
+TEST_CASE( "Every handler waiting for a piece gets it once", "[piece_waiter]" ) {
+	PieceWaiter waiter;
+	std::chrono::steady_clock::time_point const deadline = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+	std::vector<outcome> first, second, other_piece, other_torrent;
+	waiter.wait(1, 5, deadline, record(first));
+	waiter.wait(1, 5, deadline, record(second));
+	waiter.wait(1, 6, deadline, record(other_piece));
+	waiter.wait(2, 5, deadline, record(other_torrent));
+	REQUIRE( waiter.size() == 4 );
+
+	waiter.piece_read(1, 5, make_piece("piece five"), 10);
+	REQUIRE( first.size() == 1 );
+	REQUIRE( first[0].result == PieceWaiter::result::read );
+	REQUIRE( first[0].data == "piece five" );
+	REQUIRE( second.size() == 1 );
+	REQUIRE( other_piece.empty() );
+	REQUIRE( other_torrent.empty() );
+	REQUIRE( waiter.size() == 2 );
+
+	// A second alert for the same piece finds nobody waiting
+	waiter.piece_read(1, 5, make_piece("piece five"), 10);
+	REQUIRE( first.size() == 1 );
+
+	waiter.piece_read(1, 6, boost::shared_array<char>(), 0);
+	REQUIRE( other_piece.size() == 1 );
+	REQUIRE( other_piece[0].result == PieceWaiter::result::failed );
+}
+
+TEST_CASE( "Waiting ends when the torrent is removed or the deadline passes", "[piece_waiter]" ) {
+	PieceWaiter waiter;
+	std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+	std::vector<outcome> removed, soon, later;
+	waiter.wait(3, 0, now + std::chrono::minutes(1), record(removed));
+	waiter.wait(3, 100, now + std::chrono::minutes(1), record(removed));
+	waiter.wait(4, 0, now + std::chrono::seconds(1), record(soon));
+	waiter.wait(4, 1, now + std::chrono::seconds(10), record(later));
+
+	waiter.torrent_removed(3);
+	REQUIRE( removed.size() == 2 );
+	REQUIRE( removed[1].result == PieceWaiter::result::failed );
+	REQUIRE( waiter.size() == 2 );
+
+	waiter.expire(now);
+	REQUIRE( soon.empty() );
+	waiter.expire(now + std::chrono::seconds(5));
+	REQUIRE( soon.size() == 1 );
+	REQUIRE( soon[0].result == PieceWaiter::result::expired );
+	REQUIRE( later.empty() );
+	REQUIRE( waiter.size() == 1 );
+}
@@ -0,0 +1,150 @@
+#include "catch/catch.hpp"
+#include "responseBody.h"
+#include "rapidjson/writer.h"
+#include <string>
+#include <zlib.h>
+
+namespace {
+
+// 15 + 16 window bits reads gzip, 15 zlib
+std::string inflate_body(char const *data, std::size_t const size, int const window_bits = 15 + 16) {
+	z_stream stream = {};
+	inflateInit2(&stream, window_bits);
+	std::string out(1 << 20, '\0');
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+	stream.avail_in = size;
+	stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+	stream.avail_out = out.size();
+	int const result = inflate(&stream, Z_FINISH);
+	out.resize(stream.total_out);
+	inflateEnd(&stream);
+	return result == Z_STREAM_END ? out : std::string();
+}
+
+}
+
+TEST_CASE( "JSON bodies are compact unless pretty is asked for", "[response_body]" ) {
+	rapidjson::Document document;
+	document.SetObject();
+	document.AddMember("message", "ok", document.GetAllocator());
+	document.AddMember("count", 2, document.GetAllocator());
+
+	response_body body = write_json_body(document, false);
+	REQUIRE( std::string(body.data, body.size) == "{\"message\":\"ok\",\"count\":2}" );
+
+	body = write_json_body(document, true);
+	std::string const pretty(body.data, body.size);
+	REQUIRE( pretty.find('\n') != std::string::npos );
+	REQUIRE( pretty.find("\"count\": 2") != std::string::npos );
+}
+
+TEST_CASE( "Gzipped bodies inflate back to the original", "[response_body]" ) {
+	std::string original;
+	for(int i = 0; i < 10000; i++) {
+		original += "{\"id\":" + std::to_string(i) + ",\"name\":\"torrent\"},";
+	}
+
+	// The same thread reuses its stream, so a second body must come out just as right as the first
+	for(int i = 0; i < 2; i++) {
+		response_body const compressed = compress_body(content_coding::gzip, 6, original.data(), original.size());
+		REQUIRE( compressed.data != NULL );
+		REQUIRE( compressed.size < original.size() / 4 );
+		REQUIRE( inflate_body(compressed.data, compressed.size) == original );
+	}
+
+	response_body const empty = compress_body(content_coding::gzip, 6, "", 0);
+	REQUIRE( empty.data != NULL );
+	REQUIRE( inflate_body(empty.data, empty.size).empty() );
+}
+
+namespace {
+
+// Removes the chunk framing and returns the concatenated chunk data, or an empty string if the framing is broken
+std::string dechunk(std::string const &chunked) {
+	std::string data;
+	std::size_t position = 0;
+	while(true) {
+		std::size_t const line_end = chunked.find("\r\n", position);
+		if(line_end == std::string::npos)
+			return std::string();
+		std::size_t const size = std::stoul(chunked.substr(position, line_end - position), NULL, 16);
+		position = line_end + 2;
+		if(size == 0)
+			return chunked.compare(position, std::string::npos, "\r\n") == 0 ? data : std::string();
+		data.append(chunked, position, size);
+		position += size + 2;
+	}
+}
+
+std::string write_chunked(content_coding const coding, int const items, std::size_t &chunks) {
+	ChunkedBodyStream body(coding, 6, 1024);
+	rapidjson::Writer<ChunkedBodyStream> writer(body);
+	std::string chunked;
+	std::string chunk;
+	chunks = 0;
+	writer.StartArray();
+	for(int i = 0; i < items; i++) {
+		writer.StartObject();
+		writer.Key("id");
+		writer.Int(i);
+		writer.EndObject();
+		if(body.is_full()) {
+			body.take_chunk(chunk, false);
+			REQUIRE( chunk.size() < 2048 );
+			chunked += chunk;
+			chunks++;
+		}
+	}
+	writer.EndArray();
+	body.take_chunk(chunk, true);
+	chunked += chunk;
+	return chunked;
+}
+
+}
+
+TEST_CASE( "Deflate bodies and compression levels", "[response_body]" ) {
+	std::string original;
+	for(int i = 0; i < 10000; i++) {
+		original += "{\"id\":" + std::to_string(i) + ",\"name\":\"torrent\"},";
+	}
+
+	response_body const deflated = compress_body(content_coding::deflate, 6, original.data(), original.size());
+	REQUIRE( deflated.data != NULL );
+	REQUIRE( inflate_body(deflated.data, deflated.size, 15) == original );
+
+	// Switching levels on the reused stream still gives valid bodies, and the slower level is not bigger
+	response_body const fast = compress_body(content_coding::gzip, 1, original.data(), original.size());
+	std::size_t const fast_size = fast.size;
+	REQUIRE( inflate_body(fast.data, fast.size) == original );
+	response_body const best = compress_body(content_coding::gzip, 9, original.data(), original.size());
+	REQUIRE( inflate_body(best.data, best.size) == original );
+	REQUIRE( best.size <= fast_size );
+
+	REQUIRE( compress_body(content_coding::identity, 6, original.data(), original.size()).data == NULL );
+}
+
+TEST_CASE( "Chunked bodies are framed in bounded chunks", "[response_body]" ) {
+	std::string expected = "[";
+	for(int i = 0; i < 1000; i++) {
+		expected += (i > 0 ? ",{\"id\":" : "{\"id\":") + std::to_string(i) + "}";
+	}
+	expected += "]";
+
+	std::size_t chunks;
+	REQUIRE( dechunk(write_chunked(content_coding::identity, 1000, chunks)) == expected );
+	REQUIRE( chunks > 5 );
+
+	std::string const compressed = dechunk(write_chunked(content_coding::gzip, 1000, chunks));
+	REQUIRE( inflate_body(compressed.data(), compressed.size()) == expected );
+	std::string const deflated = dechunk(write_chunked(content_coding::deflate, 1000, chunks));
+	REQUIRE( inflate_body(deflated.data(), deflated.size(), 15) == expected );
+
+	REQUIRE( write_chunked(content_coding::identity, 0, chunks) == "2\r\n[]\r\n0\r\n\r\n" );
+
+	// A body that is never taken as a chunk never sets up the compressor, and starting it twice is harmless
+	ChunkedBodyStream unused(content_coding::gzip, 6);
+	ChunkedBodyStream started(content_coding::gzip, 6);
+	REQUIRE( started.start_compression() == content_coding::gzip );
+	REQUIRE( started.start_compression() == content_coding::gzip );
+}
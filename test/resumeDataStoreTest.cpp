@@ -0,0 +1,66 @@
+#include "catch/catch.hpp"
+#include "resumeDataStore.h"
+#include <boost/make_shared.hpp>
+#include <fstream>
+
+TEST_CASE( "Resume data is saved in batches and removals win", "[resume_data_store]" ) {
+	fs::path directory = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(directory);
+	fs::path database = directory / "torrentine.db";
+
+	boost::shared_ptr<lt::entry> resume_data = boost::make_shared<lt::entry>();
+	(*resume_data)["save_path"] = std::string("/downloads/");
+
+	{
+		ResumeDataStore store;
+		REQUIRE( store.open(database) );
+		store.save("0123", resume_data);
+		store.save("4567", resume_data);
+		store.flush();
+		std::vector<std::vector<char>> all_resume_data;
+		REQUIRE( store.load_all(all_resume_data) );
+		REQUIRE( all_resume_data.size() == 2 );
+
+		// A removal queued after a save wins, even when both are handled in the same batch
+		store.save("0123", resume_data);
+		store.remove("0123");
+		store.flush();
+		all_resume_data.clear();
+		REQUIRE( store.load_all(all_resume_data) );
+		REQUIRE( all_resume_data.size() == 1 );
+
+		// Jobs still queued are written when the store is destroyed
+		store.save("89ab", resume_data);
+	}
+
+	ResumeDataStore store;
+	REQUIRE( store.open(database) );
+	std::vector<std::vector<char>> all_resume_data;
+	REQUIRE( store.load_all(all_resume_data) );
+	REQUIRE( all_resume_data.size() == 2 );
+
+	fs::remove_all(directory);
+}
+
+TEST_CASE( "Fastresume files are migrated once", "[resume_data_store]" ) {
+	fs::path directory = fs::temp_directory_path() / fs::unique_path();
+	fs::path fastresume_path = directory / "fastresume";
+	fs::create_directories(fastresume_path);
+	for(std::string const name : {"0123", "4567"}) {
+		std::ofstream out((fastresume_path / (name + ".fastresume")).string(), std::ios_base::binary);
+		out << "d9:save_path11:/downloads/e";
+	}
+
+	ResumeDataStore store;
+	REQUIRE( store.open(directory / "torrentine.db") );
+	REQUIRE( store.migrate_files(fastresume_path) == 2 );
+	REQUIRE_FALSE( fs::exists(fastresume_path / "0123.fastresume") );
+	REQUIRE( store.migrate_files(fastresume_path) == 0 );
+
+	std::vector<std::vector<char>> all_resume_data;
+	REQUIRE( store.load_all(all_resume_data) );
+	REQUIRE( all_resume_data.size() == 2 );
+	REQUIRE( std::string(all_resume_data.at(0).begin(), all_resume_data.at(0).end()) == "d9:save_path11:/downloads/e" );
+
+	fs::remove_all(directory);
+}
@@ -0,0 +1,33 @@
+#include "catch/catch.hpp"
+#include "sessionCounters.h"
+
+TEST_CASE( "Every session metric is resolved by name", "[session_counters]" ) {
+	SessionCounters session_counters;
+	REQUIRE( session_counters.get_metrics().size() == lt::session_stats_metrics().size() );
+	for(SessionCounters::metric const &m : session_counters.get_metrics()) {
+		REQUIRE( session_counters.find_index(m.name) == lt::find_metric_idx(m.name.c_str()) );
+	}
+	REQUIRE( session_counters.find("no.such_metric") == NULL );
+	REQUIRE( session_counters.find_index("no.such_metric") == -1 );
+}
+
+TEST_CASE( "Counter rates are computed from consecutive samples", "[session_counters]" ) {
+	SessionCounters session_counters;
+	SessionCounters::metric const *sent_bytes = session_counters.find("net.sent_bytes");
+	REQUIRE( sent_bytes != NULL );
+	REQUIRE_FALSE( session_counters.get_last_sample() );
+
+	std::size_t const count = session_counters.get_metrics().size();
+	std::vector<boost::uint64_t> values(count, 0);
+	std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+	values[sent_bytes->value_index] = 1000;
+	session_counters.update(values.data(), count, start);
+	REQUIRE( session_counters.get_last_sample()->rates[sent_bytes->value_index] == 0 );
+
+	values[sent_bytes->value_index] = 5000;
+	session_counters.update(values.data(), count, start + std::chrono::seconds(2));
+	std::shared_ptr<SessionCounters::sample const> sample = session_counters.get_last_sample();
+	REQUIRE( sample->values[sent_bytes->value_index] == 5000 );
+	REQUIRE( sample->rates[sent_bytes->value_index] == Approx(2000) );
+	REQUIRE( sample->interval == std::chrono::milliseconds(2000) );
+}
@@ -0,0 +1,44 @@
+#include "catch/catch.hpp"
+#include "sessionHistory.h"
+#include <limits>
+
+TEST_CASE( "Seconds ring keeps only the last hour", "[session_history]" ) {
+	SessionHistory history;
+	SessionStatus status;
+	std::time_t const start = 1500000000;
+	for(std::size_t i = 0; i < SessionHistory::seconds_capacity + 10; i++) {
+		status.download_rate = i;
+		history.add(start + i, status);
+	}
+
+	SessionHistory::window window;
+	history.get_window(window, 1, 0, std::numeric_limits<std::time_t>::max());
+	REQUIRE( window.resolution == 1 );
+	REQUIRE( window.times.size() == SessionHistory::seconds_capacity );
+	REQUIRE( window.times.front() == start + 10 );
+	REQUIRE( window.values.at(0).front() == 10 );
+	REQUIRE( window.values.at(0).back() == static_cast<long>(SessionHistory::seconds_capacity + 9) );
+
+	history.get_window(window, 1, start + 100, start + 109);
+	REQUIRE( window.times.size() == 10 );
+	REQUIRE( window.values.at(0).front() == 100 );
+}
+
+TEST_CASE( "Minutes ring averages rates and keeps the last gauge", "[session_history]" ) {
+	SessionHistory history;
+	SessionStatus status;
+	std::time_t const start = 1500000000 - 1500000000 % 60;
+	for(int i = 0; i < 120; i++) {
+		status.download_rate = (i < 60) ? i : 1000;
+		status.dht_nodes = i;
+		history.add(start + i, status);
+	}
+
+	SessionHistory::window window;
+	history.get_window(window, 60, 0, std::numeric_limits<std::time_t>::max());
+	// The second minute is still being filled
+	REQUIRE( window.times.size() == 1 );
+	REQUIRE( window.times.at(0) == start );
+	REQUIRE( window.values.at(0).at(0) == 29 );
+	REQUIRE( window.values.at(11).at(0) == 59 );
+}
@@ -0,0 +1,79 @@
+#include "catch/catch.hpp"
+#include "staticAssetCache.h"
+#include <fstream>
+
+namespace {
+
+void write_file(fs::path const &path, std::string const &content) {
+	std::ofstream out(path.string(), std::ios::binary);
+	out << content;
+}
+
+}
+
+TEST_CASE( "Web UI files are served from memory with a gzip copy and ETags", "[static_asset_cache]" ) {
+	fs::path const root = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(root / "static");
+	std::string bundle;
+	for(int i = 0; i < 1000; i++) {
+		bundle += "function f" + std::to_string(i) + "() { return " + std::to_string(i) + "; }\n";
+	}
+	write_file(root / "index.html", "<html></html>");
+	write_file(root / "index.3042b6ee.js", bundle);
+	write_file(root / "static" / "logo.png", "not really a png");
+	write_file(root / "empty.txt", "");
+
+	StaticAssetCache cache(root, std::chrono::seconds(0));
+	std::shared_ptr<StaticAssetCache::asset const> index = cache.find("/");
+	REQUIRE( index );
+	REQUIRE( index->body == "<html></html>" );
+	REQUIRE( index->content_type == "text/html; charset=utf-8" );
+	REQUIRE_FALSE( index->immutable );
+	REQUIRE( cache.find("/index.html") == index );
+	REQUIRE( cache.find("/index.html?x=1") == index );
+
+	std::shared_ptr<StaticAssetCache::asset const> js = cache.find("/index.3042b6ee.js");
+	REQUIRE( js );
+	REQUIRE( js->immutable );
+	REQUIRE_FALSE( js->gzip_body.empty() );
+	REQUIRE( js->gzip_body.size() < js->body.size() / 4 );
+	REQUIRE( js->etag.front() == '"' );
+	REQUIRE( js->etag != js->gzip_etag );
+
+	std::shared_ptr<StaticAssetCache::asset const> png = cache.find("/static/logo.png");
+	REQUIRE( png );
+	REQUIRE( png->gzip_body.empty() );
+	REQUIRE( png->content_type == "image/png" );
+
+	std::shared_ptr<StaticAssetCache::asset const> empty = cache.find("/empty.txt");
+	REQUIRE( empty );
+	REQUIRE( empty->body.empty() );
+
+	// Only files under root are in the table
+	REQUIRE_FALSE( cache.find("/../index.html") );
+	REQUIRE_FALSE( cache.find("/missing.js") );
+
+	SECTION( "Changed files are reloaded" ) {
+		std::string const old_etag = index->etag;
+		write_file(root / "index.html", "<html><body></body></html>");
+		fs::remove(root / "static" / "logo.png");
+		std::shared_ptr<StaticAssetCache::asset const> reloaded = cache.find("/");
+		REQUIRE( reloaded->body == "<html><body></body></html>" );
+		REQUIRE( reloaded->etag != old_etag );
+		REQUIRE( cache.find("/index.3042b6ee.js") == js );
+		REQUIRE_FALSE( cache.find("/static/logo.png") );
+		// Readers that still hold the old version keep it unchanged
+		REQUIRE( index->body == "<html></html>" );
+	}
+
+	SECTION( "A rewrite of the same size within the same second is reloaded" ) {
+		write_file(root / "index.html", "<html>12345</html>");
+		REQUIRE( cache.find("/")->body == "<html>12345</html>" );
+		std::time_t const second = fs::last_write_time(root / "index.html");
+		write_file(root / "index.html", "<html>67890</html>");
+		fs::last_write_time(root / "index.html", second);
+		REQUIRE( cache.find("/")->body == "<html>67890</html>" );
+	}
+
+	fs::remove_all(root);
+}
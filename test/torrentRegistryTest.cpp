@@ -0,0 +1,110 @@
+#include "catch/catch.hpp"
+#include "torrentRegistry.h"
+#include <atomic>
+#include <thread>
+
+namespace {
+
+lt::sha1_hash make_info_hash(unsigned long int const id) {
+	char digest[20] = {};
+	std::memcpy(digest, &id, sizeof(id));
+	digest[19] = 1;
+	return lt::sha1_hash(digest);
+}
+
+std::shared_ptr<Torrent> make_torrent(unsigned long int const id) {
+	return std::make_shared<Torrent>(id, make_info_hash(id));
+}
+
+}
+
+TEST_CASE( "Torrents are found by id and by info hash", "[torrent_registry]" ) {
+	TorrentRegistry registry;
+	for(unsigned long int id = 1; id <= 5; id++) {
+		REQUIRE( registry.insert(make_torrent(id)) );
+	}
+	REQUIRE_FALSE( registry.insert(make_torrent(3)) );
+	REQUIRE( registry.size() == 5 );
+	REQUIRE( registry.find(4)->get_id() == 4 );
+	REQUIRE( registry.find(make_info_hash(2))->get_id() == 2 );
+	REQUIRE_FALSE( registry.find(6) );
+
+	std::vector<std::shared_ptr<Torrent>> found;
+	REQUIRE( registry.find_all(found, {5, 1}) == 0 );
+	REQUIRE( found.size() == 2 );
+	REQUIRE( found.at(0)->get_id() == 5 );
+	REQUIRE( registry.find_all(found, {1, 7, 2}) == 7 );
+}
+
+TEST_CASE( "Registry keeps insertion order after removals", "[torrent_registry]" ) {
+	TorrentRegistry registry;
+	for(unsigned long int id = 1; id <= 5; id++) {
+		registry.insert(make_torrent(id));
+	}
+	REQUIRE( registry.erase(2) );
+	REQUIRE( registry.erase(make_info_hash(4)) );
+	REQUIRE_FALSE( registry.erase(2) );
+	REQUIRE( registry.get_all_ids() == std::vector<unsigned long int>({1, 3, 5}) );
+	REQUIRE_FALSE( registry.find(make_info_hash(4)) );
+
+	TorrentRegistry copy(registry);
+	registry.erase(1);
+	REQUIRE( copy.get_all_ids() == std::vector<unsigned long int>({1, 3, 5}) );
+	REQUIRE( copy.find(make_info_hash(1))->get_id() == 1 );
+}
+
+// Readers walk and query snapshots the way the REST API does while a writer keeps adding and removing torrents
+TEST_CASE( "Snapshots stay consistent while torrents are added and removed", "[torrent_registry][stress]" ) {
+	SharedTorrentRegistry shared;
+	std::atomic<bool> done(false);
+	std::atomic<unsigned long int> inconsistencies(0);
+	std::atomic<unsigned long int> snapshots_read(0);
+
+	std::thread writer([&]() {
+		unsigned long int oldest_id = 1;
+		for(unsigned long int id = 1; id <= 5000; id++) {
+			std::shared_ptr<TorrentRegistry> next = shared.copy();
+			next->insert(make_torrent(id));
+			if(next->size() > 200) {
+				next->erase(oldest_id++);
+			}
+			shared.publish(next);
+		}
+		done = true;
+	});
+
+	std::vector<std::thread> readers;
+	for(int i = 0; i < 4; i++) {
+		readers.emplace_back([&]() {
+			// Every reader checks at least one snapshot, even if the writer is done before it starts
+			do {
+				std::shared_ptr<TorrentRegistry const> snapshot = shared.snapshot();
+				std::size_t count = 0;
+				unsigned long int last_id = 0;
+				for(std::shared_ptr<Torrent> const &torrent : *snapshot) {
+					if(torrent->get_id() <= last_id ||
+							snapshot->find(torrent->get_id()) != torrent ||
+							snapshot->find(torrent->get_info_hash()) != torrent) {
+						inconsistencies++;
+					}
+					last_id = torrent->get_id();
+					count++;
+				}
+				std::vector<std::shared_ptr<Torrent>> found;
+				if(count != snapshot->size() || snapshot->find_all(found, snapshot->get_all_ids()) != 0) {
+					inconsistencies++;
+				}
+				snapshots_read++;
+			} while(!done);
+		});
+	}
+
+	writer.join();
+	for(std::thread &reader : readers) {
+		reader.join();
+	}
+
+	REQUIRE( inconsistencies == 0 );
+	REQUIRE( snapshots_read >= 4 );
+	REQUIRE( shared.snapshot()->size() == 200 );
+}
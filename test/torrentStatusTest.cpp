@@ -0,0 +1,47 @@
+#include "catch/catch.hpp"
+#include "torrentStatusFields.h"
+#include <algorithm>
+
+namespace {
+
+std::size_t field_index(std::string const &name) {
+	std::vector<status_field> const &fields = get_torrent_status_fields();
+	for(std::size_t index = 0; index < fields.size(); index++) {
+		if(name == fields[index].name)
+			return index;
+	}
+	return fields.size();
+}
+
+}
+
+TEST_CASE( "Only changed status fields get the new sequence", "[torrent_status]" ) {
+	char digest[20] = {1};
+	Torrent torrent(1, lt::sha1_hash(digest));
+	lt::torrent_status status;
+	status.name = "debian.iso";
+	status.download_rate = 100;
+
+	REQUIRE( torrent.update_status(status, 1) );
+	std::shared_ptr<Torrent::status_snapshot const> first = torrent.get_status_snapshot();
+	REQUIRE( first->sequence == 1 );
+	REQUIRE( first->field_sequences.size() == get_torrent_status_fields().size() );
+	REQUIRE( std::all_of(first->field_sequences.begin(), first->field_sequences.end(), [](std::uint64_t s) { return s == 1; }) );
+
+	REQUIRE_FALSE( torrent.update_status(status, 2) );
+	REQUIRE( torrent.get_status_snapshot() == first );
+
+	status.download_rate = 200;
+	REQUIRE( torrent.update_status(status, 3) );
+	std::shared_ptr<Torrent::status_snapshot const> second = torrent.get_status_snapshot();
+	REQUIRE( second->sequence == 3 );
+	REQUIRE( second->field_sequences.at(field_index("download_rate")) == 3 );
+	REQUIRE( second->field_sequences.at(field_index("name")) == 1 );
+	REQUIRE( first->status.download_rate == 100 );
+
+	torrent.set_limits(1024, -1);
+	REQUIRE( torrent.update_limits(4) );
+	REQUIRE( torrent.get_status_snapshot()->download_limit == 1024 );
+	REQUIRE( torrent.get_status_snapshot()->field_sequences.at(field_index("download_limit")) == 4 );
+	REQUIRE( torrent.get_status_snapshot()->field_sequences.at(field_index("upload_limit")) == 1 );
+}
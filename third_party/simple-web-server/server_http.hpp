@@ -101,6 +101,21 @@ namespace SimpleWeb {
         });
       }
 
+      /// The socket of the connection, for writing a body without the stream buffer (e.g. with sendfile()).
+      /// Only use it once send() has completed, and keep the Response alive until done.
+      socket_type &get_socket() noexcept {
+        return *session->connection->socket;
+      }
+
+      /// (Re)starts the content timeout while writing to get_socket(). The connection is closed if it expires.
+      void set_timeout() noexcept {
+        session->connection->set_timeout(timeout_content);
+      }
+
+      void cancel_timeout() noexcept {
+        session->connection->cancel_timeout();
+      }
+
       /// Write directly to stream buffer using std::ostream::write
       void write(const char_type *ptr, std::streamsize n) {
         std::ostream::write(ptr, n);